@@ -0,0 +1,259 @@
+/* Copyright 2019 Streampunk Media Ltd.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+// Micro-benchmarks of the structures on the path between the PortAudio callback and the
+// stream workers, built without Node so that replacements can be compared on each platform.
+// Run with an optional name filter and repeat count: naudiodon_bench [filter] [reps]
+
+#include "../src/ChunkQueue.h"
+#include "../src/Memory.h"
+#include "../src/RingBuffer.h"
+#include "../src/SampleConvert.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace streampunk;
+
+namespace {
+
+// stops the optimiser discarding work whose result is otherwise unused
+volatile uint32_t sSink = 0;
+
+typedef std::function<uint64_t()> BenchFn;
+
+struct Bench {
+  std::string name;
+  BenchFn fn; // returns the number of operations performed
+};
+
+// runs the benchmark reps times and prints the fastest and median times per operation
+void runBench(const Bench &bench, uint32_t reps) {
+  std::vector<double> nsPerOp;
+  uint64_t ops = 0;
+  for (uint32_t r = 0; r < reps; ++r) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    ops = bench.fn();
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    nsPerOp.push_back(elapsed.count() / (ops ? ops : 1));
+  }
+  std::sort(nsPerOp.begin(), nsPerOp.end());
+  printf("%-44s %12.1f %12.1f %12llu\n", bench.name.c_str(),
+         nsPerOp.front(), nsPerOp[nsPerOp.size() / 2], (unsigned long long)ops);
+}
+
+// producer and consumer threads passing items through a bounded queue, as the stream workers do
+Bench queueContention(uint32_t maxQueue) {
+  return { "ChunkQueue/contention/maxQueue:" + std::to_string(maxQueue), [maxQueue]() {
+    const uint32_t numItems = 200000;
+    ChunkQueue<std::shared_ptr<Memory> > queue(maxQueue);
+    std::shared_ptr<Memory> item = Memory::makeNew(64);
+    std::thread producer([&]() {
+      for (uint32_t i = 0; i < numItems; ++i)
+        queue.enqueue(item);
+    });
+    uint32_t received = 0;
+    for (uint32_t i = 0; i < numItems; ++i)
+      received += queue.dequeue() ? 1 : 0;
+    producer.join();
+    sSink = sSink + received;
+    return (uint64_t)numItems;
+  }};
+}
+
+// single thread enqueue and dequeue, the cost of the queue without any waiting
+Bench queueUncontended() {
+  return { "ChunkQueue/uncontended", []() {
+    const uint32_t numItems = 1000000;
+    ChunkQueue<std::shared_ptr<Memory> > queue(16);
+    std::shared_ptr<Memory> item = Memory::makeNew(64);
+    for (uint32_t i = 0; i < numItems; ++i) {
+      queue.enqueue(item);
+      sSink = sSink + (queue.dequeue() ? 1 : 0);
+    }
+    return (uint64_t)numItems;
+  }};
+}
+
+// chunks of chunkBytes written to the output ring and drained by periods of periodBytes,
+// the pattern of pushOutChunk feeding fillPaBuffer, measured per period filled
+Bench ringFill(uint32_t chunkBytes, uint32_t periodBytes) {
+  return { "RingBuffer/fill/chunk:" + std::to_string(chunkBytes) + "/period:" + std::to_string(periodBytes),
+           [chunkBytes, periodBytes]() {
+    const uint64_t totalBytes = 64 << 20;
+    RingBuffer<uint8_t> ring(std::max<uint32_t>(chunkBytes, periodBytes) * 4);
+    std::vector<uint8_t> chunk(chunkBytes, 0x55);
+    std::vector<uint8_t> period(periodBytes);
+    uint64_t written = 0;
+    uint64_t periods = 0;
+    uint32_t chunkOffset = 0;
+    while (written < totalBytes) {
+      while (ring.writeAvailable() && (written < totalBytes)) {
+        uint32_t bytes = ring.write(chunk.data() + chunkOffset, chunkBytes - chunkOffset);
+        chunkOffset = (chunkOffset + bytes) % chunkBytes;
+        written += bytes;
+      }
+      while (ring.readAvailable() >= periodBytes) {
+        ring.read(period.data(), periodBytes);
+        ++periods;
+      }
+    }
+    sSink = sSink + period[0];
+    return periods;
+  }};
+}
+
+// the same flow with the chunk writer and period reader on separate threads
+Bench ringThreaded(uint32_t chunkBytes, uint32_t periodBytes) {
+  return { "RingBuffer/threaded/chunk:" + std::to_string(chunkBytes) + "/period:" + std::to_string(periodBytes),
+           [chunkBytes, periodBytes]() {
+    const uint64_t totalBytes = 64 << 20;
+    RingBuffer<uint8_t> ring(std::max<uint32_t>(chunkBytes, periodBytes) * 4);
+    std::thread producer([&]() {
+      std::vector<uint8_t> chunk(chunkBytes, 0x55);
+      uint64_t written = 0;
+      uint32_t chunkOffset = 0;
+      while (written < totalBytes) {
+        uint32_t bytes = ring.write(chunk.data() + chunkOffset, chunkBytes - chunkOffset);
+        if (!bytes)
+          std::this_thread::yield();
+        chunkOffset = (chunkOffset + bytes) % chunkBytes;
+        written += bytes;
+      }
+    });
+    std::vector<uint8_t> period(periodBytes);
+    uint64_t read = 0;
+    uint64_t periods = 0;
+    while (read < totalBytes) {
+      uint32_t bytes = ring.read(period.data(), std::min<uint64_t>(periodBytes, totalBytes - read));
+      if (!bytes)
+        std::this_thread::yield();
+      else
+        ++periods;
+      read += bytes;
+    }
+    producer.join();
+    sSink = sSink + period[0];
+    return periods;
+  }};
+}
+
+// a fresh allocation for every block, as reads do when the input pool is exhausted
+Bench memoryAlloc(uint32_t blockBytes) {
+  return { "Memory/makeNew/bytes:" + std::to_string(blockBytes), [blockBytes]() {
+    const uint32_t numBlocks = 200000;
+    for (uint32_t i = 0; i < numBlocks; ++i) {
+      std::shared_ptr<Memory> block = Memory::makeNew(blockBytes);
+      block->buf()[0] = (uint8_t)i;
+      sSink = sSink + block->buf()[0];
+    }
+    return (uint64_t)numBlocks;
+  }};
+}
+
+// blocks recycled once only the pool holds them, the scheme MemoryPool uses
+Bench memoryRecycle(uint32_t blockBytes, uint32_t numPooled) {
+  return { "Memory/recycle/bytes:" + std::to_string(blockBytes) + "/pool:" + std::to_string(numPooled),
+           [blockBytes, numPooled]() {
+    const uint32_t numBlocks = 200000;
+    std::vector<std::shared_ptr<Memory> > pool;
+    for (uint32_t i = 0; i < numPooled; ++i)
+      pool.push_back(Memory::makeNew(blockBytes));
+    // a few blocks stay held downstream, as buffers not yet collected in JavaScript would be
+    std::vector<std::shared_ptr<Memory> > held(numPooled / 2);
+    size_t next = 0;
+    for (uint32_t i = 0; i < numBlocks; ++i) {
+      std::shared_ptr<Memory> block;
+      for (size_t n = 0; n < pool.size(); ++n) {
+        std::shared_ptr<Memory> &candidate = pool[next];
+        next = (next + 1) % pool.size();
+        if (1 == candidate.use_count()) {
+          block = candidate;
+          break;
+        }
+      }
+      if (!block)
+        block = Memory::makeNew(blockBytes);
+      block->setNumBytes(blockBytes);
+      block->buf()[0] = (uint8_t)i;
+      held[i % held.size()] = block;
+    }
+    sSink = sSink + held[0]->buf()[0];
+    return (uint64_t)numBlocks;
+  }};
+}
+
+// one period of samples converted between formats, as the callback does for deviceFormat
+Bench convert(uint32_t srcFormat, uint32_t dstFormat, bool dither, uint32_t numSamples) {
+  return { "SampleConverter/" + std::to_string(srcFormat) + "to" + std::to_string(dstFormat) +
+           (dither ? "/dither" : "") + "/samples:" + std::to_string(numSamples),
+           [srcFormat, dstFormat, dither, numSamples]() {
+    const uint32_t numPeriods = 20000;
+    SampleConverter converter(srcFormat, dstFormat, dither);
+    std::vector<uint8_t> src(numSamples * converter.srcBytes());
+    std::vector<uint8_t> dst(numSamples * converter.dstBytes());
+    for (size_t i = 0; i < src.size(); ++i)
+      src[i] = (uint8_t)(i * 7);
+    if (1 == srcFormat) {
+      float *samples = (float *)src.data();
+      for (uint32_t i = 0; i < numSamples; ++i)
+        samples[i] = (float)((i % 200) - 100) / 100.0f;
+    }
+    for (uint32_t p = 0; p < numPeriods; ++p)
+      converter.convert(src.data(), dst.data(), numSamples);
+    sSink = sSink + dst[0];
+    return (uint64_t)numPeriods;
+  }};
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  std::string filter = argc > 1 ? argv[1] : "";
+  uint32_t reps = argc > 2 ? (uint32_t)std::max(1, atoi(argv[2])) : 5;
+
+  std::vector<Bench> benches;
+  benches.push_back(queueUncontended());
+  for (uint32_t maxQueue : { 1, 4, 16 })
+    benches.push_back(queueContention(maxQueue));
+  // chunks smaller than, equal to and spanning several periods of 256 stereo 16 bit frames
+  for (uint32_t chunkBytes : { 256, 1024, 4096, 16384 })
+    benches.push_back(ringFill(chunkBytes, 1024));
+  for (uint32_t periodBytes : { 64, 4096 })
+    benches.push_back(ringFill(16384, periodBytes));
+  for (uint32_t chunkBytes : { 1024, 16384 })
+    benches.push_back(ringThreaded(chunkBytes, 1024));
+  for (uint32_t blockBytes : { 1024, 16384, 262144 }) {
+    benches.push_back(memoryAlloc(blockBytes));
+    benches.push_back(memoryRecycle(blockBytes, 16));
+  }
+  benches.push_back(convert(16, 1, false, 512));
+  benches.push_back(convert(1, 16, false, 512));
+  benches.push_back(convert(1, 16, true, 512));
+  benches.push_back(convert(24, 1, false, 512));
+  benches.push_back(convert(1, 24, true, 512));
+
+  printf("%-44s %12s %12s %12s\n", "benchmark", "min ns/op", "median ns/op", "ops");
+  for (const Bench &bench : benches)
+    if (std::string::npos != bench.name.find(filter))
+      runBench(bench, reps);
+  return (int)(sSink & 0);
+}
@@ -1,4 +1,8 @@
 {
+  "variables": {
+    # node-gyp rebuild -- -Dnaudiodon_bench=1 also builds the native benchmarks
+    "naudiodon_bench%": 0
+  },
   "targets": [
     {
       "target_name": "naudiodon",
@@ -7,7 +11,23 @@
         "src/GetDevices.cc",
         "src/GetHostAPIs.cc",
       	"src/AudioIO.cc",
-      	"src/PaContext.cc"
+      	"src/PaContext.cc",
+      	"src/IOPump.cc",
+      	"src/PaHost.cc",
+      	"src/DeviceWatcher.cc",
+      	"src/SampleConvert.cc",
+      	"src/Resampler.cc",
+      	"src/PaBridge.cc",
+      	"src/AudioBridge.cc",
+      	"src/Mixer.cc",
+      	"src/EventLog.cc",
+      	"src/Recorder.cc",
+      	"src/FilePlayer.cc",
+      	"src/StreamManager.cc",
+      	"src/AudioStreamManager.cc",
+      	"src/NullDevice.cc",
+      	"src/ThreadPriority.cc",
+      	"src/InsertChain.cc"
       ],
       "include_dirs": [
         "<!@(node -p \"require('node-addon-api').include\")",
@@ -33,7 +53,8 @@
             },
             "link_settings": {
               "libraries": [
-                "<@(module_root_dir)/build/Release/libportaudio.dylib"
+                "<@(module_root_dir)/build/Release/libportaudio.dylib",
+                "$(SDKROOT)/System/Library/Frameworks/CoreAudio.framework"
               ]
             },
             "copies": [
@@ -59,7 +80,8 @@
               }
             },
             "libraries": [
-               "-l../portaudio/bin/portaudio_x64.lib"
+               "-l../portaudio/bin/portaudio_x64.lib",
+               "-lavrt.lib"
             ],
             "copies": [
               {
@@ -133,5 +155,58 @@
         ]
       ]
     }
+  ],
+  "conditions": [
+    [
+      'naudiodon_bench==1', {
+        "targets": [
+          {
+            "target_name": "naudiodon_bench",
+            "type": "executable",
+            "sources": [
+              "bench/PipelineBench.cc",
+              "src/SampleConvert.cc"
+            ],
+            "conditions": [
+              [
+                'OS=="mac"', {
+                  'xcode_settings': {
+                    'MACOSX_DEPLOYMENT_TARGET': '10.7',
+                    'OTHER_CPLUSPLUSFLAGS': [
+                      '-std=c++11',
+                      '-stdlib=libc++',
+                      '-fexceptions'
+                    ]
+                  }
+                }
+              ],
+              [
+                'OS=="win"', {
+                  "msvs_settings": {
+                    "VCCLCompilerTool": {
+                      "ExceptionHandling": 1
+                    }
+                  }
+                }
+              ],
+              [
+                'OS=="linux"', {
+                  "cflags_cc!": [
+                    "-fno-exceptions"
+                  ],
+                  "cflags_cc": [
+                    "-std=c++11",
+                    "-fexceptions"
+                  ],
+                  "ldflags": [
+                    "-pthread"
+                  ]
+                }
+              ]
+            ]
+          }
+        ]
+      }
+    ]
   ]
 }
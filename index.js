@@ -25,11 +25,33 @@ exports.SampleFormat16Bit = 16;
 exports.SampleFormat24Bit = 24;
 exports.SampleFormat32Bit = 32;
 
+exports.StreamFlagClipOff = 0x1;
+exports.StreamFlagDitherOff = 0x2;
+exports.StreamFlagNeverDropInput = 0x4;
+exports.StreamFlagPrimeOutputBuffersUsingStreamCallback = 0x8;
+
 exports.getDevices = portAudioBindings.getDevices;
 exports.getHostAPIs = portAudioBindings.getHostAPIs;
+exports.refreshDevices = portAudioBindings.refreshDevices;
+
+exports.SharedRing = require('./sharedRing.js');
+
+exports.watchDevices = cb => {
+  portAudioBindings.watchDevices(() => {
+    const changes = portAudioBindings.refreshDevices();
+    if (typeof cb === 'function')
+      cb(changes);
+  });
+};
+exports.unwatchDevices = () => portAudioBindings.unwatchDevices();
+
+const managerAdonKey = Symbol('managerAdon');
 
 function AudioIO(options) {
-  const audioIOAdon = new portAudioBindings.AudioIO(options);
+  // streams sharing a manager pass its native object to the addon
+  const adonOptions = options.manager ?
+    Object.assign({}, options, { manager: options.manager[managerAdonKey] }) : options;
+  const audioIOAdon = new portAudioBindings.AudioIO(adonOptions);
   let ioStream;
 
   const doRead = size => {
@@ -77,6 +99,112 @@ function AudioIO(options) {
 
   ioStream.start = () => audioIOAdon.start();
 
+  ioStream.getPoolStats = () => audioIOAdon.getPoolStats();
+  ioStream.getStreamInfo = () => audioIOAdon.getStreamInfo();
+  ioStream.getStats = () => audioIOAdon.getStats();
+  ioStream.getTimingStats = () => audioIOAdon.getTimingStats();
+  ioStream.resetTimingStats = () => audioIOAdon.resetTimingStats();
+  ioStream.getThreadInfo = () => audioIOAdon.getThreadInfo();
+  // the SharedArrayBuffer of a direction opened with sharedRing, to post to a worker
+  ioStream.getSharedRing = direction => audioIOAdon.getSharedRing(direction);
+  ioStream.setInsertGain = (direction, index, gain, mute) =>
+    audioIOAdon.setInsertGain(direction, index, gain, !!mute);
+
+  if (readable) {
+    // fills the caller's buffer, resolving with { bytes, frames, timestamp, finished }
+    ioStream.readInto = (target, cb) => {
+      if (typeof cb === 'function')
+        return audioIOAdon.readInto(target, (err, result) => cb(err ? new Error(err) : null, result));
+      return new Promise((resolve, reject) =>
+        audioIOAdon.readInto(target, (err, result) => err ? reject(new Error(err)) : resolve(result)));
+    };
+
+    // async iterator over a fixed set of buffers, each yielded view is reused once the set wraps round
+    ioStream.reads = (readOptions = {}) => {
+      const bytes = readOptions.bytes || options.inOptions.highwaterMark || 16384;
+      const buffers = [];
+      for (let b = 0; b < (readOptions.buffers || 2); ++b)
+        buffers.push(Buffer.allocUnsafeSlow(bytes));
+      let next = 0;
+      let done = false;
+      return {
+        [Symbol.asyncIterator]() { return this; },
+        next: async () => {
+          if (done)
+            return { done: true, value: undefined };
+          const buffer = buffers[next];
+          next = (next + 1) % buffers.length;
+          const result = await ioStream.readInto(buffer);
+          done = result.finished;
+          if (0 === result.bytes)
+            return { done: true, value: undefined };
+          result.buffer = buffer.subarray(0, result.bytes);
+          return { done: false, value: result };
+        },
+        return: async () => {
+          done = true;
+          return { done: true, value: undefined };
+        }
+      };
+    };
+  }
+
+  ioStream.addSource = (sourceOptions = {}) => {
+    let gain = typeof sourceOptions.gain === 'number' ? sourceOptions.gain : 1.0;
+    let pan = typeof sourceOptions.pan === 'number' ? sourceOptions.pan : 0.0;
+    // the generation keeps this source from reaching whichever source takes the slot next
+    const { slot, generation } = audioIOAdon.addSource(gain, pan);
+    let removed = false;
+    const remove = flag => {
+      if (!removed)
+        audioIOAdon.removeSource(slot, generation, flag);
+      removed = true;
+    };
+
+    const source = new Writable({
+      highWaterMark: sourceOptions.highwaterMark || options.outOptions.highwaterMark || 16384,
+      decodeStrings: false,
+      objectMode: false,
+      write: (chunk, encoding, cb) => audioIOAdon.writeSource(slot, generation, chunk, err => cb(err)),
+      final: cb => {
+        remove('WAIT');
+        cb();
+      },
+      destroy: (err, cb) => {
+        remove('ABORT');
+        cb(err);
+      }
+    });
+
+    source.setGain = g => audioIOAdon.setSource(slot, generation, gain = g, pan);
+    source.setPan = p => audioIOAdon.setSource(slot, generation, gain, pan = p);
+    return source;
+  };
+
+  // the input is written to disk natively, progress arrives as 'recording' events
+  ioStream.startRecording = recordOptions =>
+    audioIOAdon.startRecording(recordOptions, report => ioStream.emit('recording', report));
+  ioStream.rotateRecording = path => audioIOAdon.rotateRecording(path);
+  ioStream.stopRecording = cb => {
+    audioIOAdon.stopRecording(() => {
+      if (typeof cb === 'function')
+        cb();
+    });
+  }
+
+  // a file is played natively from a memory mapping, progress arrives as 'playback' events
+  ioStream.startPlayback = playbackOptions =>
+    audioIOAdon.startPlayback(playbackOptions, report => ioStream.emit('playback', report));
+  ioStream.seekPlayback = frame => audioIOAdon.seekPlayback(frame);
+  ioStream.setPlaybackLoop = (loop, loopStart = 0, loopEnd = 0) =>
+    audioIOAdon.setPlaybackLoop(loop, loopStart, loopEnd);
+  ioStream.stopPlayback = cb => {
+    audioIOAdon.stopPlayback(() => {
+      if (typeof cb === 'function')
+        cb();
+    });
+  }
+
   ioStream.quit = cb => {
     audioIOAdon.quit('WAIT', () => {
       if (typeof cb === 'function')
@@ -94,8 +222,64 @@ function AudioIO(options) {
   ioStream.on('close', () => ioStream.quit());
   ioStream.on('finish', () => ioStream.quit());
 
+  // callback events are only collected once something listens for them
+  let watching = false;
+  ioStream.on('newListener', event => {
+    if (((event === 'streamEvent') || (event === 'lowWater')) && !watching) {
+      watching = true;
+      audioIOAdon.watchEvents(ev => {
+        ioStream.emit('streamEvent', ev);
+        // the output ring has drained below lowWaterFrames, with the frames left as the value
+        if (ev.type === 'outputLowWater')
+          ioStream.emit('lowWater', ev.value || 0);
+      });
+    }
+  });
+  ioStream.on('close', () => audioIOAdon.unwatchEvents());
+
   ioStream.on('error', err => console.error('AudioIO:', err));
 
   return ioStream;
 }
 exports.AudioIO = AudioIO;
+
+function AudioBridge(options) {
+  const audioBridgeAdon = new portAudioBindings.AudioBridge(options);
+  const bridge = {};
+
+  bridge.start = () => audioBridgeAdon.start();
+  bridge.getStats = () => audioBridgeAdon.getStats();
+
+  bridge.quit = cb => {
+    audioBridgeAdon.quit('WAIT', () => {
+      if (typeof cb === 'function')
+        cb();
+    });
+  }
+
+  bridge.abort = cb => {
+    audioBridgeAdon.quit('ABORT', () => {
+      if (typeof cb === 'function')
+        cb();
+    });
+  }
+
+  return bridge;
+}
+exports.AudioBridge = AudioBridge;
+
+function StreamManager(options = {}) {
+  const managerAdon = new portAudioBindings.AudioStreamManager(options);
+  const manager = { [managerAdonKey]: managerAdon };
+
+  manager.getStats = () => managerAdon.getStats();
+  manager.quit = cb => {
+    managerAdon.quit(() => {
+      if (typeof cb === 'function')
+        cb();
+    });
+  }
+
+  return manager;
+}
+exports.StreamManager = StreamManager;
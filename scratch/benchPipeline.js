@@ -0,0 +1,89 @@
+/* Copyright 2019 Streampunk Media Ltd.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+// Drives a duplex stream on the null device and reports throughput, capture latency,
+// pool allocations and xruns. Needs no sound hardware, so it can run in CI.
+// node scratch/benchPipeline.js [--seconds 10] [--rate 48000] [--channels 2] [--format 16]
+//   [--frames 256] [--speed 1] [--zeroCopy]
+
+const portAudio = require('../index.js');
+
+const args = { seconds: 10, rate: 48000, channels: 2, format: 16, frames: 256, speed: 1, zeroCopy: false };
+for (let i = 2; i < process.argv.length; i++) {
+  const key = process.argv[i].replace(/^--/, '');
+  if (!(key in args)) {
+    console.error(`Unknown option ${process.argv[i]}`);
+    process.exit(1);
+  }
+  if (typeof args[key] === 'boolean')
+    args[key] = true;
+  else
+    args[key] = +process.argv[++i];
+}
+
+const streamOptions = {
+  channelCount: args.channels,
+  sampleFormat: args.format,
+  sampleRate: args.rate,
+  framesPerBuffer: args.frames,
+  nullDevice: true,
+  nullDeviceSpeed: args.speed,
+  quiet: true
+};
+
+const ai = new portAudio.AudioIO({
+  inOptions: Object.assign({ zeroCopy: args.zeroCopy }, streamOptions),
+  outOptions: streamOptions
+});
+
+// latencies in ms from the ADC time of the first frame to its arrival in JavaScript
+const latencies = [];
+let readBytes = 0;
+ai.on('data', buf => {
+  latencies.push((ai.getStreamInfo().currentTime - buf.timestamp) * 1000);
+  readBytes += buf.length;
+  if (!ai.write(buf))
+    ai.pause();
+});
+ai.on('drain', () => ai.resume());
+ai.on('error', err => console.error(err));
+
+const startTime = process.hrtime();
+const startMisses = ai.getPoolStats().misses;
+ai.start();
+
+setTimeout(() => {
+  const elapsed = process.hrtime(startTime);
+  const secs = elapsed[0] + elapsed[1] / 1e9;
+  const stats = ai.getStats();
+  const misses = ai.getPoolStats().misses - startMisses;
+  ai.abort(() => {
+    latencies.sort((a, b) => a - b);
+    const pick = p => latencies.length ? latencies[Math.min(latencies.length - 1, Math.floor(p * latencies.length))] : 0;
+    const mean = latencies.reduce((sum, l) => sum + l, 0) / (latencies.length || 1);
+    console.log(JSON.stringify({
+      options: args,
+      seconds: +secs.toFixed(3),
+      callbacks: stats.callbacks,
+      cpuLoad: +stats.cpuLoad.toFixed(4),
+      readMBps: +(readBytes / secs / 1e6).toFixed(3),
+      writeMBps: +(stats.outBytes / secs / 1e6).toFixed(3),
+      buffers: latencies.length,
+      latencyMs: { mean: +mean.toFixed(3), p50: +pick(0.5).toFixed(3), p99: +pick(0.99).toFixed(3), max: +pick(1).toFixed(3) },
+      allocationsPerSec: +(misses / secs).toFixed(2),
+      xruns: { inOverruns: stats.inOverruns, outUnderruns: stats.outUnderruns }
+    }, null, 2));
+  });
+}, args.seconds * 1000);
@@ -0,0 +1,108 @@
+/* Copyright 2019 Streampunk Media Ltd.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+// Reads or writes the ring of an AudioIO opened with sharedRing, from any thread that has
+// its SharedArrayBuffer. Uses no addon, so it can be required inside a worker_thread.
+// The addon cannot wake Atomics.wait, so waiting sleeps until the data is due instead.
+
+// header layout in Int32 words, must match src/SharedRing.h
+const WRITE_POS = 0;
+const READ_POS = 16;
+const CAPACITY = 32;
+const FRAME_BYTES = 33;
+const CHANNELS = 34;
+const SAMPLE_FORMAT = 35;
+const SAMPLE_RATE = 36;
+const ACTIVE = 37;
+const HEADER_WORDS = 64;
+
+const toBytes = view => view instanceof Uint8Array ? view :
+  ArrayBuffer.isView(view) ? new Uint8Array(view.buffer, view.byteOffset, view.byteLength) : new Uint8Array(view);
+
+class SharedRing {
+  constructor(sab) {
+    this.header = new Int32Array(sab, 0, HEADER_WORDS);
+    this.capacity = this.header[CAPACITY];
+    this.frameBytes = this.header[FRAME_BYTES];
+    this.channelCount = this.header[CHANNELS];
+    this.sampleFormat = this.header[SAMPLE_FORMAT];
+    this.sampleRate = this.header[SAMPLE_RATE];
+    this.data = new Uint8Array(sab, HEADER_WORDS * 4, this.capacity);
+  }
+
+  // true while the device is running
+  get active() { return 1 === Atomics.load(this.header, ACTIVE); }
+
+  readAvailable() {
+    return (Atomics.load(this.header, WRITE_POS) - Atomics.load(this.header, READ_POS)) >>> 0;
+  }
+  writeAvailable() {
+    return this.capacity - this.readAvailable();
+  }
+
+  // consumer only - copies out as many whole frames as fit in dst, returns the bytes read
+  read(dst) {
+    const bytes = toBytes(dst);
+    const pos = Atomics.load(this.header, READ_POS) >>> 0;
+    let count = Math.min(bytes.length, this.readAvailable());
+    count -= count % this.frameBytes;
+    const off = pos & (this.capacity - 1);
+    const first = Math.min(count, this.capacity - off);
+    bytes.set(this.data.subarray(off, off + first));
+    bytes.set(this.data.subarray(0, count - first), first);
+    Atomics.store(this.header, READ_POS, (pos + count) | 0);
+    return count;
+  }
+
+  // producer only - copies in as many whole frames of src as there is room for, returns the bytes written
+  write(src) {
+    const bytes = toBytes(src);
+    const pos = Atomics.load(this.header, WRITE_POS) >>> 0;
+    let count = Math.min(bytes.length, this.writeAvailable());
+    count -= count % this.frameBytes;
+    const off = pos & (this.capacity - 1);
+    const first = Math.min(count, this.capacity - off);
+    this.data.set(bytes.subarray(0, first), off);
+    this.data.set(bytes.subarray(first, count));
+    Atomics.store(this.header, WRITE_POS, (pos + count) | 0);
+    return count;
+  }
+
+  // blocks until numBytes can be read, the device stops or timeoutMs passes, returns the bytes available
+  waitRead(numBytes, timeoutMs = Infinity) {
+    return this.wait(() => this.readAvailable(), WRITE_POS, Math.min(numBytes, this.capacity), timeoutMs);
+  }
+  // blocks until numBytes can be written, the device stops or timeoutMs passes, returns the room available
+  waitWrite(numBytes, timeoutMs = Infinity) {
+    return this.wait(() => this.writeAvailable(), READ_POS, Math.min(numBytes, this.capacity), timeoutMs);
+  }
+
+  wait(available, index, numBytes, timeoutMs) {
+    const deadline = Date.now() + timeoutMs;
+    let avail = available();
+    while ((avail < numBytes) && this.active) {
+      // sleep for as long as the device takes to move the missing frames, at least a millisecond
+      const dueMs = (numBytes - avail) / this.frameBytes / this.sampleRate * 1000;
+      const sleepMs = Math.min(Math.max(1, dueMs), deadline - Date.now());
+      if (sleepMs <= 0)
+        break;
+      Atomics.wait(this.header, index, Atomics.load(this.header, index), sleepMs);
+      avail = available();
+    }
+    return avail;
+  }
+}
+
+module.exports = SharedRing;
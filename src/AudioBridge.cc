@@ -0,0 +1,116 @@
+/* Copyright 2019 Streampunk Media Ltd.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#include "AudioBridge.h"
+#include "PaBridge.h"
+#include "PaContext.h"
+
+namespace streampunk {
+
+Napi::FunctionReference AudioBridge::constructor;
+
+class BridgeQuitWorker : public Napi::AsyncWorker {
+  public:
+    BridgeQuitWorker(std::shared_ptr<PaBridge> paBridge, PaContext::eStopFlag stopFlag, const Napi::Function& callback)
+      : AsyncWorker(callback, "AudioBridgeQuit"), mPaBridge(paBridge), mStopFlag(stopFlag)
+    { }
+    ~BridgeQuitWorker() {}
+
+    void Execute() {
+      mPaBridge->stop(mStopFlag);
+    }
+
+    void OnOK() {
+      Napi::HandleScope scope(Env());
+      Callback().Call({});
+    }
+
+  private:
+    std::shared_ptr<PaBridge> mPaBridge;
+    const PaContext::eStopFlag mStopFlag;
+};
+
+AudioBridge::AudioBridge(const Napi::CallbackInfo& info) 
+  : Napi::ObjectWrap<AudioBridge>(info) {
+  Napi::Env env = info.Env();
+
+  if ((info.Length() != 1) || !info[0].IsObject())
+    throw Napi::Error::New(env, "AudioBridge constructor expects an options object argument");
+  
+  Napi::Object optionsObj = info[0].As<Napi::Object>();
+  if (!optionsObj.Has("inOptions") || !optionsObj.Has("outOptions"))
+    throw Napi::Error::New(env, "AudioBridge constructor expects both an inOptions and an outOptions object argument");
+  Napi::Object inOptions = optionsObj.Get("inOptions").As<Napi::Object>();
+  Napi::Object outOptions = optionsObj.Get("outOptions").As<Napi::Object>();
+  Napi::Object bridgeOptions = Napi::Object::New(env);
+  if (optionsObj.Has("bridgeOptions"))
+    bridgeOptions = optionsObj.Get("bridgeOptions").As<Napi::Object>();
+
+  mPaBridge = std::make_shared<PaBridge>(env, inOptions, outOptions, bridgeOptions);
+}
+AudioBridge::~AudioBridge() {}
+
+Napi::Value AudioBridge::Start(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  mPaBridge->start(env);
+  return env.Undefined();
+}
+
+Napi::Value AudioBridge::Quit(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  if (info.Length() != 2)
+    throw Napi::Error::New(env, "AudioBridge Quit expects 2 arguments");
+  if (!info[0].IsString())
+    throw Napi::TypeError::New(env, "AudioBridge Quit expects a valid string as the first parameter");
+  if (!info[1].IsFunction())
+    throw Napi::TypeError::New(env, "AudioBridge Quit expects a valid callback as the second parameter");
+
+  std::string stopFlagStr = info[0].As<Napi::String>().Utf8Value();
+  if ((0 != stopFlagStr.compare("WAIT")) && (0 != stopFlagStr.compare("ABORT")))
+    throw Napi::Error::New(env, "AudioBridge Quit expects \'WAIT\' or \'ABORT\' as the first argument");
+  PaContext::eStopFlag stopFlag = (0 == stopFlagStr.compare("WAIT")) ? 
+    PaContext::eStopFlag::WAIT : PaContext::eStopFlag::ABORT;
+
+  Napi::Function callback = info[1].As<Napi::Function>();
+  BridgeQuitWorker *quitWork = new BridgeQuitWorker(mPaBridge, stopFlag, callback);
+  quitWork->Queue();
+  return env.Undefined();
+}
+
+Napi::Value AudioBridge::GetStats(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::Object result = Napi::Object::New(env);
+  result.Set(Napi::String::New(env, "ratioAdjust"), Napi::Number::New(env, mPaBridge->ratioAdjust()));
+  result.Set(Napi::String::New(env, "driftPpm"), Napi::Number::New(env, mPaBridge->driftPpm()));
+  result.Set(Napi::String::New(env, "latencyMs"), Napi::Number::New(env, mPaBridge->latencyMs()));
+  result.Set(Napi::String::New(env, "inOverruns"), Napi::Number::New(env, mPaBridge->getInContext()->inOverruns()));
+  result.Set(Napi::String::New(env, "outUnderruns"), Napi::Number::New(env, mPaBridge->getOutContext()->outUnderruns()));
+  return result;
+}
+
+void AudioBridge::Init(Napi::Env env, Napi::Object exports) {
+  Napi::Function func = DefineClass(env, "AudioBridge", {
+    InstanceMethod("start", &AudioBridge::Start),
+    InstanceMethod("quit", &AudioBridge::Quit),
+    InstanceMethod("getStats", &AudioBridge::GetStats)
+  });
+
+  constructor = Napi::Persistent(func);
+  constructor.SuppressDestruct();
+
+  exports.Set("AudioBridge", func);
+}
+
+} // namespace streampunk
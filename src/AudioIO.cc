@@ -16,89 +16,445 @@
 #include "AudioIO.h"
 #include "PaContext.h"
 #include "Chunks.h"
-#include <map>
+#include "MemoryPool.h"
+#include "IOPump.h"
+#include "StreamManager.h"
+#include "AudioStreamManager.h"
+#include "Params.h"
+#include "Mixer.h"
+#include "Histogram.h"
+#include "Recorder.h"
+#include "FilePlayer.h"
+#include "InsertChain.h"
 
 namespace streampunk {
 
 Napi::FunctionReference AudioIO::constructor;
 
-static std::map<uint8_t*, std::shared_ptr<Chunk> > sOutstandingAllocs;
+// the chunk holds itself while wrapped, the hint lets the finalizer let go of it again
 static class AllocFinalizer {
 public:
-  void operator()(Napi::Env env, uint8_t* data) { sOutstandingAllocs.erase(data); }
+  void operator()(Napi::Env env, uint8_t* data, Chunk* chunk) { chunk->release(); }
 } sAllocFinalizer;
 
+static void readComplete(Napi::Env env, std::shared_ptr<PaContext> paContext,
+                         std::shared_ptr<Chunk> chunk, bool finished, Napi::Function callback) {
+  Napi::Value errVal = env.Null();
+  Napi::Object bufVal;
+  std::string errStr;
+  if (paContext->getErrStr(errStr, /*isInput*/true))
+    errVal = Napi::String::New(env, errStr);
+  if (chunk && chunk->numBytes()) {
+    bufVal = Napi::Buffer<uint8_t>::New(env, chunk->buf(), chunk->numBytes(), sAllocFinalizer, chunk.get());
+    chunk->retain(chunk);
+    bufVal.Set("timestamp", chunk->ts());
+    if (!paContext->getInOptions()->interleaved())
+      bufVal.Set("planeBytes", (double)(chunk->numBytes() / paContext->getInOptions()->numPlanes()));
+    if (paContext->getInOptions()->batching()) {
+      // pairs of frame offset and timestamp for each device period in the buffer
+      uint32_t frameBytes = paContext->getInOptions()->frameBytes();
+      const std::vector<TimeMark> &periods = chunk->periods();
+      Napi::Float64Array periodsVal = Napi::Float64Array::New(env, periods.size() * 2);
+      for (size_t i = 0; i < periods.size(); ++i) {
+        periodsVal[i * 2] = periods[i].pos / frameBytes;
+        periodsVal[i * 2 + 1] = periods[i].ts;
+      }
+      bufVal.Set("periods", periodsVal);
+    }
+  }
+  Napi::Boolean finishedVal = Napi::Boolean::New(env, finished);
+
+  callback.Call({errVal, bufVal, finishedVal});
+}
+
+// the memory behind a readInto target as it is now, zero bytes once its buffer is detached
+static uint8_t *targetData(Napi::Object target, size_t &numBytes) {
+  if (target.IsTypedArray()) {
+    Napi::TypedArray typedArray = target.As<Napi::TypedArray>();
+    numBytes = typedArray.ByteLength();
+    return (uint8_t *)typedArray.ArrayBuffer().Data() + typedArray.ByteOffset();
+  }
+  Napi::ArrayBuffer arrayBuffer = target.As<Napi::ArrayBuffer>();
+  numBytes = arrayBuffer.ByteLength();
+  return (uint8_t *)arrayBuffer.Data();
+}
+
+// ends a read or write begun on the JS thread once its job is done with the rings,
+// or with the input stage, or when the job is destroyed without having run
+class PendingClaim {
+  public:
+    PendingClaim(std::shared_ptr<PaContext> paContext, void (PaContext::*end)())
+      : mPaContext(paContext), mEnd(end) { }
+    ~PendingClaim() { release(); }
+
+    void release() {
+      if (mEnd)
+        (mPaContext.get()->*mEnd)();
+      mEnd = nullptr;
+    }
+
+  private:
+    std::shared_ptr<PaContext> mPaContext;
+    void (PaContext::*mEnd)();
+
+    PendingClaim(const PendingClaim &);
+};
+
+// the read is claimed until its samples have been copied out of the shared stage
+static void readIntoComplete(Napi::Env env, std::shared_ptr<PaContext> paContext, Napi::Object target,
+                             PendingClaim &claim, uint32_t numBytes, double ts, bool finished,
+                             Napi::Function callback) {
+  Napi::Value errVal = env.Null();
+  std::string errStr;
+  size_t dstBytes;
+  uint8_t *dst = targetData(target, dstBytes);
+  if (dstBytes < numBytes) {
+    errVal = Napi::String::New(env, "AudioIO ReadInto - the target was detached or shrunk before the read completed");
+    numBytes = 0;
+  } else if (paContext->getErrStr(errStr, /*isInput*/true))
+    errVal = Napi::String::New(env, errStr);
+  if (numBytes)
+    memcpy(dst, paContext->intoStage(numBytes), numBytes);
+  claim.release();
+  Napi::Object result = Napi::Object::New(env);
+  result.Set(Napi::String::New(env, "bytes"), Napi::Number::New(env, numBytes));
+  result.Set(Napi::String::New(env, "frames"), Napi::Number::New(env, numBytes / paContext->getInOptions()->frameBytes()));
+  result.Set(Napi::String::New(env, "timestamp"), Napi::Number::New(env, ts));
+  result.Set(Napi::String::New(env, "finished"), Napi::Boolean::New(env, finished));
+  callback.Call({errVal, result});
+}
+
+static void writeComplete(Napi::Env env, std::shared_ptr<PaContext> paContext, Napi::Function callback) {
+  std::string errStr;
+  if (paContext->getErrStr(errStr, /*isInput*/false))
+    callback.Call({Napi::String::New(env, errStr)});
+  else
+    callback.Call({env.Null()});
+}
+
 class ReadWorker : public Napi::AsyncWorker {
   public:
     ReadWorker(std::shared_ptr<PaContext> paContext, uint32_t numBytes, const Napi::Function& callback)
-      : AsyncWorker(callback, "AudioRead"), mPaContext(paContext), mNumBytes(numBytes), mFinished(false)
+      : AsyncWorker(callback, "AudioRead"), mPaContext(paContext), mNumBytes(numBytes), mFinished(false),
+        mClaim(paContext, &PaContext::endRead)
     { }
     ~ReadWorker() {}
 
     void Execute() {
       mChunk = mPaContext->pullInChunk(mNumBytes, mFinished);
+      mClaim.release();
     }
 
     void OnOK() {
       Napi::HandleScope scope(Env());
+      readComplete(Env(), mPaContext, mChunk, mFinished, Callback().Value());
+    }
 
-      Napi::Value errVal = Env().Null();
-      Napi::Object bufVal;
-      std::string errStr;
-      if (mPaContext->getErrStr(errStr, /*isInput*/true))
-        errVal = Napi::String::New(Env(), errStr);
-      if (mChunk && mChunk->numBytes()) {
-        sOutstandingAllocs.emplace(mChunk->buf(), mChunk);
-        bufVal = Napi::Buffer<uint8_t>::New(Env(), mChunk->buf(), mChunk->numBytes(), sAllocFinalizer);
-        bufVal.Set("timestamp", mChunk->ts());
-      }
-      Napi::Boolean finishedVal = Napi::Boolean::New(Env(), mFinished);
+  private:
+    std::shared_ptr<PaContext> mPaContext;
+    uint32_t mNumBytes;
+    std::shared_ptr<Chunk> mChunk;
+    bool mFinished;
+    PendingClaim mClaim;
+};
+
+// the target may be transferred or detached while the read waits, so the samples are staged in
+// a pooled block and only copied into the target, as it is then, back on the JS thread
+class ReadIntoWorker : public Napi::AsyncWorker {
+  public:
+    ReadIntoWorker(std::shared_ptr<PaContext> paContext, Napi::Object target, uint32_t dstBytes,
+                   const Napi::Function& callback)
+      : AsyncWorker(callback, "AudioReadInto"), mPaContext(paContext), mTarget(Napi::Persistent(target)),
+        mDstBytes(dstBytes), mNumBytes(0), mTs(0.0), mFinished(false),
+        mClaim(paContext, &PaContext::endRead)
+    { }
+    ~ReadIntoWorker() {}
 
-      Callback().Call({errVal, bufVal, finishedVal});
+    void Execute() {
+      mNumBytes = mPaContext->pullInto(mPaContext->intoStage(mDstBytes), mDstBytes, mFinished, mTs);
+    }
+
+    void OnOK() {
+      Napi::HandleScope scope(Env());
+      readIntoComplete(Env(), mPaContext, mTarget.Value(), mClaim, mNumBytes, mTs, mFinished, Callback().Value());
     }
 
   private:
     std::shared_ptr<PaContext> mPaContext;
+    Napi::ObjectReference mTarget;
+    uint32_t mDstBytes;
     uint32_t mNumBytes;
-    std::shared_ptr<Chunk> mChunk;
+    double mTs;
     bool mFinished;
+    PendingClaim mClaim;
 };
 
 class WriteWorker : public Napi::AsyncWorker {
   public:
     WriteWorker(std::shared_ptr<PaContext> paContext, std::shared_ptr<Chunk> chunk, const Napi::Function& callback)
-      : AsyncWorker(callback, "AudioWrite"), mPaContext(paContext), mChunk(chunk)
+      : AsyncWorker(callback, "AudioWrite"), mPaContext(paContext), mChunk(chunk),
+        mClaim(paContext, &PaContext::endWrite)
     { }
     ~WriteWorker() {}
 
     void Execute() {
       mPaContext->pushOutChunk(mChunk);
+      mClaim.release();
     }
 
     void OnOK() {
       Napi::HandleScope scope(Env());
-      std::string errStr;
-      if (mPaContext->getErrStr(errStr, /*isInput*/false))
-        Callback().Call({Napi::String::New(Env(), errStr)});
+      writeComplete(Env(), mPaContext, Callback().Value());
+    }
+
+  private:
+    std::shared_ptr<PaContext> mPaContext;
+    std::shared_ptr<Chunk> mChunk;
+    PendingClaim mClaim;
+};
+
+class ReadJob : public PumpJob {
+  public:
+    ReadJob(std::shared_ptr<PaContext> paContext, uint32_t numBytes, const Napi::Function& callback)
+      : PumpJob(callback), mPaContext(paContext), mNumBytes(numBytes), mFinished(false),
+        mClaim(paContext, &PaContext::endRead)
+    { }
+    ~ReadJob() {}
+
+    bool ready() {
+      return mPaContext->inputReady(mNumBytes);
+    }
+
+    void Execute() {
+      mChunk = mPaContext->pullInChunk(mNumBytes, mFinished);
+      mClaim.release();
+    }
+
+    void OnOK(Napi::Env env) {
+      readComplete(env, mPaContext, mChunk, mFinished, mCallback.Value());
+    }
+
+  private:
+    std::shared_ptr<PaContext> mPaContext;
+    uint32_t mNumBytes;
+    std::shared_ptr<Chunk> mChunk;
+    bool mFinished;
+    PendingClaim mClaim;
+};
+
+class ReadIntoJob : public PumpJob {
+  public:
+    ReadIntoJob(std::shared_ptr<PaContext> paContext, Napi::Object target, uint32_t dstBytes,
+                const Napi::Function& callback)
+      : PumpJob(callback), mPaContext(paContext), mTarget(Napi::Persistent(target)),
+        mDstBytes(dstBytes), mNumBytes(0), mTs(0.0), mFinished(false),
+        mClaim(paContext, &PaContext::endRead)
+    { }
+    ~ReadIntoJob() {}
+
+    bool ready() {
+      return mPaContext->inputReady(mDstBytes);
+    }
+
+    void Execute() {
+      mNumBytes = mPaContext->pullInto(mPaContext->intoStage(mDstBytes), mDstBytes, mFinished, mTs);
+    }
+
+    void OnOK(Napi::Env env) {
+      readIntoComplete(env, mPaContext, mTarget.Value(), mClaim, mNumBytes, mTs, mFinished, mCallback.Value());
+    }
+
+  private:
+    std::shared_ptr<PaContext> mPaContext;
+    Napi::ObjectReference mTarget;
+    uint32_t mDstBytes;
+    uint32_t mNumBytes;
+    double mTs;
+    bool mFinished;
+    PendingClaim mClaim;
+};
+
+class WriteJob : public PumpJob {
+  public:
+    // a piecewise job pushes no more than a quarter of the ring each time it runs,
+    // so that a chunk larger than the ring never blocks a shared thread
+    WriteJob(std::shared_ptr<PaContext> paContext, std::shared_ptr<Chunk> chunk, const Napi::Function& callback,
+             bool piecewise = false)
+      : PumpJob(callback), mPaContext(paContext), mChunk(chunk),
+        mClaim(paContext, &PaContext::endWrite), mPieceBytes(chunk->numBytes()), mOffset(0)
+    {
+      if (piecewise) {
+        uint32_t frameBytes = paContext->getOutOptions()->frameBytes();
+        uint32_t pieceFrames = std::max<uint32_t>(1, paContext->getOutOptions()->ringFrames() / 4);
+        mPieceBytes = std::max<uint32_t>(frameBytes, pieceFrames * frameBytes);
+      }
+    }
+    ~WriteJob() {}
+
+    bool ready() {
+      return mPaContext->outputReady(nextBytes());
+    }
+
+    bool done() {
+      return mOffset >= mChunk->numBytes();
+    }
+
+    void Execute() {
+      uint32_t numBytes = nextBytes();
+      if (numBytes == mChunk->numBytes())
+        mPaContext->pushOutChunk(mChunk);
       else
-        Callback().Call({Env().Null()});
+        mPaContext->pushOutChunk(std::make_shared<Chunk>(Memory::makeNew(mChunk->buf() + mOffset, numBytes),
+                                                         mOffset ? 0.0 : mChunk->ts()));
+      mOffset += numBytes;
+      if (done())
+        mClaim.release();
+    }
+
+    void OnOK(Napi::Env env) {
+      writeComplete(env, mPaContext, mCallback.Value());
     }
 
   private:
     std::shared_ptr<PaContext> mPaContext;
     std::shared_ptr<Chunk> mChunk;
+    PendingClaim mClaim;
+    uint32_t mPieceBytes;
+    uint32_t mOffset;
+
+    uint32_t nextBytes() const {
+      return std::min<uint32_t>(mPieceBytes, mChunk->numBytes() - mOffset);
+    }
+};
+
+static Napi::Object makeHistogram(Napi::Env env, std::shared_ptr<Histogram> hist) {
+  Napi::Object result = Napi::Object::New(env);
+  result.Set(Napi::String::New(env, "count"), Napi::Number::New(env, (double)hist->total()));
+  result.Set(Napi::String::New(env, "min"), Napi::Number::New(env, hist->min()));
+  result.Set(Napi::String::New(env, "max"), Napi::Number::New(env, hist->max()));
+  result.Set(Napi::String::New(env, "mean"), Napi::Number::New(env, hist->mean()));
+  // pairs of exclusive upper bound and count for each bucket that has been hit
+  Napi::Array buckets = Napi::Array::New(env);
+  for (uint32_t b = 0; b < Histogram::sNumBuckets; ++b) {
+    uint32_t count = hist->count(b);
+    if (!count)
+      continue;
+    Napi::Array bucket = Napi::Array::New(env, 2);
+    bucket.Set((uint32_t)0, Napi::Number::New(env, Histogram::upperBound(b)));
+    bucket.Set((uint32_t)1, Napi::Number::New(env, count));
+    buckets.Set(buckets.Length(), bucket);
+  }
+  result.Set(Napi::String::New(env, "buckets"), buckets);
+  return result;
+}
+
+static Napi::Object makeThreadReport(Napi::Env env, const ThreadPriority::Report &report) {
+  Napi::Object result = Napi::Object::New(env);
+  result.Set(Napi::String::New(env, "priority"), Napi::String::New(env, ThreadPriority::priorityName(report.priority)));
+  result.Set(Napi::String::New(env, "level"), Napi::Number::New(env, report.level));
+  Napi::Array cpus = Napi::Array::New(env);
+  for (uint32_t cpu = 0; cpu < 64; ++cpu)
+    if (report.cpuMask & ((uint64_t)1 << cpu))
+      cpus.Set(cpus.Length(), Napi::Number::New(env, cpu));
+  result.Set(Napi::String::New(env, "cpus"), cpus);
+  if (report.error)
+    result.Set(Napi::String::New(env, "error"), Napi::String::New(env, ThreadPriority::errorString(report.error)));
+  return result;
+}
+
+// one entry per meter insert, each with the peak since the last read and the RMS of every channel
+static Napi::Array makeMeters(Napi::Env env, std::shared_ptr<InsertChain> inserts) {
+  Napi::Array result = Napi::Array::New(env);
+  std::vector<float> peak;
+  std::vector<float> rms;
+  for (uint32_t m = 0; m < inserts->numMeters(); ++m) {
+    inserts->readMeter(m, peak, rms);
+    Napi::Array peakArr = Napi::Array::New(env, peak.size());
+    Napi::Array rmsArr = Napi::Array::New(env, rms.size());
+    for (uint32_t c = 0; c < peak.size(); ++c) {
+      peakArr.Set(c, Napi::Number::New(env, peak[c]));
+      rmsArr.Set(c, Napi::Number::New(env, rms[c]));
+    }
+    Napi::Object meter = Napi::Object::New(env);
+    meter.Set(Napi::String::New(env, "peak"), peakArr);
+    meter.Set(Napi::String::New(env, "rms"), rmsArr);
+    result.Set(m, meter);
+  }
+  return result;
+}
+
+static void sourceWriteComplete(Napi::Env env, bool written, Napi::Function callback) {
+  if (written)
+    callback.Call({env.Null()});
+  else
+    callback.Call({Napi::String::New(env, "Mixer source was removed before the write completed")});
+}
+
+class SourceWriteWorker : public Napi::AsyncWorker {
+  public:
+    SourceWriteWorker(std::shared_ptr<Mixer> mixer, uint32_t id, uint32_t generation, std::shared_ptr<Chunk> chunk,
+                      const Napi::Function& callback)
+      : AsyncWorker(callback, "AudioSourceWrite"), mMixer(mixer), mId(id), mGeneration(generation), mChunk(chunk), mWritten(false)
+    { }
+    ~SourceWriteWorker() {}
+
+    void Execute() {
+      mWritten = mMixer->write(mId, mGeneration, mChunk->buf(), mChunk->numBytes());
+    }
+
+    void OnOK() {
+      Napi::HandleScope scope(Env());
+      sourceWriteComplete(Env(), mWritten, Callback().Value());
+    }
+
+  private:
+    std::shared_ptr<Mixer> mMixer;
+    const uint32_t mId;
+    const uint32_t mGeneration;
+    std::shared_ptr<Chunk> mChunk;
+    bool mWritten;
+};
+
+class SourceWriteJob : public PumpJob {
+  public:
+    SourceWriteJob(std::shared_ptr<Mixer> mixer, uint32_t id, uint32_t generation, std::shared_ptr<Chunk> chunk,
+                   const Napi::Function& callback)
+      : PumpJob(callback), mMixer(mixer), mId(id), mGeneration(generation), mChunk(chunk), mWritten(false)
+    { }
+    ~SourceWriteJob() {}
+
+    void Execute() {
+      mWritten = mMixer->write(mId, mGeneration, mChunk->buf(), mChunk->numBytes());
+    }
+
+    void OnOK(Napi::Env env) {
+      sourceWriteComplete(env, mWritten, mCallback.Value());
+    }
+
+  private:
+    std::shared_ptr<Mixer> mMixer;
+    const uint32_t mId;
+    const uint32_t mGeneration;
+    std::shared_ptr<Chunk> mChunk;
+    bool mWritten;
 };
 
 class QuitWorker : public Napi::AsyncWorker {
   public:
-    QuitWorker(std::shared_ptr<PaContext> paContext, PaContext::eStopFlag stopFlag, const Napi::Function& callback)
-      : AsyncWorker(callback, "AudioIOQuit"), mPaContext(paContext), mStopFlag(stopFlag)
+    QuitWorker(std::shared_ptr<PaContext> paContext, PaContext::eStopFlag stopFlag,
+               std::shared_ptr<IOPump> inPump, std::shared_ptr<IOPump> outPump, const Napi::Function& callback)
+      : AsyncWorker(callback, "AudioIOQuit"), mPaContext(paContext), mStopFlag(stopFlag),
+        mInPump(inPump), mOutPump(outPump)
     { }
     ~QuitWorker() {}
 
     void Execute() {
       mPaContext->stop(mStopFlag);
       mPaContext->quit();
+      if (mInPump)
+        mInPump->quit();
+      if (mOutPump)
+        mOutPump->quit();
     }
 
     void OnOK() {
@@ -109,6 +465,50 @@ class QuitWorker : public Napi::AsyncWorker {
   private:
     std::shared_ptr<PaContext> mPaContext;
     const PaContext::eStopFlag mStopFlag;
+    std::shared_ptr<IOPump> mInPump;
+    std::shared_ptr<IOPump> mOutPump;
+};
+
+class RecordStopWorker : public Napi::AsyncWorker {
+  public:
+    RecordStopWorker(std::shared_ptr<Recorder> recorder, const Napi::Function& callback)
+      : AsyncWorker(callback, "AudioRecordStop"), mRecorder(recorder)
+    { }
+    ~RecordStopWorker() {}
+
+    void Execute() {
+      if (mRecorder)
+        mRecorder->stop();
+    }
+
+    void OnOK() {
+      Napi::HandleScope scope(Env());
+      Callback().Call({});
+    }
+
+  private:
+    std::shared_ptr<Recorder> mRecorder;
+};
+
+class PlaybackStopWorker : public Napi::AsyncWorker {
+  public:
+    PlaybackStopWorker(std::shared_ptr<FilePlayer> player, const Napi::Function& callback)
+      : AsyncWorker(callback, "AudioPlaybackStop"), mPlayer(player)
+    { }
+    ~PlaybackStopWorker() {}
+
+    void Execute() {
+      if (mPlayer)
+        mPlayer->stop();
+    }
+
+    void OnOK() {
+      Napi::HandleScope scope(Env());
+      Callback().Call({});
+    }
+
+  private:
+    std::shared_ptr<FilePlayer> mPlayer;
 };
 
 AudioIO::AudioIO(const Napi::CallbackInfo& info) 
@@ -129,9 +529,48 @@ AudioIO::AudioIO(const Napi::CallbackInfo& info)
   if (inOptions.IsEmpty() && outOptions.IsEmpty())
     throw Napi::Error::New(env, "AudioIO constructor expects an inOptions and/or an outOptions object argument");
 
+  if (optionsObj.Has("manager")) {
+    mStreamManager = AudioStreamManager::unwrap(optionsObj.Get("manager"));
+    if (!mStreamManager)
+      throw Napi::TypeError::New(env, "AudioIO constructor expects manager to be an AudioStreamManager");
+  }
+
   mPaContext = std::make_shared<PaContext>(env, inOptions, outOptions);
+  makeSharedRing(env, /*isInput*/true, mInSharedRing);
+  makeSharedRing(env, /*isInput*/false, mOutSharedRing);
+  if (mStreamManager)
+    // reads and writes are run by the manager, so the stream needs no threads of its own
+    mStreamManager->attach();
+  else {
+    std::shared_ptr<PaContext> paContext = mPaContext;
+    if (mPaContext->hasInput() && mPaContext->getInOptions()->ioThread())
+      mInPump = std::make_shared<IOPump>(env, "AudioReadPump", [paContext]() { paContext->initWorkerThread("readPump"); });
+    if (mPaContext->hasOutput() && mPaContext->getOutOptions()->ioThread())
+      mOutPump = std::make_shared<IOPump>(env, "AudioWritePump", [paContext]() { paContext->initWorkerThread("writePump"); });
+  }
+}
+AudioIO::~AudioIO() {
+  // release any job still waiting on the device before the pump threads are joined
+  if (mInPump || mOutPump || mStreamManager)
+    mPaContext->quit();
+  if (mStreamManager)
+    mStreamManager->detach();
+  // the callback must be finished with the shared rings before they are released
+  if (!mInSharedRing.IsEmpty() || !mOutSharedRing.IsEmpty())
+    mPaContext->stop(PaContext::eStopFlag::ABORT);
+}
+
+void AudioIO::makeSharedRing(Napi::Env env, bool isInput, Napi::ObjectReference &sharedRing) {
+  uint32_t numBytes = mPaContext->sharedRingBytes(isInput);
+  if (!numBytes)
+    return;
+  // a SharedArrayBuffer can only be made by its JS constructor, it comes zeroed
+  Napi::Object global = env.Global();
+  Napi::Object sab = global.Get("SharedArrayBuffer").As<Napi::Function>().New({ Napi::Number::New(env, numBytes) });
+  Napi::Uint8Array view = global.Get("Uint8Array").As<Napi::Function>().New({ sab }).As<Napi::Uint8Array>();
+  mPaContext->shareRing(isInput, view.Data());
+  sharedRing = Napi::Persistent(sab);
 }
-AudioIO::~AudioIO() {}
 
 Napi::Value AudioIO::Start(const Napi::CallbackInfo& info) {
   Napi::Env env = info.Env();
@@ -150,12 +589,73 @@ Napi::Value AudioIO::Read(const Napi::CallbackInfo& info) {
 
   if (!mPaContext->hasInput())
     throw Napi::Error::New(env, "AudioIO Read - cannot read from a output-only stream");
+  if (!mInSharedRing.IsEmpty())
+    throw Napi::Error::New(env, "AudioIO Read - the input ring is shared, read it from the SharedArrayBuffer");
+  if (mRecorder && mRecorder->isRecording())
+    throw Napi::Error::New(env, "AudioIO Read - cannot read while the input is being recorded");
+  if (mPaContext->readPending())
+    throw Napi::Error::New(env, "AudioIO Read - another read is already in progress");
 
   uint32_t numBytes = info[0].As<Napi::Number>().Uint32Value();
   Napi::Function callback = info[1].As<Napi::Function>();
 
-  ReadWorker *readWork = new ReadWorker(mPaContext, numBytes, callback);
-  readWork->Queue();
+  mPaContext->beginRead();
+  if (mStreamManager) {
+    ReadJob *readJob = new ReadJob(mPaContext, numBytes, callback);
+    if (!mStreamManager->queue(env, readJob)) {
+      delete readJob;
+      throw Napi::Error::New(env, "AudioIO Read - the stream manager has quit");
+    }
+  } else if (mInPump)
+    mInPump->queue(env, new ReadJob(mPaContext, numBytes, callback));
+  else {
+    ReadWorker *readWork = new ReadWorker(mPaContext, numBytes, callback);
+    readWork->Queue();
+  }
+  return env.Undefined();
+}
+
+Napi::Value AudioIO::ReadInto(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  if (info.Length() != 2)
+    throw Napi::Error::New(env, "AudioIO ReadInto expects 2 arguments");
+  if (!info[0].IsTypedArray() && !info[0].IsArrayBuffer())
+    throw Napi::TypeError::New(env, "AudioIO ReadInto expects a valid TypedArray or ArrayBuffer as the first parameter");
+  if (!info[1].IsFunction())
+    throw Napi::TypeError::New(env, "AudioIO ReadInto expects a valid callback as the second parameter");
+
+  if (!mPaContext->hasInput())
+    throw Napi::Error::New(env, "AudioIO ReadInto - cannot read from a output-only stream");
+  if (!mInSharedRing.IsEmpty())
+    throw Napi::Error::New(env, "AudioIO ReadInto - the input ring is shared, read it from the SharedArrayBuffer");
+  if (mPaContext->getInOptions()->zeroCopy())
+    throw Napi::Error::New(env, "AudioIO ReadInto - a zeroCopy stream already reads into pooled buffers, use read");
+  if (mRecorder && mRecorder->isRecording())
+    throw Napi::Error::New(env, "AudioIO ReadInto - cannot read while the input is being recorded");
+  if (mPaContext->readPending())
+    throw Napi::Error::New(env, "AudioIO ReadInto - another read is already in progress");
+
+  Napi::Object target = info[0].As<Napi::Object>();
+  size_t dstBytes;
+  targetData(target, dstBytes);
+  if (dstBytes < mPaContext->getInOptions()->frameBytes())
+    throw Napi::Error::New(env, "AudioIO ReadInto - the buffer must hold at least one frame");
+  uint32_t numBytes = (uint32_t)std::min<size_t>(dstBytes, 0xffffffff);
+  Napi::Function callback = info[1].As<Napi::Function>();
+
+  mPaContext->beginRead();
+  if (mStreamManager) {
+    ReadIntoJob *readJob = new ReadIntoJob(mPaContext, target, numBytes, callback);
+    if (!mStreamManager->queue(env, readJob)) {
+      delete readJob;
+      throw Napi::Error::New(env, "AudioIO ReadInto - the stream manager has quit");
+    }
+  } else if (mInPump)
+    mInPump->queue(env, new ReadIntoJob(mPaContext, target, numBytes, callback));
+  else {
+    ReadIntoWorker *readWork = new ReadIntoWorker(mPaContext, target, numBytes, callback);
+    readWork->Queue();
+  }
   return env.Undefined();
 }
 
@@ -170,12 +670,41 @@ Napi::Value AudioIO::Write(const Napi::CallbackInfo& info) {
 
   if (!mPaContext->hasOutput())
     throw Napi::Error::New(env, "AudioIO Write - cannot write to an input-only stream");
+  if (!mOutSharedRing.IsEmpty())
+    throw Napi::Error::New(env, "AudioIO Write - the output ring is shared, write it to the SharedArrayBuffer");
+  if (mPaContext->getMixer())
+    throw Napi::Error::New(env, "AudioIO Write - write to the sources of a mixing stream");
+  if (mPlayer && mPlayer->isPlaying())
+    throw Napi::Error::New(env, "AudioIO Write - cannot write while a file is playing");
 
   Napi::Object chunkObj = info[0].As<Napi::Object>();
   Napi::Function callback = info[1].As<Napi::Function>();
 
-  WriteWorker *writeWork = new WriteWorker(mPaContext, std::make_shared<Chunk>(chunkObj), callback);
-  writeWork->Queue();
+  std::shared_ptr<Chunk> chunk = std::make_shared<Chunk>(chunkObj);
+  // the stream time at which a scheduled output should play the first frame
+  Napi::Value presentationTime = chunkObj.Get("presentationTime");
+  if (presentationTime.IsNumber())
+    chunk->reset(chunk->numBytes(), presentationTime.As<Napi::Number>().DoubleValue());
+
+  // a plain chunk that fits in the ring, with no write queued ahead of it, is copied straight in
+  if (mPaContext->tryPushOutChunk(chunk)) {
+    writeComplete(env, mPaContext, callback);
+    return env.Undefined();
+  }
+
+  mPaContext->beginWrite();
+  if (mStreamManager) {
+    WriteJob *writeJob = new WriteJob(mPaContext, chunk, callback, true);
+    if (!mStreamManager->queue(env, writeJob)) {
+      delete writeJob;
+      throw Napi::Error::New(env, "AudioIO Write - the stream manager has quit");
+    }
+  } else if (mOutPump)
+    mOutPump->queue(env, new WriteJob(mPaContext, chunk, callback));
+  else {
+    WriteWorker *writeWork = new WriteWorker(mPaContext, chunk, callback);
+    writeWork->Queue();
+  }
   return env.Undefined();
 }
 
@@ -195,17 +724,371 @@ Napi::Value AudioIO::Quit(const Napi::CallbackInfo& info) {
     PaContext::eStopFlag::WAIT : PaContext::eStopFlag::ABORT;
 
   Napi::Function callback = info[1].As<Napi::Function>();
-  QuitWorker *quitWork = new QuitWorker(mPaContext, stopFlag, callback);
+  QuitWorker *quitWork = new QuitWorker(mPaContext, stopFlag, mInPump, mOutPump, callback);
   quitWork->Queue();
   return env.Undefined();
 }
 
+Napi::Value AudioIO::GetPoolStats(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  if (!mPaContext->hasInput())
+    throw Napi::Error::New(env, "AudioIO GetPoolStats - no pool for an output-only stream");
+
+  std::shared_ptr<MemoryPool> pool = mPaContext->getInPool();
+  Napi::Object result = Napi::Object::New(env);
+  result.Set(Napi::String::New(env, "blocks"), Napi::Number::New(env, pool->numBlocks()));
+  result.Set(Napi::String::New(env, "blockBytes"), Napi::Number::New(env, pool->blockBytes()));
+  result.Set(Napi::String::New(env, "hits"), Napi::Number::New(env, pool->hits()));
+  result.Set(Napi::String::New(env, "misses"), Napi::Number::New(env, pool->misses()));
+  return result;
+}
+
+Napi::Value AudioIO::GetStreamInfo(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::Object result = Napi::Object::New(env);
+  if (mPaContext->hasInput())
+    result.Set(Napi::String::New(env, "inputLatency"), Napi::Number::New(env, mPaContext->getInLatency()));
+  if (mPaContext->hasOutput())
+    result.Set(Napi::String::New(env, "outputLatency"), Napi::Number::New(env, mPaContext->getOutLatency()));
+  result.Set(Napi::String::New(env, "sampleRate"), Napi::Number::New(env, mPaContext->getSampleRate()));
+  // zero when PortAudio chooses a possibly varying number of frames for each callback
+  result.Set(Napi::String::New(env, "framesPerBuffer"), Napi::Number::New(env, mPaContext->getFramesPerBuffer()));
+  result.Set(Napi::String::New(env, "streamFlags"), Napi::Number::New(env, mPaContext->getStreamFlags()));
+  // the clock that buffer timestamps and presentation times are given in
+  result.Set(Napi::String::New(env, "currentTime"), Napi::Number::New(env, mPaContext->getCurTime()));
+  return result;
+}
+
+Napi::Value AudioIO::GetStats(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  const StreamStats &stats = mPaContext->getStats();
+  Napi::Object result = Napi::Object::New(env);
+  result.Set(Napi::String::New(env, "callbacks"), Napi::Number::New(env, (double)stats.callbacks.load()));
+  result.Set(Napi::String::New(env, "cpuLoad"), Napi::Number::New(env, mPaContext->getCpuLoad()));
+  result.Set(Napi::String::New(env, "primingOutputs"), Napi::Number::New(env, stats.primingOutputs.load()));
+  if (mPaContext->hasInput()) {
+    uint32_t frameBytes = mPaContext->getInOptions()->deviceFrameBytes();
+    result.Set(Napi::String::New(env, "inputUnderflows"), Napi::Number::New(env, stats.inputUnderflows.load()));
+    result.Set(Napi::String::New(env, "inputOverflows"), Napi::Number::New(env, stats.inputOverflows.load()));
+    result.Set(Napi::String::New(env, "inOverruns"), Napi::Number::New(env, stats.inOverruns.load()));
+    result.Set(Napi::String::New(env, "inBytes"), Napi::Number::New(env, (double)stats.inFrames.load() * frameBytes));
+    result.Set(Napi::String::New(env, "inQueueHighWater"), Napi::Number::New(env, stats.inQueueHighWater.load()));
+    if (mPaContext->getInInserts() && mPaContext->getInInserts()->numMeters())
+      result.Set(Napi::String::New(env, "inMeters"), makeMeters(env, mPaContext->getInInserts()));
+  }
+  if (mPaContext->hasOutput()) {
+    uint32_t frameBytes = mPaContext->getOutOptions()->deviceFrameBytes();
+    result.Set(Napi::String::New(env, "outputUnderflows"), Napi::Number::New(env, stats.outputUnderflows.load()));
+    result.Set(Napi::String::New(env, "outputOverflows"), Napi::Number::New(env, stats.outputOverflows.load()));
+    result.Set(Napi::String::New(env, "outUnderruns"), Napi::Number::New(env, stats.outUnderruns.load()));
+    result.Set(Napi::String::New(env, "outBytes"), Napi::Number::New(env, (double)stats.outFrames.load() * frameBytes));
+    result.Set(Napi::String::New(env, "outQueueHighWater"), Napi::Number::New(env, stats.outQueueHighWater.load()));
+    if (mPaContext->getOutInserts() && mPaContext->getOutInserts()->numMeters())
+      result.Set(Napi::String::New(env, "outMeters"), makeMeters(env, mPaContext->getOutInserts()));
+  }
+  return result;
+}
+
+Napi::Value AudioIO::GetTimingStats(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  if (!mPaContext->hasTiming())
+    throw Napi::Error::New(env, "AudioIO GetTimingStats - set timingStats in inOptions or outOptions to record timing");
+
+  Napi::Object result = Napi::Object::New(env);
+  result.Set(Napi::String::New(env, "interval"), makeHistogram(env, mPaContext->getIntervalHist()));
+  result.Set(Napi::String::New(env, "duration"), makeHistogram(env, mPaContext->getDurationHist()));
+  if (mPaContext->hasInput())
+    result.Set(Napi::String::New(env, "adcDelta"), makeHistogram(env, mPaContext->getAdcDeltaHist()));
+  if (mPaContext->hasOutput())
+    result.Set(Napi::String::New(env, "dacDelta"), makeHistogram(env, mPaContext->getDacDeltaHist()));
+  return result;
+}
+
+Napi::Value AudioIO::GetThreadInfo(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::Object result = Napi::Object::New(env);
+  ThreadPriority::Report report;
+  if (mPaContext->getCallbackThread(report))
+    result.Set(Napi::String::New(env, "callback"), makeThreadReport(env, report));
+  Napi::Object workers = Napi::Object::New(env);
+  for (const auto &worker : mPaContext->getWorkerThreads())
+    workers.Set(Napi::String::New(env, worker.first), makeThreadReport(env, worker.second));
+  result.Set(Napi::String::New(env, "workers"), workers);
+  return result;
+}
+
+Napi::Value AudioIO::ResetTimingStats(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  if (!mPaContext->hasTiming())
+    throw Napi::Error::New(env, "AudioIO ResetTimingStats - set timingStats in inOptions or outOptions to record timing");
+
+  mPaContext->getIntervalHist()->reset();
+  mPaContext->getDurationHist()->reset();
+  mPaContext->getAdcDeltaHist()->reset();
+  mPaContext->getDacDeltaHist()->reset();
+  return env.Undefined();
+}
+
+Napi::Value AudioIO::WatchEvents(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  if ((info.Length() != 1) || !info[0].IsFunction())
+    throw Napi::TypeError::New(env, "AudioIO WatchEvents expects a valid callback as the first parameter");
+
+  // the context owns the event log, so a plain pointer avoids a reference cycle
+  PaContext *paContext = mPaContext.get();
+  mPaContext->getEventLog()->watch(env, info[0].As<Napi::Function>(),
+                                   [paContext]() { paContext->initWorkerThread("eventLog"); });
+  return env.Undefined();
+}
+
+Napi::Value AudioIO::UnwatchEvents(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  mPaContext->getEventLog()->unwatch();
+  return env.Undefined();
+}
+
+Napi::Value AudioIO::AddSource(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  if (info.Length() != 2)
+    throw Napi::Error::New(env, "AudioIO AddSource expects 2 arguments");
+  if (!info[0].IsNumber() || !info[1].IsNumber())
+    throw Napi::TypeError::New(env, "AudioIO AddSource expects a valid gain and pan");
+
+  std::shared_ptr<Mixer> mixer = mPaContext->getMixer();
+  if (!mixer)
+    throw Napi::Error::New(env, "AudioIO AddSource - set mixerSources in outOptions to mix sources");
+
+  uint32_t generation;
+  int32_t id = mixer->addSource(info[0].As<Napi::Number>().FloatValue(), info[1].As<Napi::Number>().FloatValue(), generation);
+  if (id < 0)
+    throw Napi::Error::New(env, "AudioIO AddSource - all mixerSources are in use");
+  // the generation tells this use of the slot apart from any later one
+  Napi::Object result = Napi::Object::New(env);
+  result.Set(Napi::String::New(env, "slot"), Napi::Number::New(env, id));
+  result.Set(Napi::String::New(env, "generation"), Napi::Number::New(env, generation));
+  return result;
+}
+
+Napi::Value AudioIO::SetSource(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  if (info.Length() != 4)
+    throw Napi::Error::New(env, "AudioIO SetSource expects 4 arguments");
+  if (!info[0].IsNumber() || !info[1].IsNumber() || !info[2].IsNumber() || !info[3].IsNumber())
+    throw Napi::TypeError::New(env, "AudioIO SetSource expects a valid source slot, generation, gain and pan");
+
+  std::shared_ptr<Mixer> mixer = mPaContext->getMixer();
+  if (!mixer || !mixer->setSource(info[0].As<Napi::Number>().Uint32Value(), info[1].As<Napi::Number>().Uint32Value(),
+                                  info[2].As<Napi::Number>().FloatValue(), info[3].As<Napi::Number>().FloatValue()))
+    throw Napi::Error::New(env, "AudioIO SetSource - unknown mixer source");
+  return env.Undefined();
+}
+
+Napi::Value AudioIO::SetInsertGain(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  if (info.Length() != 4)
+    throw Napi::Error::New(env, "AudioIO SetInsertGain expects 4 arguments");
+  if (!info[0].IsString() || !info[1].IsNumber() || !info[2].IsNumber() || !info[3].IsBoolean())
+    throw Napi::TypeError::New(env, "AudioIO SetInsertGain expects a direction of \'in\' or \'out\', an insert index, a gain and a mute flag");
+
+  std::string direction = info[0].As<Napi::String>().Utf8Value();
+  std::shared_ptr<InsertChain> inserts = (0 == direction.compare("in")) ? mPaContext->getInInserts() :
+                                         (0 == direction.compare("out")) ? mPaContext->getOutInserts() : nullptr;
+  if (!inserts || !inserts->setGain(info[1].As<Napi::Number>().Uint32Value(),
+                                    info[2].As<Napi::Number>().FloatValue(), info[3].As<Napi::Boolean>().Value()))
+    throw Napi::Error::New(env, "AudioIO SetInsertGain - no gain insert at that index");
+  return env.Undefined();
+}
+
+Napi::Value AudioIO::WriteSource(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  if (info.Length() != 4)
+    throw Napi::Error::New(env, "AudioIO WriteSource expects 4 arguments");
+  if (!info[0].IsNumber() || !info[1].IsNumber())
+    throw Napi::TypeError::New(env, "AudioIO WriteSource expects a valid source slot and generation as the first parameters");
+  if (!info[2].IsObject())
+    throw Napi::TypeError::New(env, "AudioIO WriteSource expects a valid chunk buffer as the third parameter");
+  if (!info[3].IsFunction())
+    throw Napi::TypeError::New(env, "AudioIO WriteSource expects a valid callback as the fourth parameter");
+
+  std::shared_ptr<Mixer> mixer = mPaContext->getMixer();
+  uint32_t id = info[0].As<Napi::Number>().Uint32Value();
+  uint32_t generation = info[1].As<Napi::Number>().Uint32Value();
+  if (!mixer || (id >= mixer->maxSources()))
+    throw Napi::Error::New(env, "AudioIO WriteSource - unknown mixer source");
+
+  Napi::Object chunkObj = info[2].As<Napi::Object>();
+  Napi::Function callback = info[3].As<Napi::Function>();
+
+  if (mOutPump)
+    mOutPump->queue(env, new SourceWriteJob(mixer, id, generation, std::make_shared<Chunk>(chunkObj), callback));
+  else {
+    SourceWriteWorker *writeWork = new SourceWriteWorker(mixer, id, generation, std::make_shared<Chunk>(chunkObj), callback);
+    writeWork->Queue();
+  }
+  return env.Undefined();
+}
+
+Napi::Value AudioIO::RemoveSource(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  if (info.Length() != 3)
+    throw Napi::Error::New(env, "AudioIO RemoveSource expects 3 arguments");
+  if (!info[0].IsNumber() || !info[1].IsNumber())
+    throw Napi::TypeError::New(env, "AudioIO RemoveSource expects a valid source slot and generation as the first parameters");
+  if (!info[2].IsString())
+    throw Napi::TypeError::New(env, "AudioIO RemoveSource expects a valid string as the third parameter");
+
+  std::string stopFlagStr = info[2].As<Napi::String>().Utf8Value();
+  if ((0 != stopFlagStr.compare("WAIT")) && (0 != stopFlagStr.compare("ABORT")))
+    throw Napi::Error::New(env, "AudioIO RemoveSource expects \'WAIT\' or \'ABORT\' as the third argument");
+
+  std::shared_ptr<Mixer> mixer = mPaContext->getMixer();
+  if (mixer)
+    mixer->removeSource(info[0].As<Napi::Number>().Uint32Value(), info[1].As<Napi::Number>().Uint32Value(),
+                        0 == stopFlagStr.compare("WAIT"));
+  return env.Undefined();
+}
+
+Napi::Value AudioIO::StartRecording(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  if (info.Length() != 2)
+    throw Napi::Error::New(env, "AudioIO StartRecording expects 2 arguments");
+  if (!info[0].IsObject())
+    throw Napi::TypeError::New(env, "AudioIO StartRecording expects a valid options object as the first parameter");
+  if (!info[1].IsFunction())
+    throw Napi::TypeError::New(env, "AudioIO StartRecording expects a valid callback as the second parameter");
+
+  if (mRecorder && mRecorder->isRecording())
+    throw Napi::Error::New(env, "AudioIO StartRecording - the input is already being recorded");
+  if (mPaContext->readPending())
+    throw Napi::Error::New(env, "AudioIO StartRecording - cannot record while a read is in progress");
+  if (!mInSharedRing.IsEmpty())
+    throw Napi::Error::New(env, "AudioIO StartRecording - cannot record a shared input ring");
+  mRecorder.reset();
+  mRecorder = std::make_shared<Recorder>(env, mPaContext, info[0].As<Napi::Object>(), info[1].As<Napi::Function>());
+  return env.Undefined();
+}
+
+Napi::Value AudioIO::RotateRecording(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  if ((info.Length() != 1) || !info[0].IsString())
+    throw Napi::TypeError::New(env, "AudioIO RotateRecording expects a valid path as the first parameter");
+  if (!mRecorder || !mRecorder->isRecording())
+    throw Napi::Error::New(env, "AudioIO RotateRecording - the input is not being recorded");
+
+  mRecorder->rotate(info[0].As<Napi::String>().Utf8Value());
+  return env.Undefined();
+}
+
+Napi::Value AudioIO::StopRecording(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  if ((info.Length() != 1) || !info[0].IsFunction())
+    throw Napi::TypeError::New(env, "AudioIO StopRecording expects a valid callback as the first parameter");
+
+  RecordStopWorker *stopWork = new RecordStopWorker(mRecorder, info[0].As<Napi::Function>());
+  stopWork->Queue();
+  return env.Undefined();
+}
+
+Napi::Value AudioIO::StartPlayback(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  if (info.Length() != 2)
+    throw Napi::Error::New(env, "AudioIO StartPlayback expects 2 arguments");
+  if (!info[0].IsObject())
+    throw Napi::TypeError::New(env, "AudioIO StartPlayback expects a valid options object as the first parameter");
+  if (!info[1].IsFunction())
+    throw Napi::TypeError::New(env, "AudioIO StartPlayback expects a valid callback as the second parameter");
+
+  if (mPlayer && mPlayer->isPlaying())
+    throw Napi::Error::New(env, "AudioIO StartPlayback - a file is already playing");
+  if (mPaContext->writePending())
+    throw Napi::Error::New(env, "AudioIO StartPlayback - cannot play a file while a write is in progress");
+  if (!mOutSharedRing.IsEmpty())
+    throw Napi::Error::New(env, "AudioIO StartPlayback - cannot play into a shared output ring");
+  mPlayer.reset();
+  mPlayer = std::make_shared<FilePlayer>(env, mPaContext, info[0].As<Napi::Object>(), info[1].As<Napi::Function>());
+  return Napi::Number::New(env, (double)mPlayer->numFrames());
+}
+
+Napi::Value AudioIO::GetSharedRing(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  if ((info.Length() != 1) || !info[0].IsString())
+    throw Napi::TypeError::New(env, "AudioIO GetSharedRing expects a direction of \'in\' or \'out\'");
+
+  std::string direction = info[0].As<Napi::String>().Utf8Value();
+  Napi::ObjectReference &sharedRing = (0 == direction.compare("in")) ? mInSharedRing : mOutSharedRing;
+  if ((0 != direction.compare("in")) && (0 != direction.compare("out")))
+    throw Napi::TypeError::New(env, "AudioIO GetSharedRing expects a direction of \'in\' or \'out\'");
+  if (sharedRing.IsEmpty())
+    return env.Undefined();
+  return sharedRing.Value();
+}
+
+Napi::Value AudioIO::SeekPlayback(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  if ((info.Length() != 1) || !info[0].IsNumber())
+    throw Napi::TypeError::New(env, "AudioIO SeekPlayback expects a valid frame as the first parameter");
+  if (!mPlayer || !mPlayer->isPlaying())
+    throw Napi::Error::New(env, "AudioIO SeekPlayback - no file is playing");
+
+  mPlayer->seek((uint64_t)std::max(0.0, info[0].As<Napi::Number>().DoubleValue()));
+  return env.Undefined();
+}
+
+Napi::Value AudioIO::SetPlaybackLoop(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  if (info.Length() != 3)
+    throw Napi::Error::New(env, "AudioIO SetPlaybackLoop expects 3 arguments");
+  if (!info[0].IsBoolean())
+    throw Napi::TypeError::New(env, "AudioIO SetPlaybackLoop expects a valid boolean as the first parameter");
+  if (!info[1].IsNumber() || !info[2].IsNumber())
+    throw Napi::TypeError::New(env, "AudioIO SetPlaybackLoop expects valid start and end frames as the second and third parameters");
+  if (!mPlayer || !mPlayer->isPlaying())
+    throw Napi::Error::New(env, "AudioIO SetPlaybackLoop - no file is playing");
+
+  mPlayer->setLoop(info[0].As<Napi::Boolean>().Value(),
+                   (uint64_t)std::max(0.0, info[1].As<Napi::Number>().DoubleValue()),
+                   (uint64_t)std::max(0.0, info[2].As<Napi::Number>().DoubleValue()));
+  return env.Undefined();
+}
+
+Napi::Value AudioIO::StopPlayback(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  if ((info.Length() != 1) || !info[0].IsFunction())
+    throw Napi::TypeError::New(env, "AudioIO StopPlayback expects a valid callback as the first parameter");
+
+  PlaybackStopWorker *stopWork = new PlaybackStopWorker(mPlayer, info[0].As<Napi::Function>());
+  stopWork->Queue();
+  return env.Undefined();
+}
+
 void AudioIO::Init(Napi::Env env, Napi::Object exports) {
   Napi::Function func = DefineClass(env, "AudioIO", {
     InstanceMethod("start", &AudioIO::Start),
     InstanceMethod("read", &AudioIO::Read),
+    InstanceMethod("readInto", &AudioIO::ReadInto),
+    InstanceMethod("getSharedRing", &AudioIO::GetSharedRing),
     InstanceMethod("write", &AudioIO::Write),
-    InstanceMethod("quit", &AudioIO::Quit)
+    InstanceMethod("quit", &AudioIO::Quit),
+    InstanceMethod("getPoolStats", &AudioIO::GetPoolStats),
+    InstanceMethod("getStreamInfo", &AudioIO::GetStreamInfo),
+    InstanceMethod("getStats", &AudioIO::GetStats),
+    InstanceMethod("getTimingStats", &AudioIO::GetTimingStats),
+    InstanceMethod("resetTimingStats", &AudioIO::ResetTimingStats),
+    InstanceMethod("getThreadInfo", &AudioIO::GetThreadInfo),
+    InstanceMethod("watchEvents", &AudioIO::WatchEvents),
+    InstanceMethod("unwatchEvents", &AudioIO::UnwatchEvents),
+    InstanceMethod("addSource", &AudioIO::AddSource),
+    InstanceMethod("setSource", &AudioIO::SetSource),
+    InstanceMethod("writeSource", &AudioIO::WriteSource),
+    InstanceMethod("setInsertGain", &AudioIO::SetInsertGain),
+    InstanceMethod("removeSource", &AudioIO::RemoveSource),
+    InstanceMethod("startRecording", &AudioIO::StartRecording),
+    InstanceMethod("rotateRecording", &AudioIO::RotateRecording),
+    InstanceMethod("stopRecording", &AudioIO::StopRecording),
+    InstanceMethod("startPlayback", &AudioIO::StartPlayback),
+    InstanceMethod("seekPlayback", &AudioIO::SeekPlayback),
+    InstanceMethod("setPlaybackLoop", &AudioIO::SetPlaybackLoop),
+    InstanceMethod("stopPlayback", &AudioIO::StopPlayback)
   });
 
   constructor = Napi::Persistent(func);
@@ -22,6 +22,10 @@
 namespace streampunk {
 
 class PaContext;
+class IOPump;
+class StreamManager;
+class Recorder;
+class FilePlayer;
 
 class AudioIO : public Napi::ObjectWrap<AudioIO> {
 public:
@@ -34,10 +38,42 @@ private:
 
   Napi::Value Start(const Napi::CallbackInfo& info);
   Napi::Value Read(const Napi::CallbackInfo& info);
+  Napi::Value ReadInto(const Napi::CallbackInfo& info);
   Napi::Value Write(const Napi::CallbackInfo& info);
   Napi::Value Quit(const Napi::CallbackInfo& info);
+  Napi::Value GetPoolStats(const Napi::CallbackInfo& info);
+  Napi::Value GetStreamInfo(const Napi::CallbackInfo& info);
+  Napi::Value GetStats(const Napi::CallbackInfo& info);
+  Napi::Value GetTimingStats(const Napi::CallbackInfo& info);
+  Napi::Value ResetTimingStats(const Napi::CallbackInfo& info);
+  Napi::Value GetThreadInfo(const Napi::CallbackInfo& info);
+  Napi::Value WatchEvents(const Napi::CallbackInfo& info);
+  Napi::Value UnwatchEvents(const Napi::CallbackInfo& info);
+  Napi::Value AddSource(const Napi::CallbackInfo& info);
+  Napi::Value SetSource(const Napi::CallbackInfo& info);
+  Napi::Value WriteSource(const Napi::CallbackInfo& info);
+  Napi::Value SetInsertGain(const Napi::CallbackInfo& info);
+  Napi::Value RemoveSource(const Napi::CallbackInfo& info);
+  Napi::Value StartRecording(const Napi::CallbackInfo& info);
+  Napi::Value RotateRecording(const Napi::CallbackInfo& info);
+  Napi::Value StopRecording(const Napi::CallbackInfo& info);
+  Napi::Value StartPlayback(const Napi::CallbackInfo& info);
+  Napi::Value SeekPlayback(const Napi::CallbackInfo& info);
+  Napi::Value SetPlaybackLoop(const Napi::CallbackInfo& info);
+  Napi::Value StopPlayback(const Napi::CallbackInfo& info);
+  Napi::Value GetSharedRing(const Napi::CallbackInfo& info);
+
+  void makeSharedRing(Napi::Env env, bool isInput, Napi::ObjectReference &sharedRing);
 
   std::shared_ptr<PaContext> mPaContext;
+  std::shared_ptr<IOPump> mInPump;
+  std::shared_ptr<IOPump> mOutPump;
+  std::shared_ptr<StreamManager> mStreamManager;
+  std::shared_ptr<Recorder> mRecorder;
+  std::shared_ptr<FilePlayer> mPlayer;
+  // SharedArrayBuffers that hold the rings, referenced here for as long as the stream may run
+  Napi::ObjectReference mInSharedRing;
+  Napi::ObjectReference mOutSharedRing;
 };
 
 } // namespace streampunk
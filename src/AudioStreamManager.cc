@@ -0,0 +1,98 @@
+/* Copyright 2019 Streampunk Media Ltd.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#include "AudioStreamManager.h"
+#include "StreamManager.h"
+#include "Params.h"
+
+namespace streampunk {
+
+Napi::FunctionReference AudioStreamManager::constructor;
+
+class ManagerQuitWorker : public Napi::AsyncWorker {
+  public:
+    ManagerQuitWorker(std::shared_ptr<StreamManager> streamManager, const Napi::Function& callback)
+      : AsyncWorker(callback, "AudioStreamManagerQuit"), mStreamManager(streamManager)
+    { }
+    ~ManagerQuitWorker() {}
+
+    void Execute() {
+      mStreamManager->quit();
+    }
+
+    void OnOK() {
+      Napi::HandleScope scope(Env());
+      Callback().Call({});
+    }
+
+  private:
+    std::shared_ptr<StreamManager> mStreamManager;
+};
+
+AudioStreamManager::AudioStreamManager(const Napi::CallbackInfo& info)
+  : Napi::ObjectWrap<AudioStreamManager>(info) {
+  Napi::Env env = info.Env();
+
+  Napi::Object optionsObj = Napi::Object::New(env);
+  if (info.Length() > 0) {
+    if (!info[0].IsObject())
+      throw Napi::TypeError::New(env, "AudioStreamManager constructor expects an options object argument");
+    optionsObj = info[0].As<Napi::Object>();
+  }
+
+  ManagerOptions options(env, optionsObj);
+  mStreamManager = std::make_shared<StreamManager>(env, options.pollIntervalMs());
+}
+AudioStreamManager::~AudioStreamManager() {}
+
+std::shared_ptr<StreamManager> AudioStreamManager::unwrap(Napi::Value value) {
+  if (!value.IsObject() || !value.As<Napi::Object>().InstanceOf(constructor.Value()))
+    return std::shared_ptr<StreamManager>();
+  return Unwrap(value.As<Napi::Object>())->mStreamManager;
+}
+
+Napi::Value AudioStreamManager::Quit(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  if ((info.Length() != 1) || !info[0].IsFunction())
+    throw Napi::TypeError::New(env, "AudioStreamManager Quit expects a valid callback as the first parameter");
+
+  ManagerQuitWorker *quitWork = new ManagerQuitWorker(mStreamManager, info[0].As<Napi::Function>());
+  quitWork->Queue();
+  return env.Undefined();
+}
+
+Napi::Value AudioStreamManager::GetStats(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::Object result = Napi::Object::New(env);
+  result.Set(Napi::String::New(env, "streams"), Napi::Number::New(env, mStreamManager->numStreams()));
+  result.Set(Napi::String::New(env, "waiting"), Napi::Number::New(env, mStreamManager->numWaiting()));
+  result.Set(Napi::String::New(env, "jobs"), Napi::Number::New(env, (double)mStreamManager->numJobs()));
+  result.Set(Napi::String::New(env, "deliveries"), Napi::Number::New(env, (double)mStreamManager->numDeliveries()));
+  return result;
+}
+
+void AudioStreamManager::Init(Napi::Env env, Napi::Object exports) {
+  Napi::Function func = DefineClass(env, "AudioStreamManager", {
+    InstanceMethod("quit", &AudioStreamManager::Quit),
+    InstanceMethod("getStats", &AudioStreamManager::GetStats)
+  });
+
+  constructor = Napi::Persistent(func);
+  constructor.SuppressDestruct();
+
+  exports.Set("AudioStreamManager", func);
+}
+
+} // namespace streampunk
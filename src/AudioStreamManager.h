@@ -0,0 +1,46 @@
+/* Copyright 2019 Streampunk Media Ltd.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef AUDIOSTREAMMANAGER_H
+#define AUDIOSTREAMMANAGER_H
+
+#include <napi.h>
+#include <memory>
+
+namespace streampunk {
+
+class StreamManager;
+
+class AudioStreamManager : public Napi::ObjectWrap<AudioStreamManager> {
+public:
+  static void Init(Napi::Env env, Napi::Object exports);
+  AudioStreamManager(const Napi::CallbackInfo& info);
+  ~AudioStreamManager();
+
+  // the manager wrapped by an AudioStreamManager object, null for any other value
+  static std::shared_ptr<StreamManager> unwrap(Napi::Value value);
+
+private:
+  static Napi::FunctionReference constructor;
+
+  Napi::Value Quit(const Napi::CallbackInfo& info);
+  Napi::Value GetStats(const Napi::CallbackInfo& info);
+
+  std::shared_ptr<StreamManager> mStreamManager;
+};
+
+} // namespace streampunk
+
+#endif
@@ -0,0 +1,80 @@
+/* Copyright 2019 Streampunk Media Ltd.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef CHANNELMAP_H
+#define CHANNELMAP_H
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace streampunk {
+
+// Interleaved channel selection for real-time use, never allocates.
+// Sample sizes are fixed at compile time so each copy is a single move.
+
+template <uint32_t N>
+static inline void gatherChannels(const uint8_t *src, uint32_t srcChannels, uint8_t *dst,
+                                  const std::vector<int32_t> &map, uint32_t numFrames) {
+  uint32_t dstChannels = (uint32_t)map.size();
+  for (uint32_t f = 0; f < numFrames; ++f) {
+    for (uint32_t c = 0; c < dstChannels; ++c)
+      memcpy(dst + c * N, src + map[c] * N, N);
+    src += srcChannels * N;
+    dst += dstChannels * N;
+  }
+}
+
+template <uint32_t N>
+static inline void scatterChannels(const uint8_t *src, uint32_t srcChannels, uint8_t *dst,
+                                   const std::vector<int32_t> &map, uint32_t numFrames) {
+  uint32_t dstChannels = (uint32_t)map.size();
+  for (uint32_t f = 0; f < numFrames; ++f) {
+    for (uint32_t c = 0; c < dstChannels; ++c) {
+      if (map[c] < 0)
+        memset(dst + c * N, 0, N);
+      else
+        memcpy(dst + c * N, src + map[c] * N, N);
+    }
+    src += srcChannels * N;
+    dst += dstChannels * N;
+  }
+}
+
+// input - map has an entry per selected channel giving the device channel to take it from
+static inline void gatherChannels(uint32_t sampleBytes, const uint8_t *src, uint32_t srcChannels, uint8_t *dst,
+                                  const std::vector<int32_t> &map, uint32_t numFrames) {
+  switch (sampleBytes) {
+  case 1: gatherChannels<1>(src, srcChannels, dst, map, numFrames); break;
+  case 2: gatherChannels<2>(src, srcChannels, dst, map, numFrames); break;
+  case 3: gatherChannels<3>(src, srcChannels, dst, map, numFrames); break;
+  case 4: gatherChannels<4>(src, srcChannels, dst, map, numFrames); break;
+  }
+}
+
+// output - map has an entry per device channel giving the stream channel to play on it, or -1 for silence
+static inline void scatterChannels(uint32_t sampleBytes, const uint8_t *src, uint32_t srcChannels, uint8_t *dst,
+                                   const std::vector<int32_t> &map, uint32_t numFrames) {
+  switch (sampleBytes) {
+  case 1: scatterChannels<1>(src, srcChannels, dst, map, numFrames); break;
+  case 2: scatterChannels<2>(src, srcChannels, dst, map, numFrames); break;
+  case 3: scatterChannels<3>(src, srcChannels, dst, map, numFrames); break;
+  case 4: scatterChannels<4>(src, srcChannels, dst, map, numFrames); break;
+  }
+}
+
+} // namespace streampunk
+
+#endif
@@ -20,9 +20,16 @@
 #include "Memory.h"
 #include "Persist.h"
 #include "ChunkQueue.h"
+#include <vector>
 
 namespace streampunk {
 
+// stream timestamp of the sample at a byte position
+struct TimeMark {
+  uint32_t pos;
+  double ts;
+};
+
 class Chunk {
 public:
   Chunk (Napi::Object chunk)
@@ -39,10 +46,36 @@ public:
   uint8_t *buf() const { return mChunk ? mChunk->buf() : nullptr; }
   double ts() const { return mTs; }
 
+  // hold the chunk while a JS Buffer wraps its memory
+  void retain(std::shared_ptr<Chunk> self) { mSelf = self; }
+  // called by the Buffer finalizer - may destroy the chunk
+  void release() {
+    std::shared_ptr<Chunk> self;
+    self.swap(mSelf);
+  }
+
+  // recycle a pooled chunk for new contents
+  void reset(uint32_t numBytes, double ts) {
+    mChunk->setNumBytes(numBytes);
+    mTs = ts;
+    mPeriods.clear();
+  }
+
+  // timestamps of the device periods that make up the chunk, positions relative to the chunk start
+  const std::vector<TimeMark> &periods() const { return mPeriods; }
+  void reservePeriods(uint32_t numPeriods) { mPeriods.reserve(numPeriods); }
+  // never allocates, periods beyond the reserved number are not recorded
+  void addPeriod(uint32_t pos, double ts) {
+    if (mPeriods.size() < mPeriods.capacity())
+      mPeriods.push_back({ pos, ts });
+  }
+
 private:
   std::shared_ptr<Memory> mChunk;
   std::unique_ptr<Persist> mPersistentChunk;
-  const double mTs;
+  double mTs;
+  std::vector<TimeMark> mPeriods;
+  std::shared_ptr<Chunk> mSelf;
 };
 
 class Chunks {
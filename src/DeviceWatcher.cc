@@ -0,0 +1,157 @@
+/* Copyright 2019 Streampunk Media Ltd.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#include "DeviceWatcher.h"
+#include <string>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+#ifdef __APPLE__
+#include <CoreAudio/CoreAudio.h>
+#endif
+
+namespace streampunk {
+
+#ifdef __linux__
+// ALSA creates and removes nodes here as cards come and go
+static const char *sDevDir = "/dev/snd";
+// wait for the device nodes to settle before reporting a change
+static const int sSettleMs = 250;
+#endif
+
+#ifdef __APPLE__
+static const AudioObjectPropertyAddress sDevicesAddress = {
+  kAudioHardwarePropertyDevices,
+  kAudioObjectPropertyScopeGlobal,
+  kAudioObjectPropertyElementMaster
+};
+
+static OSStatus devicesChanged(AudioObjectID objectId, UInt32 numAddresses,
+                               const AudioObjectPropertyAddress *addresses, void *clientData) {
+  static_cast<DeviceWatcher *>(clientData)->notify();
+  return noErr;
+}
+#endif
+
+DeviceWatcher::DeviceWatcher(Napi::Env env, const Napi::Function &callback) {
+  if (!isSupported())
+    throw Napi::Error::New(env, "Device change notification is not supported on this platform");
+
+  mTsfn = Napi::ThreadSafeFunction::New(env, callback, "DeviceWatcher", 0, 1);
+  // watching for devices should not keep the process alive
+  mTsfn.Unref(env);
+
+#ifdef __linux__
+  mNotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if ((mNotifyFd < 0) || (inotify_add_watch(mNotifyFd, sDevDir, IN_CREATE | IN_DELETE) < 0)) {
+    if (mNotifyFd >= 0)
+      close(mNotifyFd);
+    mTsfn.Release();
+    std::string err = std::string("Could not watch ") + sDevDir + " for device changes";
+    throw Napi::Error::New(env, err.c_str());
+  }
+  if (pipe(mQuitFd) < 0) {
+    close(mNotifyFd);
+    mTsfn.Release();
+    throw Napi::Error::New(env, "Could not create device watcher");
+  }
+  mThread = std::thread(&DeviceWatcher::run, this);
+#endif
+#ifdef __APPLE__
+  if (noErr != AudioObjectAddPropertyListener(kAudioObjectSystemObject, &sDevicesAddress, devicesChanged, this)) {
+    mTsfn.Release();
+    throw Napi::Error::New(env, "Could not listen for CoreAudio device changes");
+  }
+#endif
+}
+
+DeviceWatcher::~DeviceWatcher() {
+#ifdef __linux__
+  char quit = 0;
+  if (write(mQuitFd[1], &quit, 1) < 0) {}
+  if (mThread.joinable())
+    mThread.join();
+  close(mQuitFd[0]);
+  close(mQuitFd[1]);
+  close(mNotifyFd);
+#endif
+#ifdef __APPLE__
+  AudioObjectRemovePropertyListener(kAudioObjectSystemObject, &sDevicesAddress, devicesChanged, this);
+#endif
+  mTsfn.Release();
+}
+
+bool DeviceWatcher::isSupported() {
+#if defined(__linux__) || defined(__APPLE__)
+  return true;
+#else
+  return false;
+#endif
+}
+
+void DeviceWatcher::notify() {
+  mTsfn.NonBlockingCall();
+}
+
+#ifdef __linux__
+void DeviceWatcher::run() {
+  char buf[4096];
+  bool changed = false;
+  while (true) {
+    pollfd fds[2] = { { mNotifyFd, POLLIN, 0 }, { mQuitFd[0], POLLIN, 0 } };
+    int rc = poll(fds, 2, changed ? sSettleMs : -1);
+    if ((rc < 0) || (fds[1].revents & POLLIN))
+      break;
+    if (0 == rc) {
+      changed = false;
+      notify();
+    } else if (fds[0].revents & POLLIN) {
+      while (read(mNotifyFd, buf, sizeof(buf)) > 0) {}
+      changed = true;
+    }
+  }
+}
+#endif
+
+static std::unique_ptr<DeviceWatcher> sWatcher;
+static bool sCleanupHooked = false;
+
+static void cleanupWatcher(void *arg) {
+  sWatcher.reset();
+}
+
+Napi::Value WatchDevices(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  if ((info.Length() != 1) || !info[0].IsFunction())
+    throw Napi::TypeError::New(env, "WatchDevices expects 1 argument: a callback function");
+
+  sWatcher.reset();
+  sWatcher = std::unique_ptr<DeviceWatcher>(new DeviceWatcher(env, info[0].As<Napi::Function>()));
+  if (!sCleanupHooked) {
+    napi_add_env_cleanup_hook(env, cleanupWatcher, nullptr);
+    sCleanupHooked = true;
+  }
+  return env.Undefined();
+}
+
+Napi::Value UnwatchDevices(const Napi::CallbackInfo& info) {
+  sWatcher.reset();
+  return info.Env().Undefined();
+}
+
+} // namespace streampunk
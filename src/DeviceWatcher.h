@@ -0,0 +1,54 @@
+/* Copyright 2019 Streampunk Media Ltd.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef DEVICEWATCHER_H
+#define DEVICEWATCHER_H
+
+#include <napi.h>
+#include <memory>
+#include <thread>
+
+namespace streampunk {
+
+// PortAudio has no hotplug notification of its own, so this listens to the
+// operating system for audio devices coming and going and calls back on the
+// JS thread, with no arguments, after each burst of changes.
+class DeviceWatcher {
+public:
+  DeviceWatcher(Napi::Env env, const Napi::Function &callback);
+  ~DeviceWatcher();
+
+  // may be called from any thread
+  void notify();
+
+  static bool isSupported();
+
+private:
+  Napi::ThreadSafeFunction mTsfn;
+#ifdef __linux__
+  int mNotifyFd;
+  int mQuitFd[2];
+  std::thread mThread;
+  void run();
+#endif
+  DeviceWatcher(const DeviceWatcher &);
+};
+
+Napi::Value WatchDevices(const Napi::CallbackInfo& info);
+Napi::Value UnwatchDevices(const Napi::CallbackInfo& info);
+
+} // namespace streampunk
+
+#endif
@@ -0,0 +1,122 @@
+/* Copyright 2019 Streampunk Media Ltd.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#include "EventLog.h"
+#include <chrono>
+#include <vector>
+
+namespace streampunk {
+
+// the callback does not signal the log, so the ring is polled while watching
+static const std::chrono::milliseconds sPollInterval(50);
+
+static const struct { const char *name; const char *message; } sEventNames[] = {
+  { "inputUnderflow", "input underflow" },
+  { "inputOverflow", "input overflow" },
+  { "outputUnderflow", "output underflow" },
+  { "outputOverflow", "output overflow" },
+  { "primingOutput", "priming output" },
+  { "inputOverrun", "input ring full, period dropped" },
+  { "outputUnderrun", "output ring empty, silence played" },
+  { "outputFinished", "output finished" },
+  { "outputLowWater", "output ring below low water" },
+  { "eventsDropped", "event log full, events dropped" }
+};
+
+EventLog::EventLog(uint32_t capacity)
+  : mRing(capacity), mDropped(0), mWatching(false) {}
+
+EventLog::~EventLog() {
+  unwatch();
+}
+
+void EventLog::push(eEvent type, double ts, uint32_t value) {
+  Event event = { type, value, ts };
+  if (!mRing.write(&event, 1))
+    ++mDropped;
+}
+
+void EventLog::watch(Napi::Env env, const Napi::Function &callback, std::function<void()> threadInit) {
+  unwatch();
+  mThreadInit = threadInit;
+  mTsfn = Napi::ThreadSafeFunction::New(env, callback, "AudioEventLog", 0, 1);
+  // watching alone does not keep node running
+  mTsfn.Unref(env);
+  mWatching = true;
+  mThread = std::thread(&EventLog::run, this);
+}
+
+void EventLog::unwatch() {
+  if (!mWatching)
+    return;
+  {
+    std::lock_guard<std::mutex> lk(m);
+    mWatching = false;
+    mCv.notify_all();
+  }
+  if (mThread.joinable())
+    mThread.join();
+  mTsfn.Release();
+}
+
+const char *EventLog::typeName(eEvent type) {
+  return sEventNames[(uint32_t)type].name;
+}
+
+const char *EventLog::message(eEvent type) {
+  return sEventNames[(uint32_t)type].message;
+}
+
+// private
+void EventLog::run() {
+  if (mThreadInit)
+    mThreadInit();
+  while (mWatching) {
+    {
+      std::unique_lock<std::mutex> lk(m);
+      mCv.wait_for(lk, sPollInterval);
+    }
+
+    std::vector<Event> *events = new std::vector<Event>;
+    Event event;
+    while (mRing.read(&event, 1))
+      events->push_back(event);
+    uint32_t dropped = mDropped.exchange(0);
+    if (dropped) {
+      Event droppedEvent = { eEvent::EVENTS_DROPPED, dropped, events->empty() ? 0.0 : events->back().ts };
+      events->push_back(droppedEvent);
+    }
+    if (events->empty()) {
+      delete events;
+      continue;
+    }
+
+    mTsfn.BlockingCall(events, [](Napi::Env env, Napi::Function callback, std::vector<Event> *events) {
+      Napi::HandleScope scope(env);
+      for (auto &e : *events) {
+        Napi::Object eventVal = Napi::Object::New(env);
+        eventVal.Set(Napi::String::New(env, "type"), Napi::String::New(env, typeName(e.type)));
+        eventVal.Set(Napi::String::New(env, "message"), Napi::String::New(env, message(e.type)));
+        eventVal.Set(Napi::String::New(env, "timestamp"), Napi::Number::New(env, e.ts));
+        if (e.value)
+          eventVal.Set(Napi::String::New(env, "value"), Napi::Number::New(env, e.value));
+        callback.Call({eventVal});
+      }
+      delete events;
+    });
+  }
+}
+
+} // namespace streampunk
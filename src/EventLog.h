@@ -0,0 +1,75 @@
+/* Copyright 2019 Streampunk Media Ltd.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef EVENTLOG_H
+#define EVENTLOG_H
+
+#include <napi.h>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <thread>
+#include <functional>
+#include "RingBuffer.h"
+
+namespace streampunk {
+
+// Records stream events from the audio callback without locking, allocating or formatting.
+// Fixed size records go into a ring, and while JS is watching a thread takes them out,
+// turns them into objects and passes each one to a JS callback.
+class EventLog {
+public:
+  enum class eEvent : uint8_t {
+    INPUT_UNDERFLOW = 0, INPUT_OVERFLOW, OUTPUT_UNDERFLOW, OUTPUT_OVERFLOW, PRIMING_OUTPUT,
+    INPUT_OVERRUN, OUTPUT_UNDERRUN, OUTPUT_FINISHED, OUTPUT_LOW_WATER, EVENTS_DROPPED
+  };
+
+  struct Event {
+    eEvent type;
+    uint32_t value;
+    double ts;
+  };
+
+  EventLog(uint32_t capacity);
+  ~EventLog();
+
+  // real-time - events are counted and dropped when the ring is full
+  void push(eEvent type, double ts, uint32_t value = 0);
+
+  // call on the JS thread, threadInit runs first on the thread that delivers the events
+  void watch(Napi::Env env, const Napi::Function &callback, std::function<void()> threadInit = std::function<void()>());
+  void unwatch();
+
+  static const char *typeName(eEvent type);
+  static const char *message(eEvent type);
+
+private:
+  RingBuffer<Event> mRing;
+  std::atomic<uint32_t> mDropped;
+  Napi::ThreadSafeFunction mTsfn;
+  std::atomic<bool> mWatching;
+  std::function<void()> mThreadInit;
+  std::thread mThread;
+  std::mutex m;
+  std::condition_variable mCv;
+
+  void run();
+  EventLog(const EventLog &);
+};
+
+} // namespace streampunk
+
+#endif
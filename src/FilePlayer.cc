@@ -0,0 +1,339 @@
+/* Copyright 2019 Streampunk Media Ltd.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#include "FilePlayer.h"
+#include "PaContext.h"
+#include "Params.h"
+#include <cstring>
+#include <cerrno>
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace streampunk {
+
+static uint32_t getLE16(const uint8_t *p) { return p[0] | (p[1] << 8); }
+static uint32_t getLE32(const uint8_t *p) { return getLE16(p) | (getLE16(p + 2) << 16); }
+static uint64_t getLE64(const uint8_t *p) { return getLE32(p) | ((uint64_t)getLE32(p + 4) << 32); }
+
+// A whole file mapped read only
+class MappedFile {
+public:
+  MappedFile() : mData(nullptr), mSize(0)
+#ifdef _WIN32
+    , mFile(INVALID_HANDLE_VALUE), mMapping(NULL)
+#endif
+  {}
+  ~MappedFile() {
+#ifdef _WIN32
+    if (mData)
+      UnmapViewOfFile(mData);
+    if (mMapping)
+      CloseHandle(mMapping);
+    if (INVALID_HANDLE_VALUE != mFile)
+      CloseHandle(mFile);
+#else
+    if (mData)
+      munmap(mData, mSize);
+#endif
+  }
+
+  const uint8_t *data() const { return (const uint8_t *)mData; }
+  uint64_t size() const { return mSize; }
+
+  bool map(const std::string &path, std::string &err) {
+#ifdef _WIN32
+    mFile = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (INVALID_HANDLE_VALUE == mFile)
+      return fail(err, "failed to open", path);
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(mFile, &size))
+      return fail(err, "failed to read the size of", path);
+    mSize = (uint64_t)size.QuadPart;
+    if (!mSize)
+      return fail(err, "cannot play the empty file", path);
+    mMapping = CreateFileMappingA(mFile, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mMapping)
+      mData = MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0);
+    if (!mData)
+      return fail(err, "failed to map", path);
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+      return fail(err, "failed to open", path);
+    struct stat st;
+    if (fstat(fd, &st)) {
+      ::close(fd);
+      return fail(err, "failed to read the size of", path);
+    }
+    mSize = (uint64_t)st.st_size;
+    if (!mSize) {
+      ::close(fd);
+      return fail(err, "cannot play the empty file", path);
+    }
+    void *data = mmap(nullptr, mSize, PROT_READ, MAP_SHARED, fd, 0);
+    // the mapping holds its own reference to the file
+    ::close(fd);
+    if (MAP_FAILED == data)
+      return fail(err, "failed to map", path);
+    mData = data;
+    madvise(mData, mSize, MADV_SEQUENTIAL);
+#endif
+    return true;
+  }
+
+  // asks for a range of the file to be read in before it is touched
+  void willNeed(uint64_t offset, uint64_t bytes) {
+#ifndef _WIN32
+    static const uint64_t pageBytes = (uint64_t)sysconf(_SC_PAGESIZE);
+    if (offset >= mSize)
+      return;
+    bytes = std::min<uint64_t>(bytes, mSize - offset);
+    uint64_t start = offset - offset % pageBytes;
+    madvise((uint8_t *)mData + start, offset + bytes - start, MADV_WILLNEED);
+#endif
+  }
+
+private:
+  void *mData;
+  uint64_t mSize;
+#ifdef _WIN32
+  HANDLE mFile;
+  HANDLE mMapping;
+#endif
+
+  bool fail(std::string &err, const char *what, const std::string &path) {
+    err = std::string(what) + " playback file " + path + ": " + strerror(errno);
+    return false;
+  }
+
+  MappedFile(const MappedFile &);
+};
+
+FilePlayer::FilePlayer(Napi::Env env, std::shared_ptr<PaContext> paContext, Napi::Object options,
+                       const Napi::Function &callback)
+  : mPaContext(paContext), mOptions(std::make_shared<PlaybackOptions>(env, options)),
+    mFile(std::make_shared<MappedFile>()), mDataOffset(0), mNumFrames(0), mUnsigned8(false),
+    mPlaying(false), mSeekFrame(-1), mLoop(false), mLoopStart(0), mLoopEnd(0) {
+  if (!mPaContext->hasOutput())
+    throw Napi::Error::New(env, "AudioIO playback requires an output stream");
+  std::shared_ptr<AudioOptions> outOptions = mPaContext->getOutOptions();
+  if (!outOptions->interleaved())
+    throw Napi::Error::New(env, "AudioIO playback requires interleaved output");
+  if (mPaContext->getMixer())
+    throw Napi::Error::New(env, "AudioIO playback cannot play into a mixing stream, add a source instead");
+  if (mOptions->path().empty())
+    throw Napi::Error::New(env, "AudioIO playback requires a path");
+
+  std::string err;
+  if (!mFile->map(mOptions->path(), err))
+    throw Napi::Error::New(env, err);
+
+  const uint8_t *data = mFile->data();
+  uint64_t size = mFile->size();
+  if ((size >= 12) && (!memcmp(data, "RIFF", 4) || !memcmp(data, "RF64", 4)) && !memcmp(data + 8, "WAVE", 4))
+    parseWav(env, data, size);
+  else
+    // raw files hold samples in the stream format
+    mNumFrames = size / outOptions->frameBytes();
+
+  setLoop(mOptions->loop(), mOptions->loopStart(), mOptions->loopEnd());
+  mSeekFrame = (int64_t)std::min<uint64_t>(mOptions->startFrame(), mNumFrames);
+  if (mUnsigned8)
+    mStage.resize(std::max<uint32_t>(1, mOptions->chunkFrames() ? mOptions->chunkFrames() : outOptions->ringFrames() / 4) *
+                  outOptions->frameBytes());
+
+  mTsfn = Napi::ThreadSafeFunction::New(env, callback, "AudioFilePlayer", 0, 1);
+  mPlaying = true;
+  mThread = std::thread(&FilePlayer::run, this);
+}
+
+FilePlayer::~FilePlayer() {
+  stop();
+}
+
+void FilePlayer::seek(uint64_t frame) {
+  mSeekFrame = (int64_t)std::min<uint64_t>(frame, mNumFrames);
+}
+
+void FilePlayer::setLoop(bool loop, uint64_t loopStart, uint64_t loopEnd) {
+  std::lock_guard<std::mutex> lk(m);
+  mLoopEnd = (loopEnd && (loopEnd < mNumFrames)) ? loopEnd : mNumFrames;
+  mLoopStart = std::min<uint64_t>(loopStart, mLoopEnd);
+  // an empty loop would never move on
+  mLoop = loop && (mLoopStart < mLoopEnd);
+}
+
+void FilePlayer::stop() {
+  if (!mThread.joinable())
+    return;
+  mPlaying = false;
+  mThread.join();
+  mTsfn.Release();
+}
+
+// private
+void FilePlayer::parseWav(Napi::Env env, const uint8_t *data, uint64_t size) {
+  bool rf64 = !memcmp(data, "RF64", 4);
+  uint64_t ds64DataBytes = 0;
+  uint32_t formatTag = 0;
+  uint32_t channels = 0;
+  uint32_t sampleRate = 0;
+  uint32_t sampleBits = 0;
+  uint64_t dataBytes = 0;
+  bool haveData = false;
+
+  uint64_t pos = 12;
+  while (!haveData && (pos + 8 <= size)) {
+    const uint8_t *chunk = data + pos;
+    uint64_t chunkBytes = getLE32(chunk + 4);
+    uint64_t bodyBytes = size - pos - 8;
+    if (!memcmp(chunk, "ds64", 4) && (bodyBytes >= 16))
+      ds64DataBytes = getLE64(chunk + 16);
+    else if (!memcmp(chunk, "fmt ", 4) && (bodyBytes >= 16)) {
+      formatTag = getLE16(chunk + 8);
+      channels = getLE16(chunk + 10);
+      sampleRate = getLE32(chunk + 12);
+      sampleBits = getLE16(chunk + 22);
+      if ((0xfffe == formatTag) && (chunkBytes >= 40) && (bodyBytes >= 40))
+        // the sub-format GUID starts with the format tag
+        formatTag = getLE16(chunk + 32);
+    } else if (!memcmp(chunk, "data", 4)) {
+      if (rf64 && (0xffffffff == chunkBytes))
+        chunkBytes = ds64DataBytes;
+      mDataOffset = pos + 8;
+      dataBytes = std::min<uint64_t>(chunkBytes, bodyBytes);
+      haveData = true;
+    }
+    pos += 8 + chunkBytes + (chunkBytes & 1);
+  }
+  if (!formatTag || !haveData)
+    throw Napi::Error::New(env, "AudioIO playback file " + mOptions->path() + " is not a complete WAV file");
+
+  uint32_t sampleFormat = 0;
+  if ((3 == formatTag) && (32 == sampleBits))
+    sampleFormat = 1;
+  else if ((1 == formatTag) && ((8 == sampleBits) || (16 == sampleBits) || (24 == sampleBits) || (32 == sampleBits)))
+    sampleFormat = sampleBits;
+  else
+    throw Napi::Error::New(env, "AudioIO playback file " + mOptions->path() + " has an unsupported sample format");
+
+  // samples are passed to the ring as they are, so the file must match the stream
+  std::shared_ptr<AudioOptions> outOptions = mPaContext->getOutOptions();
+  if ((channels != outOptions->channelCount()) || (sampleFormat != outOptions->sampleFormat()) ||
+      (sampleRate != outOptions->targetSampleRate()))
+    throw Napi::Error::New(env, "AudioIO playback file " + mOptions->path() +
+      " must have the channel count, sample format and sample rate of the stream");
+  mNumFrames = dataBytes / outOptions->frameBytes();
+  mUnsigned8 = 8 == sampleBits;
+}
+
+void FilePlayer::run() {
+  mPaContext->initWorkerThread("player");
+  std::shared_ptr<AudioOptions> outOptions = mPaContext->getOutOptions();
+  uint32_t frameBytes = outOptions->frameBytes();
+  uint32_t chunkFrames = mOptions->chunkFrames() ? mOptions->chunkFrames() : std::max<uint32_t>(1, outOptions->ringFrames() / 4);
+  uint64_t readAheadBytes = (uint64_t)mOptions->readAheadMs() * outOptions->targetSampleRate() / 1000 * frameBytes;
+  const uint8_t *samples = mFile->data() + mDataOffset;
+
+  uint64_t position = 0;
+  uint64_t pagedTo = 0;
+  bool ended = false;
+  while (mPlaying && mPaContext->isActive()) {
+    int64_t seekFrame = mSeekFrame.exchange(-1);
+    if (seekFrame >= 0) {
+      position = (uint64_t)seekFrame;
+      pagedTo = position;
+    }
+
+    bool loop;
+    uint64_t loopStart, loopEnd;
+    {
+      std::lock_guard<std::mutex> lk(m);
+      loop = mLoop;
+      loopStart = mLoopStart;
+      loopEnd = mLoopEnd;
+    }
+    // the loop only applies while playing inside it, after a seek beyond it the file plays out
+    uint64_t endFrame = (loop && (position < loopEnd)) ? loopEnd : mNumFrames;
+    if (position >= endFrame) {
+      ended = true;
+      break;
+    }
+
+    // keep the next readAheadMs of the file on its way in, half a window at a time
+    uint64_t offset = position * frameBytes;
+    if (pagedTo * frameBytes < offset + readAheadBytes / 2) {
+      mFile->willNeed(mDataOffset + offset, readAheadBytes);
+      pagedTo = position + readAheadBytes / frameBytes;
+      if (loop && (loopEnd - position) * frameBytes < readAheadBytes)
+        mFile->willNeed(mDataOffset + loopStart * frameBytes, readAheadBytes);
+    }
+
+    uint32_t frames = (uint32_t)std::min<uint64_t>(chunkFrames, endFrame - position);
+    uint8_t *buf = (uint8_t *)samples + offset;
+    if (mUnsigned8) {
+      // WAV holds 8 bit samples unsigned
+      for (uint32_t i = 0; i < frames * frameBytes; ++i)
+        mStage[i] = buf[i] ^ 0x80;
+      buf = mStage.data();
+    }
+    // the chunk only refers to the mapping, the samples are copied once into the ring
+    // a stop gives up waiting for room, the output may not be draining
+    mPaContext->pushOutChunk(std::make_shared<Chunk>(Memory::makeNew(buf, frames * frameBytes), 0.0), &mPlaying);
+    position += frames;
+
+    if (loop && (position == loopEnd)) {
+      position = loopStart;
+      pagedTo = position;
+      report("looped", loopEnd);
+    }
+  }
+  mPlaying = false;
+  report(ended ? "ended" : "stopped", position);
+}
+
+void FilePlayer::report(const char *type, uint64_t position) {
+  struct Report {
+    std::string type;
+    std::string path;
+    uint64_t position;
+    double seconds;
+  };
+  Report *r = new Report;
+  r->type = type;
+  r->path = mOptions->path();
+  r->position = position;
+  r->seconds = (double)position / mPaContext->getOutOptions()->targetSampleRate();
+
+  mTsfn.BlockingCall(r, [](Napi::Env env, Napi::Function callback, Report *r) {
+    Napi::HandleScope scope(env);
+    Napi::Object reportVal = Napi::Object::New(env);
+    reportVal.Set(Napi::String::New(env, "type"), Napi::String::New(env, r->type));
+    reportVal.Set(Napi::String::New(env, "path"), Napi::String::New(env, r->path));
+    reportVal.Set(Napi::String::New(env, "position"), Napi::Number::New(env, (double)r->position));
+    reportVal.Set(Napi::String::New(env, "seconds"), Napi::Number::New(env, r->seconds));
+    callback.Call({reportVal});
+    delete r;
+  });
+}
+
+} // namespace streampunk
@@ -0,0 +1,76 @@
+/* Copyright 2019 Streampunk Media Ltd.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef FILEPLAYER_H
+#define FILEPLAYER_H
+
+#include <napi.h>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <string>
+#include <vector>
+
+namespace streampunk {
+
+class PaContext;
+class PlaybackOptions;
+class MappedFile;
+
+// Plays a WAV, RF64 or raw file through an output stream without passing the samples through JS.
+// The file is memory mapped and a feeder thread copies it from the mapping into the output ring,
+// paging in ahead of the play position, so a slow disk holds up the feeder rather than the callback.
+class FilePlayer {
+public:
+  FilePlayer(Napi::Env env, std::shared_ptr<PaContext> paContext, Napi::Object options,
+             const Napi::Function &callback);
+  ~FilePlayer();
+
+  bool isPlaying() const { return mPlaying; }
+  uint64_t numFrames() const { return mNumFrames; }
+
+  // any thread - take effect from the next chunk passed to the ring
+  void seek(uint64_t frame);
+  void setLoop(bool loop, uint64_t loopStart, uint64_t loopEnd);
+  // blocks until the feeder thread has finished
+  void stop();
+
+private:
+  std::shared_ptr<PaContext> mPaContext;
+  std::shared_ptr<PlaybackOptions> mOptions;
+  std::shared_ptr<MappedFile> mFile;
+  uint64_t mDataOffset;
+  uint64_t mNumFrames;
+  bool mUnsigned8;
+  std::vector<uint8_t> mStage;
+  std::atomic<bool> mPlaying;
+  std::atomic<int64_t> mSeekFrame;
+  std::mutex m;
+  bool mLoop;
+  uint64_t mLoopStart;
+  uint64_t mLoopEnd;
+  Napi::ThreadSafeFunction mTsfn;
+  std::thread mThread;
+
+  void parseWav(Napi::Env env, const uint8_t *data, uint64_t size);
+  void run();
+  void report(const char *type, uint64_t position);
+  FilePlayer(const FilePlayer &);
+};
+
+} // namespace streampunk
+
+#endif
@@ -15,40 +15,58 @@
 
 #include <napi.h>
 #include "GetDevices.h"
-#include <portaudio.h>
+#include "PaHost.h"
 
 namespace streampunk {
 
+static Napi::Object makeDeviceInfo(Napi::Env env, int32_t id, const DeviceInfo &deviceInfo) {
+  Napi::Object v8DeviceInfo = Napi::Object::New(env);
+  if (id >= 0)
+    v8DeviceInfo.Set(Napi::String::New(env, "id"), Napi::Number::New(env, id));
+  v8DeviceInfo.Set(Napi::String::New(env, "name"), Napi::String::New(env, deviceInfo.name));
+  v8DeviceInfo.Set(Napi::String::New(env, "maxInputChannels"), Napi::Number::New(env, deviceInfo.maxInputChannels));
+  v8DeviceInfo.Set(Napi::String::New(env, "maxOutputChannels"), Napi::Number::New(env, deviceInfo.maxOutputChannels));
+  v8DeviceInfo.Set(Napi::String::New(env, "defaultSampleRate"), Napi::Number::New(env, deviceInfo.defaultSampleRate));
+  v8DeviceInfo.Set(Napi::String::New(env, "defaultLowInputLatency"), Napi::Number::New(env, deviceInfo.defaultLowInputLatency));
+  v8DeviceInfo.Set(Napi::String::New(env, "defaultLowOutputLatency"), Napi::Number::New(env, deviceInfo.defaultLowOutputLatency));
+  v8DeviceInfo.Set(Napi::String::New(env, "defaultHighInputLatency"), Napi::Number::New(env, deviceInfo.defaultHighInputLatency));
+  v8DeviceInfo.Set(Napi::String::New(env, "defaultHighOutputLatency"), Napi::Number::New(env, deviceInfo.defaultHighOutputLatency));
+  v8DeviceInfo.Set(Napi::String::New(env, "hostAPIName"), Napi::String::New(env, deviceInfo.hostAPIName));
+  return v8DeviceInfo;
+}
+
+// Devices reported by refreshDevices carry no id, indices change as PortAudio reinitialises
+static Napi::Array makeDeviceList(Napi::Env env, const std::vector<DeviceInfo> &devices) {
+  Napi::Array result = Napi::Array::New(env, devices.size());
+  for (uint32_t i = 0; i < devices.size(); ++i)
+    result.Set(i, makeDeviceInfo(env, -1, devices[i]));
+  return result;
+}
+
 Napi::Value GetDevices(const Napi::CallbackInfo& info) {
   Napi::Env env = info.Env();
-  uint32_t numDevices;
-
-  PaError errCode = Pa_Initialize();
-  if (errCode != paNoError) {
-    std::string err = std::string("Could not initialize PortAudio: ") + Pa_GetErrorText(errCode);
-    throw Napi::Error::New(env, err.c_str());
-  }
-
-  numDevices = Pa_GetDeviceCount();
-  Napi::Array result = Napi::Array::New(env, numDevices);
-
-  for (uint32_t i = 0; i < numDevices; ++i) {
-    const PaDeviceInfo* deviceInfo = Pa_GetDeviceInfo(i);
-    Napi::Object v8DeviceInfo = Napi::Object::New(env);
-    v8DeviceInfo.Set(Napi::String::New(env, "id"), Napi::Number::New(env, i));
-    v8DeviceInfo.Set(Napi::String::New(env, "name"), Napi::String::New(env, deviceInfo->name));
-    v8DeviceInfo.Set(Napi::String::New(env, "maxInputChannels"), Napi::Number::New(env, deviceInfo->maxInputChannels));
-    v8DeviceInfo.Set(Napi::String::New(env, "maxOutputChannels"), Napi::Number::New(env, deviceInfo->maxOutputChannels));
-    v8DeviceInfo.Set(Napi::String::New(env, "defaultSampleRate"), Napi::Number::New(env, deviceInfo->defaultSampleRate));
-    v8DeviceInfo.Set(Napi::String::New(env, "defaultLowInputLatency"), Napi::Number::New(env, deviceInfo->defaultLowInputLatency));
-    v8DeviceInfo.Set(Napi::String::New(env, "defaultLowOutputLatency"), Napi::Number::New(env, deviceInfo->defaultLowOutputLatency));
-    v8DeviceInfo.Set(Napi::String::New(env, "defaultHighInputLatency"), Napi::Number::New(env, deviceInfo->defaultHighInputLatency));
-    v8DeviceInfo.Set(Napi::String::New(env, "defaultHighOutputLatency"), Napi::Number::New(env, deviceInfo->defaultHighOutputLatency));
-    v8DeviceInfo.Set(Napi::String::New(env, "hostAPIName"), Napi::String::New(env, Pa_GetHostApiInfo(deviceInfo->hostApi)->name));
-    result.Set(i, v8DeviceInfo);
-  }
-
-  Pa_Terminate();
+
+  std::shared_ptr<PaHost> paHost = PaHost::acquire(env);
+  const std::vector<DeviceInfo> &devices = paHost->devices();
+
+  Napi::Array result = Napi::Array::New(env, devices.size());
+  for (uint32_t i = 0; i < devices.size(); ++i)
+    result.Set(i, makeDeviceInfo(env, i, devices[i]));
+
+  return result;
+}
+
+Napi::Value RefreshDevices(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  std::vector<DeviceInfo> added;
+  std::vector<DeviceInfo> removed;
+  bool refreshed = PaHost::refresh(env, added, removed);
+
+  Napi::Object result = Napi::Object::New(env);
+  result.Set(Napi::String::New(env, "refreshed"), Napi::Boolean::New(env, refreshed));
+  result.Set(Napi::String::New(env, "added"), makeDeviceList(env, added));
+  result.Set(Napi::String::New(env, "removed"), makeDeviceList(env, removed));
   return result;
 }
 
@@ -19,6 +19,7 @@
 namespace streampunk {
 
 Napi::Value GetDevices(const Napi::CallbackInfo& info);
+Napi::Value RefreshDevices(const Napi::CallbackInfo& info);
 
 } // namespace streampunk
 
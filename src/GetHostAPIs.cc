@@ -15,6 +15,7 @@
 
 #include <napi.h>
 #include "GetHostAPIs.h"
+#include "PaHost.h"
 #include <portaudio.h>
 
 namespace streampunk {
@@ -22,11 +23,7 @@ namespace streampunk {
 Napi::Object GetHostAPIs(const Napi::CallbackInfo& info) {
   Napi::Env env = info.Env();
 
-  PaError errCode = Pa_Initialize();
-  if (errCode != paNoError) {
-    std::string err = std::string("Could not initialize PortAudio: ") + Pa_GetErrorText(errCode);
-    throw Napi::Error::New(env, err.c_str());
-  }
+  std::shared_ptr<PaHost> paHost = PaHost::acquire(env);
 
   Napi::Object result = Napi::Object::New(env);
 
@@ -94,7 +91,6 @@ Napi::Object GetHostAPIs(const Napi::CallbackInfo& info) {
   }
   result.Set(Napi::String::New(env, "HostAPIs"), hostApiArr);
 
-  Pa_Terminate();
   return result;
 }
 
@@ -0,0 +1,90 @@
+/* Copyright 2019 Streampunk Media Ltd.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <atomic>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+namespace streampunk {
+
+// Fixed log scale histogram of durations in microseconds, four buckets per octave
+// from 1us up to about a second. Written by one thread without allocating or locking
+// and read by any other. A reset is requested by the reader and carried out by the
+// writer at its next record, so the two never race over the counts.
+class Histogram {
+public:
+  static const uint32_t sBucketsPerOctave = 4;
+  static const uint32_t sNumBuckets = 82;
+
+  Histogram() : mResetPending(false) { clear(); }
+  ~Histogram() {}
+
+  void record(double us) {
+    if (mResetPending.load(std::memory_order_acquire)) {
+      clear();
+      mResetPending.store(false, std::memory_order_release);
+    }
+    uint32_t b = 0;
+    if (us >= 1.0)
+      b = std::min<uint32_t>(sNumBuckets - 1, 1 + (uint32_t)(std::log2(us) * sBucketsPerOctave));
+    mCounts[b].store(mCounts[b].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    mTotal.store(mTotal.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    mSum.store(mSum.load(std::memory_order_relaxed) + us, std::memory_order_relaxed);
+    if (us < mMin.load(std::memory_order_relaxed))
+      mMin.store(us, std::memory_order_relaxed);
+    if (us > mMax.load(std::memory_order_relaxed))
+      mMax.store(us, std::memory_order_relaxed);
+  }
+
+  void reset() { mResetPending.store(true, std::memory_order_release); }
+
+  // reads report an empty histogram while a reset is waiting for the writer
+  uint64_t total() const  { return mResetPending ? 0 : mTotal.load(std::memory_order_relaxed); }
+  uint32_t count(uint32_t b) const  { return mResetPending ? 0 : mCounts[b].load(std::memory_order_relaxed); }
+  double min() const  { return total() ? mMin.load(std::memory_order_relaxed) : 0.0; }
+  double max() const  { return total() ? mMax.load(std::memory_order_relaxed) : 0.0; }
+  double mean() const  { return total() ? mSum.load(std::memory_order_relaxed) / total() : 0.0; }
+  // exclusive upper bound of a bucket in microseconds, the last bucket has no bound
+  static double upperBound(uint32_t b) {
+    return b < sNumBuckets - 1 ? std::pow(2.0, (double)b / sBucketsPerOctave) : INFINITY;
+  }
+
+private:
+  std::atomic<uint32_t> mCounts[sNumBuckets];
+  std::atomic<uint64_t> mTotal;
+  std::atomic<double> mSum;
+  std::atomic<double> mMin;
+  std::atomic<double> mMax;
+  std::atomic<bool> mResetPending;
+
+  void clear() {
+    for (uint32_t b = 0; b < sNumBuckets; ++b)
+      mCounts[b].store(0, std::memory_order_relaxed);
+    mTotal.store(0, std::memory_order_relaxed);
+    mSum.store(0.0, std::memory_order_relaxed);
+    mMin.store(INFINITY, std::memory_order_relaxed);
+    mMax.store(0.0, std::memory_order_relaxed);
+  }
+
+  Histogram(const Histogram &);
+};
+
+} // namespace streampunk
+
+#endif
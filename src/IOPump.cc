@@ -0,0 +1,63 @@
+/* Copyright 2019 Streampunk Media Ltd.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#include "IOPump.h"
+
+namespace streampunk {
+
+IOPump::IOPump(Napi::Env env, const std::string &name, std::function<void()> threadInit)
+  : mJobs(0xffffffff), mPending(std::make_shared<uint32_t>(0)), mThreadInit(threadInit) {
+  Napi::Function noop = Napi::Function::New(env, [](const Napi::CallbackInfo&) {});
+  mTsfn = Napi::ThreadSafeFunction::New(env, noop, name.c_str(), 0, 1);
+  // only keep the event loop alive while there is work outstanding
+  mTsfn.Unref(env);
+  mThread = std::thread(&IOPump::run, this);
+}
+
+IOPump::~IOPump() {
+  quit();
+  if (mThread.joinable())
+    mThread.join();
+}
+
+void IOPump::queue(Napi::Env env, PumpJob *job) {
+  if (0 == (*mPending)++)
+    mTsfn.Ref(env);
+  mJobs.enqueue(job);
+}
+
+void IOPump::quit() {
+  mJobs.quit();
+}
+
+void IOPump::run() {
+  Napi::ThreadSafeFunction tsfn = mTsfn;
+  std::shared_ptr<uint32_t> pending = mPending;
+  if (mThreadInit)
+    mThreadInit();
+  while (PumpJob *job = mJobs.dequeue()) {
+    job->Execute();
+    tsfn.BlockingCall(job, [tsfn, pending](Napi::Env env, Napi::Function, PumpJob *job) {
+      Napi::HandleScope scope(env);
+      job->OnOK(env);
+      delete job;
+      if (0 == --(*pending))
+        tsfn.Unref(env);
+    });
+  }
+  tsfn.Release();
+}
+
+} // namespace streampunk
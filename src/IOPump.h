@@ -0,0 +1,70 @@
+/* Copyright 2019 Streampunk Media Ltd.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef IOPUMP_H
+#define IOPUMP_H
+
+#include <napi.h>
+#include "ChunkQueue.h"
+#include <thread>
+#include <functional>
+
+namespace streampunk {
+
+// Unit of work for an IOPump, in the manner of a Napi::AsyncWorker:
+// Execute runs on the pump thread, OnOK then runs on the JS thread
+class PumpJob {
+public:
+  PumpJob(const Napi::Function& callback)
+    : mCallback(Napi::Persistent(callback)) {}
+  virtual ~PumpJob() {}
+
+  // a StreamManager only runs Execute once the job says it will not wait
+  virtual bool ready() { return true; }
+  // and keeps it waiting, to run Execute again, until it is done
+  virtual bool done() { return true; }
+  virtual void Execute() = 0;
+  virtual void OnOK(Napi::Env env) = 0;
+
+protected:
+  Napi::FunctionReference mCallback;
+};
+
+// Dedicated thread that runs the blocking side of reads or writes for a stream
+// so that waiting on the device never holds a libuv threadpool slot
+class IOPump {
+public:
+  // threadInit runs first on the pump thread, to set its scheduling
+  IOPump(Napi::Env env, const std::string &name, std::function<void()> threadInit = std::function<void()>());
+  ~IOPump();
+
+  // call on the JS thread, takes ownership of the job
+  void queue(Napi::Env env, PumpJob *job);
+  void quit();
+
+private:
+  ChunkQueue<PumpJob *> mJobs;
+  Napi::ThreadSafeFunction mTsfn;
+  // only touched on the JS thread, shared so that completions can outlive the pump
+  std::shared_ptr<uint32_t> mPending;
+  std::function<void()> mThreadInit;
+  std::thread mThread;
+
+  void run();
+};
+
+} // namespace streampunk
+
+#endif
@@ -0,0 +1,421 @@
+/* Copyright 2019 Streampunk Media Ltd.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#include "InsertChain.h"
+#include "Params.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define INSERTCHAIN_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define INSERTCHAIN_NEON
+#include <arm_neon.h>
+#endif
+
+namespace streampunk {
+
+const uint32_t InsertChain::sBlockFrames;
+
+static const double sPi = 3.14159265358979323846;
+// recursive filter state below this is flushed to zero so that silence never runs on denormals
+static const double sDenormal = 1e-20;
+
+// buf *= gain
+static void scale(float *buf, uint32_t numSamples, float gain) {
+  uint32_t i = 0;
+#if defined(INSERTCHAIN_SSE2)
+  const __m128 g = _mm_set1_ps(gain);
+  for (; i + 4 <= numSamples; i += 4)
+    _mm_storeu_ps(buf + i, _mm_mul_ps(_mm_loadu_ps(buf + i), g));
+#elif defined(INSERTCHAIN_NEON)
+  const float32x4_t g = vdupq_n_f32(gain);
+  for (; i + 4 <= numSamples; i += 4)
+    vst1q_f32(buf + i, vmulq_f32(vld1q_f32(buf + i), g));
+#endif
+  for (; i < numSamples; ++i)
+    buf[i] *= gain;
+}
+
+// per channel peak magnitude and sum of squares, added to peak and sumSq - when the channel
+// count divides 4 each vector lane always holds the same channel, so the lanes fold at the end
+static void accumulate(const float *buf, uint32_t numSamples, uint32_t channels, float *peak, float *sumSq) {
+  uint32_t i = 0;
+#if defined(INSERTCHAIN_SSE2)
+  if (0 == 4 % channels) {
+    const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    __m128 vPeak = _mm_setzero_ps();
+    __m128 vSum = _mm_setzero_ps();
+    for (; i + 4 <= numSamples; i += 4) {
+      __m128 x = _mm_loadu_ps(buf + i);
+      vPeak = _mm_max_ps(vPeak, _mm_and_ps(x, absMask));
+      vSum = _mm_add_ps(vSum, _mm_mul_ps(x, x));
+    }
+    float lanePeak[4];
+    float laneSum[4];
+    _mm_storeu_ps(lanePeak, vPeak);
+    _mm_storeu_ps(laneSum, vSum);
+    for (uint32_t l = 0; l < 4; ++l) {
+      peak[l % channels] = std::max(peak[l % channels], lanePeak[l]);
+      sumSq[l % channels] += laneSum[l];
+    }
+  }
+#elif defined(INSERTCHAIN_NEON)
+  if (0 == 4 % channels) {
+    float32x4_t vPeak = vdupq_n_f32(0.0f);
+    float32x4_t vSum = vdupq_n_f32(0.0f);
+    for (; i + 4 <= numSamples; i += 4) {
+      float32x4_t x = vld1q_f32(buf + i);
+      vPeak = vmaxq_f32(vPeak, vabsq_f32(x));
+      vSum = vmlaq_f32(vSum, x, x);
+    }
+    float lanePeak[4];
+    float laneSum[4];
+    vst1q_f32(lanePeak, vPeak);
+    vst1q_f32(laneSum, vSum);
+    for (uint32_t l = 0; l < 4; ++l) {
+      peak[l % channels] = std::max(peak[l % channels], lanePeak[l]);
+      sumSq[l % channels] += laneSum[l];
+    }
+  }
+#endif
+  for (; i < numSamples; ++i) {
+    uint32_t c = i % channels;
+    peak[c] = std::max(peak[c], std::fabs(buf[i]));
+    sumSq[c] += buf[i] * buf[i];
+  }
+}
+
+// moves linearly to a new gain over rampMs so that changes do not click
+class GainInsert : public Insert {
+public:
+  GainInsert(uint32_t channels, double sampleRate, float gain, bool mute, double rampMs)
+    : mChannels(channels), mRampFrames(std::max<uint32_t>(1, (uint32_t)(rampMs * sampleRate / 1000.0))),
+      mTarget(mute ? 0.0f : gain), mGain(mTarget), mRampTarget(mTarget), mStep(0.0f), mRampLeft(0) {}
+
+  bool setGain(float gain, bool mute) {
+    mTarget = mute ? 0.0f : gain;
+    return true;
+  }
+
+  void process(float *buf, uint32_t numFrames) {
+    float target = mTarget.load(std::memory_order_relaxed);
+    if (target != mRampTarget) {
+      mRampTarget = target;
+      mStep = (target - mGain) / mRampFrames;
+      mRampLeft = mRampFrames;
+    }
+    uint32_t f = 0;
+    for (; mRampLeft && (f < numFrames); ++f, --mRampLeft) {
+      mGain += mStep;
+      for (uint32_t c = 0; c < mChannels; ++c)
+        buf[f * mChannels + c] *= mGain;
+    }
+    if (!mRampLeft)
+      mGain = mRampTarget;
+    if ((f < numFrames) && (1.0f != mGain))
+      scale(buf + f * mChannels, (numFrames - f) * mChannels, mGain);
+  }
+
+private:
+  const uint32_t mChannels;
+  const uint32_t mRampFrames;
+  std::atomic<float> mTarget;
+  // callback only
+  float mGain;
+  float mRampTarget;
+  float mStep;
+  uint32_t mRampLeft;
+};
+
+// peak hold until read and an exponentially weighted RMS, passing the samples through unchanged
+class MeterInsert : public Insert {
+public:
+  MeterInsert(uint32_t channels, double sampleRate, double windowMs)
+    : mChannels(channels), mFrameCoeff(std::exp(-1000.0 / (std::max(1.0, windowMs) * sampleRate))),
+      mBlockFrames(0), mBlockCoeff(1.0), mMeanSq(channels, 0.0), mBlockPeak(channels), mBlockSum(channels),
+      mPeak(new std::atomic<float>[channels]), mRms(new std::atomic<float>[channels]) {
+    for (uint32_t c = 0; c < channels; ++c) {
+      mPeak[c] = 0.0f;
+      mRms[c] = 0.0f;
+    }
+  }
+
+  void process(float *buf, uint32_t numFrames) {
+    if (numFrames != mBlockFrames) {
+      mBlockFrames = numFrames;
+      mBlockCoeff = std::pow(mFrameCoeff, (double)numFrames);
+    }
+    std::fill(mBlockPeak.begin(), mBlockPeak.end(), 0.0f);
+    std::fill(mBlockSum.begin(), mBlockSum.end(), 0.0f);
+    accumulate(buf, numFrames * mChannels, mChannels, mBlockPeak.data(), mBlockSum.data());
+    for (uint32_t c = 0; c < mChannels; ++c) {
+      mMeanSq[c] = mMeanSq[c] * mBlockCoeff + (1.0 - mBlockCoeff) * mBlockSum[c] / numFrames;
+      if (mMeanSq[c] < sDenormal)
+        mMeanSq[c] = 0.0;
+      mRms[c].store((float)std::sqrt(mMeanSq[c]), std::memory_order_relaxed);
+      // a read may clear the peak between the load and the store, which only delays the clear
+      if (mBlockPeak[c] > mPeak[c].load(std::memory_order_relaxed))
+        mPeak[c].store(mBlockPeak[c], std::memory_order_relaxed);
+    }
+  }
+
+  void read(std::vector<float> &peak, std::vector<float> &rms) {
+    peak.resize(mChannels);
+    rms.resize(mChannels);
+    for (uint32_t c = 0; c < mChannels; ++c) {
+      peak[c] = mPeak[c].exchange(0.0f);
+      rms[c] = mRms[c].load();
+    }
+  }
+
+private:
+  const uint32_t mChannels;
+  const double mFrameCoeff;
+  // callback only
+  uint32_t mBlockFrames;
+  double mBlockCoeff;
+  std::vector<double> mMeanSq;
+  std::vector<float> mBlockPeak;
+  std::vector<float> mBlockSum;
+  // read from any thread
+  std::unique_ptr<std::atomic<float>[]> mPeak;
+  std::unique_ptr<std::atomic<float>[]> mRms;
+};
+
+// first order high pass that removes any DC offset
+class DcBlockInsert : public Insert {
+public:
+  DcBlockInsert(uint32_t channels, double sampleRate, double cutoff)
+    : mChannels(channels), mR(std::exp(-2.0 * sPi * cutoff / sampleRate)), mX1(channels, 0.0), mY1(channels, 0.0) {}
+
+  void process(float *buf, uint32_t numFrames) {
+    for (uint32_t c = 0; c < mChannels; ++c) {
+      double x1 = mX1[c];
+      double y1 = mY1[c];
+      for (uint32_t f = 0; f < numFrames; ++f) {
+        double x = buf[f * mChannels + c];
+        y1 = x - x1 + mR * y1;
+        x1 = x;
+        buf[f * mChannels + c] = (float)y1;
+      }
+      mX1[c] = x1;
+      mY1[c] = std::fabs(y1) < sDenormal ? 0.0 : y1;
+    }
+  }
+
+private:
+  const uint32_t mChannels;
+  const double mR;
+  std::vector<double> mX1;
+  std::vector<double> mY1;
+};
+
+// second order section with the responses of the RBJ audio EQ cookbook, run in transposed
+// direct form II with double precision state so that low frequencies stay stable
+class BiquadInsert : public Insert {
+public:
+  enum class eShape : uint8_t { LOWPASS = 0, HIGHPASS, BANDPASS, NOTCH, PEAKING, LOWSHELF, HIGHSHELF };
+
+  static bool parseShape(const std::string &str, eShape &shape) {
+    static const char *names[] = { "lowpass", "highpass", "bandpass", "notch", "peaking", "lowshelf", "highshelf" };
+    for (uint32_t i = 0; i < sizeof(names) / sizeof(names[0]); ++i)
+      if (0 == str.compare(names[i])) {
+        shape = (eShape)i;
+        return true;
+      }
+    return false;
+  }
+
+  BiquadInsert(uint32_t channels, double sampleRate, eShape shape, double frequency, double q, double gainDb)
+    : mChannels(channels), mZ1(channels, 0.0), mZ2(channels, 0.0) {
+    double w0 = 2.0 * sPi * std::min(frequency, 0.49 * sampleRate) / sampleRate;
+    double cosW = std::cos(w0);
+    double alpha = std::sin(w0) / (2.0 * q);
+    double a = std::pow(10.0, gainDb / 40.0);
+    double shelf = 2.0 * std::sqrt(a) * alpha;
+    double b0, b1, b2, a0, a1, a2;
+    switch (shape) {
+    case eShape::LOWPASS:
+      b0 = (1.0 - cosW) / 2.0; b1 = 1.0 - cosW; b2 = b0;
+      a0 = 1.0 + alpha; a1 = -2.0 * cosW; a2 = 1.0 - alpha;
+      break;
+    case eShape::HIGHPASS:
+      b0 = (1.0 + cosW) / 2.0; b1 = -(1.0 + cosW); b2 = b0;
+      a0 = 1.0 + alpha; a1 = -2.0 * cosW; a2 = 1.0 - alpha;
+      break;
+    case eShape::BANDPASS:
+      b0 = alpha; b1 = 0.0; b2 = -alpha;
+      a0 = 1.0 + alpha; a1 = -2.0 * cosW; a2 = 1.0 - alpha;
+      break;
+    case eShape::NOTCH:
+      b0 = 1.0; b1 = -2.0 * cosW; b2 = 1.0;
+      a0 = 1.0 + alpha; a1 = -2.0 * cosW; a2 = 1.0 - alpha;
+      break;
+    case eShape::LOWSHELF:
+      b0 = a * ((a + 1.0) - (a - 1.0) * cosW + shelf);
+      b1 = 2.0 * a * ((a - 1.0) - (a + 1.0) * cosW);
+      b2 = a * ((a + 1.0) - (a - 1.0) * cosW - shelf);
+      a0 = (a + 1.0) + (a - 1.0) * cosW + shelf;
+      a1 = -2.0 * ((a - 1.0) + (a + 1.0) * cosW);
+      a2 = (a + 1.0) + (a - 1.0) * cosW - shelf;
+      break;
+    case eShape::HIGHSHELF:
+      b0 = a * ((a + 1.0) + (a - 1.0) * cosW + shelf);
+      b1 = -2.0 * a * ((a - 1.0) + (a + 1.0) * cosW);
+      b2 = a * ((a + 1.0) + (a - 1.0) * cosW - shelf);
+      a0 = (a + 1.0) - (a - 1.0) * cosW + shelf;
+      a1 = 2.0 * ((a - 1.0) - (a + 1.0) * cosW);
+      a2 = (a + 1.0) - (a - 1.0) * cosW - shelf;
+      break;
+    default: // PEAKING
+      b0 = 1.0 + alpha * a; b1 = -2.0 * cosW; b2 = 1.0 - alpha * a;
+      a0 = 1.0 + alpha / a; a1 = -2.0 * cosW; a2 = 1.0 - alpha / a;
+      break;
+    }
+    mB0 = b0 / a0; mB1 = b1 / a0; mB2 = b2 / a0;
+    mA1 = a1 / a0; mA2 = a2 / a0;
+  }
+
+  void process(float *buf, uint32_t numFrames) {
+    for (uint32_t c = 0; c < mChannels; ++c) {
+      double z1 = mZ1[c];
+      double z2 = mZ2[c];
+      for (uint32_t f = 0; f < numFrames; ++f) {
+        double x = buf[f * mChannels + c];
+        double y = mB0 * x + z1;
+        z1 = mB1 * x - mA1 * y + z2;
+        z2 = mB2 * x - mA2 * y;
+        buf[f * mChannels + c] = (float)y;
+      }
+      mZ1[c] = std::fabs(z1) < sDenormal ? 0.0 : z1;
+      mZ2[c] = std::fabs(z2) < sDenormal ? 0.0 : z2;
+    }
+  }
+
+private:
+  const uint32_t mChannels;
+  double mB0, mB1, mB2, mA1, mA2;
+  std::vector<double> mZ1;
+  std::vector<double> mZ2;
+};
+
+static bool parseType(const std::string &str, InsertChain::eType &type) {
+  if (0 == str.compare("gain"))
+    type = InsertChain::eType::GAIN;
+  else if (0 == str.compare("meter"))
+    type = InsertChain::eType::METER;
+  else if (0 == str.compare("dcBlock"))
+    type = InsertChain::eType::DC_BLOCK;
+  else if (0 == str.compare("biquad"))
+    type = InsertChain::eType::BIQUAD;
+  else
+    return false;
+  return true;
+}
+
+InsertChain::InsertChain(uint32_t channels, uint32_t deviceFormat, double sampleRate, bool dither,
+                         const std::vector<std::shared_ptr<InsertOptions> > &inserts)
+  : mChannels(channels), mDeviceFormat(deviceFormat),
+    mDecoder(deviceFormat, 1, false), mEncoder(1, deviceFormat, dither),
+    mScratch(1 == deviceFormat ? 0 : sBlockFrames * channels) {
+  for (const auto &options : inserts) {
+    eType type = eType::GAIN;
+    parseType(options->type(), type);
+    switch (type) {
+    case eType::METER: {
+      MeterInsert *meter = new MeterInsert(channels, sampleRate, options->windowMs());
+      mMeters.push_back(meter);
+      mInserts.push_back(std::unique_ptr<Insert>(meter));
+      break;
+    }
+    case eType::DC_BLOCK:
+      mInserts.push_back(std::unique_ptr<Insert>(new DcBlockInsert(channels, sampleRate, options->cutoff())));
+      break;
+    case eType::BIQUAD: {
+      BiquadInsert::eShape shape = BiquadInsert::eShape::PEAKING;
+      BiquadInsert::parseShape(options->shape(), shape);
+      mInserts.push_back(std::unique_ptr<Insert>(new BiquadInsert(channels, sampleRate, shape,
+        options->frequency(), options->q(), options->gainDb())));
+      break;
+    }
+    default:
+      mInserts.push_back(std::unique_ptr<Insert>(new GainInsert(channels, sampleRate,
+        (float)options->gain(), options->mute(), options->rampMs())));
+      break;
+    }
+  }
+}
+
+bool InsertChain::validate(const std::vector<std::shared_ptr<InsertOptions> > &inserts, std::string &err) {
+  for (const auto &options : inserts) {
+    eType type;
+    BiquadInsert::eShape shape;
+    if (!parseType(options->type(), type))
+      err = "Invalid insert type \'" + options->type() + "\' - expects \'gain\', \'meter\', \'dcBlock\' or \'biquad\'";
+    else if ((eType::GAIN == type) && (options->rampMs() < 0.0))
+      err = "Insert rampMs must not be negative";
+    else if ((eType::METER == type) && (options->windowMs() <= 0.0))
+      err = "Insert windowMs must be positive";
+    else if ((eType::DC_BLOCK == type) && (options->cutoff() <= 0.0))
+      err = "Insert cutoff must be positive";
+    else if ((eType::BIQUAD == type) && !BiquadInsert::parseShape(options->shape(), shape))
+      err = "Invalid biquad shape \'" + options->shape() + "\' - expects \'lowpass\', \'highpass\', \'bandpass\', \'notch\', \'peaking\', \'lowshelf\' or \'highshelf\'";
+    else if ((eType::BIQUAD == type) && ((options->frequency() <= 0.0) || (options->q() <= 0.0)))
+      err = "Biquad frequency and q must be positive";
+    if (!err.empty())
+      return false;
+  }
+  return true;
+}
+
+void InsertChain::process(const uint8_t *src, uint8_t *dst, uint32_t numFrames) {
+  uint32_t frameBytes = mChannels * SampleConverter::formatBytes(mDeviceFormat);
+  for (uint32_t f = 0; f < numFrames; f += sBlockFrames) {
+    uint32_t blockFrames = std::min<uint32_t>(sBlockFrames, numFrames - f);
+    if (1 == mDeviceFormat) {
+      // float samples are processed where they are
+      if (src != dst)
+        memcpy(dst, src, blockFrames * frameBytes);
+      processFloat((float *)dst, blockFrames);
+    } else {
+      mDecoder.convert(src, (uint8_t *)mScratch.data(), blockFrames * mChannels);
+      processFloat(mScratch.data(), blockFrames);
+      mEncoder.convert((const uint8_t *)mScratch.data(), dst, blockFrames * mChannels);
+    }
+    src += blockFrames * frameBytes;
+    dst += blockFrames * frameBytes;
+  }
+}
+
+bool InsertChain::setGain(uint32_t index, float gain, bool mute) {
+  return (index < mInserts.size()) && mInserts[index]->setGain(gain, mute);
+}
+
+void InsertChain::readMeter(uint32_t meter, std::vector<float> &peak, std::vector<float> &rms) {
+  if (meter < mMeters.size())
+    mMeters[meter]->read(peak, rms);
+}
+
+// private
+void InsertChain::processFloat(float *buf, uint32_t numFrames) {
+  for (auto &insert : mInserts)
+    insert->process(buf, numFrames);
+}
+
+} // namespace streampunk
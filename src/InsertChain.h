@@ -0,0 +1,89 @@
+/* Copyright 2019 Streampunk Media Ltd.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef INSERTCHAIN_H
+#define INSERTCHAIN_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "SampleConvert.h"
+
+namespace streampunk {
+
+class InsertOptions;
+
+// One DSP stage, working in place on interleaved float frames on the audio thread
+class Insert {
+public:
+  Insert() {}
+  virtual ~Insert() {}
+
+  virtual void process(float *buf, uint32_t numFrames) = 0;
+  // gain stages only - may be called from any thread
+  virtual bool setGain(float gain, bool mute) { return false; }
+
+private:
+  Insert(const Insert &);
+};
+
+class MeterInsert;
+
+// Gain, meter, DC block and biquad stages run in order over the device samples in the callback.
+// Integer device formats are decoded to float and encoded again a block at a time, so the chain
+// never allocates. Stage settings are fixed when the stream opens, apart from gain and mute.
+class InsertChain {
+public:
+  enum class eType : uint8_t { GAIN = 0, METER, DC_BLOCK, BIQUAD };
+
+  InsertChain(uint32_t channels, uint32_t deviceFormat, double sampleRate, bool dither,
+              const std::vector<std::shared_ptr<InsertOptions> > &inserts);
+  ~InsertChain() {}
+
+  // check the options before constructing a chain from them, returns false with a message if invalid
+  static bool validate(const std::vector<std::shared_ptr<InsertOptions> > &inserts, std::string &err);
+
+  uint32_t channels() const  { return mChannels; }
+  static uint32_t blockFrames() { return sBlockFrames; }
+
+  // real-time - src and dst may be the same buffer but must not otherwise overlap
+  void process(const uint8_t *src, uint8_t *dst, uint32_t numFrames);
+
+  // false unless the insert at index is a gain stage
+  bool setGain(uint32_t index, float gain, bool mute);
+
+  uint32_t numMeters() const  { return (uint32_t)mMeters.size(); }
+  // the peak since the last read and the current RMS of each channel, both linear
+  void readMeter(uint32_t meter, std::vector<float> &peak, std::vector<float> &rms);
+
+private:
+  static const uint32_t sBlockFrames = 256;
+
+  const uint32_t mChannels;
+  const uint32_t mDeviceFormat;
+  SampleConverter mDecoder;
+  SampleConverter mEncoder;
+  std::vector<float> mScratch;
+  std::vector<std::unique_ptr<Insert> > mInserts;
+  std::vector<MeterInsert *> mMeters;
+
+  void processFloat(float *buf, uint32_t numFrames);
+  InsertChain(const InsertChain &);
+};
+
+} // namespace streampunk
+
+#endif
@@ -30,17 +30,22 @@ public:
   }
 
   Memory(uint32_t numBytes) 
-    : mOwnAlloc(true), mNumBytes(numBytes), mBuf(new uint8_t[mNumBytes]) {}
+    : mOwnAlloc(true), mCapacity(numBytes), mNumBytes(numBytes), mBuf(new uint8_t[mCapacity]) {}
   Memory(uint8_t *buf, uint32_t numBytes) 
-    : mOwnAlloc(false), mNumBytes(numBytes), mBuf(buf) {}
+    : mOwnAlloc(false), mCapacity(numBytes), mNumBytes(numBytes), mBuf(buf) {}
   ~Memory() { if (mOwnAlloc) delete[] mBuf; }
 
   uint32_t numBytes() const { return mNumBytes; }
+  uint32_t capacity() const { return mCapacity; }
   uint8_t *buf() const { return mBuf; }
 
+  // reuse the allocation for a smaller or equal number of bytes
+  void setNumBytes(uint32_t numBytes) { mNumBytes = numBytes < mCapacity ? numBytes : mCapacity; }
+
 private:
   const bool mOwnAlloc;
-  const uint32_t mNumBytes;
+  const uint32_t mCapacity;
+  uint32_t mNumBytes;
   uint8_t *const mBuf;
 };
 
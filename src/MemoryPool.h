@@ -0,0 +1,86 @@
+/* Copyright 2019 Streampunk Media Ltd.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef MEMORYPOOL_H
+#define MEMORYPOOL_H
+
+#include "Chunks.h"
+#include <vector>
+#include <atomic>
+#include <mutex>
+
+namespace streampunk {
+
+// Fixed set of preallocated chunks of blockBytes each.
+// A block is free again once the pool holds the only reference to it,
+// i.e. when the finalizer of the JS Buffer that wrapped it has run.
+class MemoryPool {
+public:
+  MemoryPool(uint32_t numBlocks, uint32_t blockBytes, uint32_t numPeriods = 0)
+    : mBlockBytes(blockBytes), mNext(0), mHits(0), mMisses(0) {
+    for (uint32_t i = 0; i < numBlocks; ++i) {
+      mBlocks.push_back(std::make_shared<Chunk>(Memory::makeNew(blockBytes), 0.0));
+      mBlocks.back()->reservePeriods(numPeriods);
+    }
+  }
+  ~MemoryPool() {}
+
+  std::shared_ptr<Chunk> alloc(uint32_t numBytes, double ts) {
+    std::unique_lock<std::mutex> lk(m);
+    std::shared_ptr<Chunk> block = findFree(numBytes, ts);
+    lk.unlock();
+    return block ? block : std::make_shared<Chunk>(Memory::makeNew(numBytes), ts);
+  }
+
+  // Lock-free variant for a single caller on the real-time thread,
+  // never allocates and returns an empty pointer when no block is free
+  std::shared_ptr<Chunk> acquire(uint32_t numBytes, double ts) {
+    return findFree(numBytes, ts);
+  }
+
+  uint32_t numBlocks() const  { return (uint32_t)mBlocks.size(); }
+  uint32_t blockBytes() const  { return mBlockBytes; }
+  uint32_t hits() const  { return mHits; }
+  uint32_t misses() const  { return mMisses; }
+
+private:
+  const uint32_t mBlockBytes;
+  std::vector<std::shared_ptr<Chunk> > mBlocks;
+  size_t mNext;
+  std::atomic<uint32_t> mHits;
+  std::atomic<uint32_t> mMisses;
+  std::mutex m;
+
+  std::shared_ptr<Chunk> findFree(uint32_t numBytes, double ts) {
+    for (size_t i = 0; (numBytes <= mBlockBytes) && (i < mBlocks.size()); ++i) {
+      std::shared_ptr<Chunk> &block = mBlocks[mNext];
+      mNext = (mNext + 1) % mBlocks.size();
+      if (1 == block.use_count()) {
+        std::atomic_thread_fence(std::memory_order_acquire);
+        block->reset(numBytes, ts);
+        ++mHits;
+        return block;
+      }
+    }
+    ++mMisses;
+    return std::shared_ptr<Chunk>();
+  }
+
+  MemoryPool(const MemoryPool &);
+};
+
+} // namespace streampunk
+
+#endif
@@ -0,0 +1,233 @@
+/* Copyright 2019 Streampunk Media Ltd.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#include "Mixer.h"
+#include <algorithm>
+#include <chrono>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define MIXER_SSE
+#include <xmmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define MIXER_NEON
+#include <arm_neon.h>
+#endif
+
+namespace streampunk {
+
+const uint32_t Mixer::sMixFrames;
+
+// Bounds the wait for ring space - the callback signals without taking a lock
+static const std::chrono::milliseconds sRingWait(10);
+// samples decoded into float at a time by a writer
+static const uint32_t sStageSamples = 4096;
+
+// acc += src * pattern, where the pattern of per channel gains repeats every patternLen
+// samples - patternLen is a multiple of 4 so each vector takes a whole slice of it
+static void mixAdd(float *acc, const float *src, const float *pattern, uint32_t patternLen, uint32_t numSamples) {
+  uint32_t i = 0;
+  uint32_t p = 0;
+#if defined(MIXER_SSE)
+  for (; i + 4 <= numSamples; i += 4) {
+    _mm_storeu_ps(acc + i, _mm_add_ps(_mm_loadu_ps(acc + i), _mm_mul_ps(_mm_loadu_ps(src + i), _mm_loadu_ps(pattern + p))));
+    p = (p + 4 == patternLen) ? 0 : p + 4;
+  }
+#elif defined(MIXER_NEON)
+  for (; i + 4 <= numSamples; i += 4) {
+    vst1q_f32(acc + i, vmlaq_f32(vld1q_f32(acc + i), vld1q_f32(src + i), vld1q_f32(pattern + p)));
+    p = (p + 4 == patternLen) ? 0 : p + 4;
+  }
+#endif
+  for (; i < numSamples; ++i)
+    acc[i] += src[i] * pattern[i % patternLen];
+}
+
+// clamps to full scale, integer device formats saturate again on encode
+static void saturate(float *buf, uint32_t numSamples) {
+  uint32_t i = 0;
+#if defined(MIXER_SSE)
+  const __m128 lo = _mm_set1_ps(-1.0f);
+  const __m128 hi = _mm_set1_ps(1.0f);
+  for (; i + 4 <= numSamples; i += 4)
+    _mm_storeu_ps(buf + i, _mm_min_ps(hi, _mm_max_ps(lo, _mm_loadu_ps(buf + i))));
+#elif defined(MIXER_NEON)
+  const float32x4_t lo = vdupq_n_f32(-1.0f);
+  const float32x4_t hi = vdupq_n_f32(1.0f);
+  for (; i + 4 <= numSamples; i += 4)
+    vst1q_f32(buf + i, vminq_f32(hi, vmaxq_f32(lo, vld1q_f32(buf + i))));
+#endif
+  for (; i < numSamples; ++i)
+    buf[i] = std::min(1.0f, std::max(-1.0f, buf[i]));
+}
+
+Mixer::Mixer(uint32_t maxSources, uint32_t channels, uint32_t sampleFormat, uint32_t ringFrames)
+  : mChannels(channels), mScratch(sMixFrames * channels), mPattern(4 * channels), mActive(true) {
+  for (uint32_t i = 0; i < maxSources; ++i) {
+    mSources.push_back(std::unique_ptr<Source>(new Source(channels, sampleFormat, ringFrames)));
+    mSources.back()->stage.resize(sStageSamples - sStageSamples % channels);
+  }
+}
+
+int32_t Mixer::addSource(float gain, float pan, uint32_t &generation) {
+  std::lock_guard<std::mutex> lk(m);
+  for (uint32_t id = 0; id < mSources.size(); ++id) {
+    Source &source = *mSources[id];
+    // a writer of the last claim may not yet have seen it end
+    if ((FREE != source.state) || source.writers)
+      continue;
+    // the callback leaves free slots alone, so the ring can be emptied from here
+    source.ring.skip(source.ring.readAvailable());
+    source.gain = gain;
+    source.pan = pan;
+    source.underruns = 0;
+    source.primed = false;
+    // the generation moves on before the slot goes live, so old claims fail from here on
+    generation = ++source.generation;
+    source.state = ACTIVE;
+    return (int32_t)id;
+  }
+  return -1;
+}
+
+bool Mixer::setSource(uint32_t id, uint32_t generation, float gain, float pan) {
+  if (id >= mSources.size())
+    return false;
+  Source &source = *mSources[id];
+  if ((FREE == source.state) || (generation != source.generation))
+    return false;
+  source.gain = gain;
+  source.pan = pan;
+  return true;
+}
+
+void Mixer::removeSource(uint32_t id, uint32_t generation, bool drain) {
+  if (id >= mSources.size())
+    return;
+  std::lock_guard<std::mutex> lk(m);
+  Source &source = *mSources[id];
+  // addSource holds the same lock, so the generation cannot move on under this check
+  if (generation != source.generation)
+    return;
+  uint8_t state = source.state;
+  uint8_t next = drain ? DRAINING : REMOVING;
+  // the callback may free a draining source at any moment
+  while ((FREE != state) && (REMOVING != state) && !source.state.compare_exchange_weak(state, next))
+    ;
+  std::lock_guard<std::mutex> ringLk(mRingMutex);
+  mCv.notify_all();
+}
+
+uint32_t Mixer::underruns(uint32_t id) const {
+  return id < mSources.size() ? mSources[id]->underruns.load() : 0;
+}
+
+bool Mixer::write(uint32_t id, uint32_t generation, const uint8_t *buf, uint32_t numBytes) {
+  if (id >= mSources.size())
+    return false;
+  Source &source = *mSources[id];
+  uint32_t srcBytes = source.decoder.srcBytes();
+  uint32_t numSamples = numBytes / srcBytes;
+  // any trailing partial frame is dropped
+  numSamples -= numSamples % mChannels;
+
+  // counted in before the claim is checked, so the slot cannot be claimed again while this writes
+  ++source.writers;
+  uint32_t samplesDone = 0;
+  while (mActive && isLive(source, generation) && (samplesDone < numSamples)) {
+    uint32_t samplesAvailable = source.ring.writeAvailable();
+    samplesAvailable -= samplesAvailable % mChannels;
+    uint32_t count = std::min<uint32_t>(std::min<uint32_t>(numSamples - samplesDone, samplesAvailable), (uint32_t)source.stage.size());
+    if (count) {
+      source.decoder.convert(buf + samplesDone * srcBytes, (uint8_t *)source.stage.data(), count);
+      source.ring.write(source.stage.data(), count);
+      samplesDone += count;
+    }
+
+    std::unique_lock<std::mutex> lk(mRingMutex);
+    while (mActive && isLive(source, generation) && (samplesDone < numSamples) && (source.ring.writeAvailable() < mChannels))
+      mCv.wait_for(lk, sRingWait);
+  }
+  --source.writers;
+  return samplesDone == numSamples;
+}
+
+void Mixer::quit() {
+  std::lock_guard<std::mutex> lk(mRingMutex);
+  mActive = false;
+  mCv.notify_all();
+}
+
+uint32_t Mixer::mix(float *dst, uint32_t numFrames) {
+  uint32_t numSamples = numFrames * mChannels;
+  std::fill(dst, dst + numSamples, 0.0f);
+
+  uint32_t maxFrames = 0;
+  bool consumed = false;
+  for (auto &s : mSources) {
+    Source &source = *s;
+    uint8_t state = source.state.load(std::memory_order_acquire);
+    if (FREE == state)
+      continue;
+    if (REMOVING == state) {
+      source.primed = false;
+      source.state = FREE;
+      continue;
+    }
+
+    setPattern(source.gain, source.pan);
+    uint32_t framesRead = 0;
+    while (framesRead < numFrames) {
+      uint32_t count = std::min<uint32_t>(sMixFrames, numFrames - framesRead);
+      uint32_t samplesRead = source.ring.read(mScratch.data(), count * mChannels);
+      mixAdd(dst + framesRead * mChannels, mScratch.data(), mPattern.data(), (uint32_t)mPattern.size(), samplesRead);
+      framesRead += samplesRead / mChannels;
+      if (samplesRead < count * mChannels)
+        break;
+    }
+    maxFrames = std::max(maxFrames, framesRead);
+    consumed = consumed || framesRead;
+
+    if (framesRead < numFrames) {
+      if (DRAINING == state) {
+        // only this thread moves a draining source on, so the store cannot lose a removal
+        uint8_t expected = DRAINING;
+        if (source.state.compare_exchange_strong(expected, FREE))
+          source.primed = false;
+      } else if (source.primed)
+        ++source.underruns;
+    }
+    if (framesRead)
+      source.primed = true;
+  }
+
+  saturate(dst, numSamples);
+  if (consumed)
+    mCv.notify_all();
+  return maxFrames;
+}
+
+// private
+void Mixer::setPattern(float gain, float pan) {
+  // pan is a balance across the first two channels, leaving the centre at unity gain
+  pan = std::min(1.0f, std::max(-1.0f, pan));
+  float left = gain * std::min(1.0f, 1.0f - pan);
+  float right = gain * std::min(1.0f, 1.0f + pan);
+  for (uint32_t i = 0; i < mPattern.size(); ++i) {
+    uint32_t c = i % mChannels;
+    mPattern[i] = (mChannels < 2) || (c > 1) ? gain : (0 == c ? left : right);
+  }
+}
+
+} // namespace streampunk
@@ -0,0 +1,102 @@
+/* Copyright 2019 Streampunk Media Ltd.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef MIXER_H
+#define MIXER_H
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <vector>
+#include "RingBuffer.h"
+#include "SampleConvert.h"
+
+namespace streampunk {
+
+// Sums a fixed number of source slots into one interleaved float output in the audio callback.
+// Each source has its own ring of float frames, written by a single non real-time thread
+// in the stream sampleFormat, and its own gain and pan that can be changed at any time.
+// Slots are claimed and released by state changes that the callback acknowledges, so the
+// callback never waits on a lock or sees a ring being reset. Each claim of a slot has a new
+// generation, so a call still holding an earlier claim can never reach the new source.
+class Mixer {
+public:
+  Mixer(uint32_t maxSources, uint32_t channels, uint32_t sampleFormat, uint32_t ringFrames);
+  ~Mixer() {}
+
+  uint32_t maxSources() const  { return (uint32_t)mSources.size(); }
+  uint32_t channels() const  { return mChannels; }
+
+  // returns the id of a free slot, or -1 if every slot is in use, and the generation of the claim
+  int32_t addSource(float gain, float pan, uint32_t &generation);
+  bool setSource(uint32_t id, uint32_t generation, float gain, float pan);
+  // drain plays out what has been written before the slot is released
+  void removeSource(uint32_t id, uint32_t generation, bool drain);
+  uint32_t underruns(uint32_t id) const;
+
+  // waits for ring space, returns false if the source was removed or the mixer quit first
+  bool write(uint32_t id, uint32_t generation, const uint8_t *buf, uint32_t numBytes);
+  void quit();
+
+  // real-time - writes the saturated sum of numFrames frames from every source to dst
+  // and returns the most frames any source had available
+  uint32_t mix(float *dst, uint32_t numFrames);
+
+private:
+  enum eState : uint8_t { FREE = 0, ACTIVE, DRAINING, REMOVING };
+
+  struct Source {
+    Source(uint32_t channels, uint32_t sampleFormat, uint32_t ringFrames)
+      : state(FREE), generation(0), writers(0), gain(1.0f), pan(0.0f), underruns(0), primed(false),
+        ring(ringFrames * channels), decoder(sampleFormat, 1, false) {}
+
+    std::atomic<uint8_t> state;
+    std::atomic<uint32_t> generation;
+    // writes in progress, a slot is not claimed again until they have all seen it change
+    std::atomic<uint32_t> writers;
+    std::atomic<float> gain;
+    std::atomic<float> pan;
+    std::atomic<uint32_t> underruns;
+    // callback only - whether the source has delivered since it was added
+    bool primed;
+    RingBuffer<float> ring;
+    // writer only
+    SampleConverter decoder;
+    std::vector<float> stage;
+  };
+
+  static const uint32_t sMixFrames = 256;
+
+  const uint32_t mChannels;
+  std::vector<std::unique_ptr<Source> > mSources;
+  std::vector<float> mScratch;
+  std::vector<float> mPattern;
+  std::atomic<bool> mActive;
+  std::mutex m;
+  std::mutex mRingMutex;
+  std::condition_variable mCv;
+
+  bool isLive(const Source &source, uint32_t generation) const {
+    return (ACTIVE == source.state) && (generation == source.generation);
+  }
+  void setPattern(float gain, float pan);
+  Mixer(const Mixer &);
+};
+
+} // namespace streampunk
+
+#endif
@@ -0,0 +1,94 @@
+/* Copyright 2019 Streampunk Media Ltd.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#include "NullDevice.h"
+#include <cstring>
+
+namespace streampunk {
+
+NullDevice::NullDevice(PaStreamCallback *callback, void *userData, double sampleRate, uint32_t framesPerBuffer,
+                       const Format &inFormat, const Format &outFormat, double inLatency, double outLatency, double speed)
+  : mCallback(callback), mUserData(userData), mSampleRate(sampleRate), mFramesPerBuffer(framesPerBuffer),
+    mInLatency(inLatency), mOutLatency(outLatency), mSpeed(speed), mInput(nullptr), mOutput(nullptr),
+    mActive(false), mCpuLoad(0.0), mPeriods(0), mStart(std::chrono::steady_clock::now()) {
+  makeBuffer(inFormat, mInBuf, mInPlanes, mInput);
+  makeBuffer(outFormat, mOutBuf, mOutPlanes, mOutput);
+}
+
+NullDevice::~NullDevice() {
+  stop();
+}
+
+void NullDevice::start() {
+  stop();
+  mStart = std::chrono::steady_clock::now();
+  mPeriods = 0;
+  mActive = true;
+  mThread = std::thread(&NullDevice::run, this);
+}
+
+void NullDevice::stop() {
+  mActive = false;
+  if (mThread.joinable())
+    mThread.join();
+}
+
+double NullDevice::time() const {
+  // running flat out, time only moves on as periods are processed
+  if (mSpeed <= 0.0)
+    return mPeriods * (mFramesPerBuffer / mSampleRate);
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - mStart;
+  return elapsed.count() * mSpeed;
+}
+
+// private
+void NullDevice::makeBuffer(const Format &format, std::vector<uint8_t> &buf, std::vector<void *> &planes, void *&ptr) {
+  if (!format.channels)
+    return;
+  uint32_t planeBytes = mFramesPerBuffer * format.sampleBytes * (format.interleaved ? format.channels : 1);
+  uint32_t numPlanes = format.interleaved ? 1 : format.channels;
+  buf.resize(planeBytes * numPlanes);
+  for (uint32_t p = 0; p < numPlanes; ++p)
+    planes.push_back(buf.data() + p * planeBytes);
+  ptr = format.interleaved ? (void *)buf.data() : (void *)planes.data();
+}
+
+void NullDevice::run() {
+  double period = mFramesPerBuffer / mSampleRate;
+  double realPeriod = mSpeed > 0.0 ? period / mSpeed : period;
+  uint64_t numPeriods = 0;
+  while (mActive) {
+    double deviceTime = numPeriods * period;
+    PaStreamCallbackTimeInfo timeInfo = { deviceTime - mInLatency, deviceTime, deviceTime + mOutLatency };
+    // input stays silent, so clear what a previous callback may have mixed into it
+    if (!mInBuf.empty())
+      memset(mInBuf.data(), 0, mInBuf.size());
+
+    std::chrono::steady_clock::time_point callbackStart = std::chrono::steady_clock::now();
+    int result = mCallback(mInput, mOutput, mFramesPerBuffer, &timeInfo, 0, mUserData);
+    std::chrono::duration<double> callbackTime = std::chrono::steady_clock::now() - callbackStart;
+    mCpuLoad = 0.9 * mCpuLoad + 0.1 * (callbackTime.count() / realPeriod);
+    mPeriods = ++numPeriods;
+    if (paContinue != result)
+      break;
+
+    if (mSpeed > 0.0)
+      std::this_thread::sleep_until(mStart + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(numPeriods * realPeriod)));
+  }
+  mActive = false;
+}
+
+} // namespace streampunk
@@ -0,0 +1,81 @@
+/* Copyright 2019 Streampunk Media Ltd.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef NULLDEVICE_H
+#define NULLDEVICE_H
+
+#include <portaudio.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+namespace streampunk {
+
+// Stands in for a PortAudio device so the stream pipeline can be driven without sound hardware.
+// A thread calls the stream callback once a period with silent input, at the pace of a device
+// running at the sample rate times speed, or as fast as it can go when speed is zero.
+class NullDevice {
+public:
+  struct Format {
+    uint32_t channels;
+    uint32_t sampleBytes;
+    bool interleaved;
+  };
+
+  NullDevice(PaStreamCallback *callback, void *userData, double sampleRate, uint32_t framesPerBuffer,
+             const Format &inFormat, const Format &outFormat, double inLatency, double outLatency, double speed);
+  ~NullDevice();
+
+  void start();
+  // waits for the callback thread to finish
+  void stop();
+  // false once stopped or the callback has returned paComplete
+  bool isActive() const { return mActive; }
+
+  // device time in seconds, advancing at speed times real time, or a period per callback at speed zero
+  double time() const;
+  // fraction of each real time period spent in the callback
+  double cpuLoad() const { return mCpuLoad; }
+
+private:
+  PaStreamCallback *mCallback;
+  void *mUserData;
+  const double mSampleRate;
+  const uint32_t mFramesPerBuffer;
+  const double mInLatency;
+  const double mOutLatency;
+  const double mSpeed;
+  std::vector<uint8_t> mInBuf;
+  std::vector<uint8_t> mOutBuf;
+  // buffer pointers as the callback expects them, one per channel when non-interleaved
+  std::vector<void *> mInPlanes;
+  std::vector<void *> mOutPlanes;
+  void *mInput;
+  void *mOutput;
+  std::atomic<bool> mActive;
+  std::atomic<double> mCpuLoad;
+  std::atomic<uint64_t> mPeriods;
+  std::chrono::steady_clock::time_point mStart;
+  std::thread mThread;
+
+  void makeBuffer(const Format &format, std::vector<uint8_t> &buf, std::vector<void *> &planes, void *&ptr);
+  void run();
+  NullDevice(const NullDevice &);
+};
+
+} // namespace streampunk
+
+#endif
@@ -0,0 +1,182 @@
+/* Copyright 2019 Streampunk Media Ltd.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#include "PaBridge.h"
+#include "Params.h"
+#include "Resampler.h"
+#include <algorithm>
+#include <cmath>
+
+namespace streampunk {
+
+// clock rates are only measured once callback jitter has had time to average out
+static const double sSettleSecs = 2.0;
+// time constant for smoothing the latency error
+static const double sSmoothSecs = 1.0;
+// proportional and integral gains on the latency error in seconds
+static const double sKp = 0.1;
+static const double sKi = 0.01;
+// largest ratio correction applied, 5000ppm is well beyond any real crystal
+static const double sMaxAdjust = 0.005;
+
+PaBridge::PaBridge(Napi::Env env, Napi::Object inOptions, Napi::Object outOptions, Napi::Object bridgeOptions)
+  : mOptions(std::make_shared<BridgeOptions>(env, bridgeOptions)),
+    mInContext(std::make_shared<PaContext>(env, inOptions, Napi::Object())),
+    mOutContext(std::make_shared<PaContext>(env, Napi::Object(), outOptions)),
+    mOutChunkFrames(0), mRunning(false), mRatioAdjust(1.0), mDriftPpm(0.0), mLatencyMs(0.0) {
+
+  std::shared_ptr<AudioOptions> in = mInContext->getInOptions();
+  std::shared_ptr<AudioOptions> out = mOutContext->getOutOptions();
+  if (in->channelCount() != out->channelCount())
+    throw Napi::Error::New(env, "AudioBridge input and output channel counts must match");
+  if (!in->interleaved() || !out->interleaved())
+    throw Napi::Error::New(env, "AudioBridge requires interleaved samples");
+  if (in->zeroCopy())
+    throw Napi::Error::New(env, "AudioBridge does not support zeroCopy");
+  if (0 == mOptions->blockFrames())
+    throw Napi::Error::New(env, "AudioBridge blockFrames must be greater than zero");
+
+  Resampler::eQuality quality;
+  if (!Resampler::parseQuality(mOptions->resampleQuality(), quality))
+    throw Napi::Error::New(env, "Invalid resampleQuality - expects \'low\', \'medium\' or \'high\'");
+
+  if (!in->quiet() && !out->quiet())
+    printf("%s\n", mOptions->toString().c_str());
+
+  // always resample, even between equal rates, so that the ratio can follow the drift
+  double inRate = in->targetSampleRate();
+  double outRate = out->targetSampleRate();
+  mResampler = std::make_shared<ResampleStage>(in->channelCount(), in->sampleFormat(), out->sampleFormat(),
+                                               inRate, outRate, quality, out->dither());
+
+  // input chunks may run a little over the block size when the input context resamples
+  mOutChunkFrames = (uint32_t)std::ceil(2 * mOptions->blockFrames() * outRate / inRate * (1.0 + sMaxAdjust)) + 16;
+  mOutChunk = std::make_shared<Chunk>(Memory::makeNew(mOutChunkFrames * out->frameBytes()), 0.0);
+
+  // start pushes the target latency of silence on the JS thread, a block must still fit alongside it
+  double deviceFramesPerOut = (double)out->sampleRate() / outRate;
+  uint32_t targetFrames = (uint32_t)std::ceil(mOptions->targetLatencyMs() * out->sampleRate() / 1000.0);
+  if (targetFrames + mOutChunkFrames * deviceFramesPerOut > out->ringFrames())
+    throw Napi::Error::New(env, "AudioBridge targetLatencyMs must leave room for a block in the output ring - raise ringFrames or bufferMs");
+}
+
+PaBridge::~PaBridge() {
+  stop(PaContext::eStopFlag::ABORT);
+}
+
+void PaBridge::start(Napi::Env env) {
+  // start the output ring at the target latency rather than building up to it through underruns
+  std::shared_ptr<AudioOptions> out = mOutContext->getOutOptions();
+  uint32_t targetFrames = mOptions->targetLatencyMs() * out->targetSampleRate() / 1000;
+  std::shared_ptr<Chunk> silence = std::make_shared<Chunk>(Memory::makeNew(targetFrames * out->frameBytes()), 0.0);
+  memset(silence->buf(), 0, silence->numBytes());
+  mOutContext->pushOutChunk(silence);
+
+  mOutContext->start(env);
+  mInContext->start(env);
+  mRunning = true;
+  mThread = std::thread(&PaBridge::run, this);
+}
+
+void PaBridge::stop(PaContext::eStopFlag flag) {
+  mRunning = false;
+  mInContext->quit();
+  if (mThread.joinable())
+    mThread.join();
+  mInContext->stop(PaContext::eStopFlag::ABORT);
+  mOutContext->stop(flag);
+  mOutContext->quit();
+}
+
+// private
+void PaBridge::run() {
+  mInContext->initWorkerThread("bridge");
+  std::shared_ptr<AudioOptions> in = mInContext->getInOptions();
+  std::shared_ptr<AudioOptions> out = mOutContext->getOutOptions();
+  const double inNominal = in->targetSampleRate();
+  const double outNominal = out->sampleRate();
+  const double targetFrames = mOptions->targetLatencyMs() * outNominal / 1000.0;
+  const uint32_t inFrameBytes = in->frameBytes();
+  const uint32_t outFrameBytes = out->frameBytes();
+
+  // input clock - frames delivered since the first chunk against that chunk's ADC time
+  bool haveIn = false;
+  double inStartTs = 0.0;
+  uint64_t inFrames = 0;
+  // output clock - device frames played against DAC time
+  bool haveOut = false;
+  TimeMark outStart = { 0, 0.0 };
+  TimeMark outMark = { 0, 0.0 };
+  uint32_t outLastPos = 0;
+  uint64_t outFrames = 0;
+
+  double drift = 1.0;
+  double err = 0.0;
+  double integral = 0.0;
+  while (mRunning) {
+    bool finished = false;
+    std::shared_ptr<Chunk> chunk = mInContext->pullInChunk(mOptions->blockFrames() * inFrameBytes, finished);
+    if (finished || !mRunning)
+      break;
+    uint32_t numFrames = chunk->numBytes() / inFrameBytes;
+    if (0 == numFrames)
+      continue;
+
+    if (!haveIn) {
+      inStartTs = chunk->ts();
+      haveIn = true;
+    }
+    double inElapsed = chunk->ts() - inStartTs;
+    double inRate = inElapsed > 0.0 ? inFrames / inElapsed : inNominal;
+    inFrames += numFrames;
+
+    if (mOutContext->readOutTime(outMark)) {
+      if (!haveOut) {
+        outStart = outMark;
+        outLastPos = outMark.pos;
+        haveOut = true;
+      }
+      // the frame count wraps, accumulate it in 64 bits
+      outFrames += (uint32_t)(outMark.pos - outLastPos);
+      outLastPos = outMark.pos;
+    }
+    double outElapsed = outMark.ts - outStart.ts;
+
+    // feed forward the ratio of the measured clock rates
+    if ((inElapsed > sSettleSecs) && (outElapsed > sSettleSecs))
+      drift = (inRate / inNominal) / ((outFrames / outElapsed) / outNominal);
+
+    // and trim it to hold the output ring at the target latency
+    double fill = mOutContext->outQueuedFrames();
+    double dt = numFrames / inNominal;
+    err += std::min(1.0, dt / sSmoothSecs) * ((fill - targetFrames) / outNominal - err);
+    integral = std::max(-sMaxAdjust / sKi, std::min(sMaxAdjust / sKi, integral + err * dt));
+    double adjust = drift * (1.0 + sKp * err + sKi * integral);
+    adjust = std::max(1.0 - sMaxAdjust, std::min(1.0 + sMaxAdjust, adjust));
+    mResampler->setRatioAdjust(adjust);
+
+    mRatioAdjust = adjust;
+    mDriftPpm = (drift - 1.0) * 1e6;
+    mLatencyMs = fill * 1000.0 / outNominal;
+
+    // the chunk is sized for the largest ratio correction, this only trims a runaway input chunk
+    numFrames = std::min(numFrames, mResampler->inputFramesFor(mOutChunkFrames));
+    uint32_t numOut = mResampler->process(chunk->buf(), numFrames, mOutChunk->buf());
+    mOutChunk->reset(numOut * outFrameBytes, chunk->ts());
+    mOutContext->pushOutChunk(mOutChunk);
+  }
+}
+
+} // namespace streampunk
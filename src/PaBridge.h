@@ -0,0 +1,70 @@
+/* Copyright 2019 Streampunk Media Ltd.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef PABRIDGE_H
+#define PABRIDGE_H
+
+#include <napi.h>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include "PaContext.h"
+
+namespace streampunk {
+
+class BridgeOptions;
+class ResampleStage;
+
+// Passes audio from an input device to an output device on separate PortAudio streams.
+// The devices run from different clocks, so a bridge thread resamples between them by
+// a ratio that follows the drift measured from the stream timestamps, trimmed to hold
+// the output ring at the target latency.
+class PaBridge {
+public:
+  PaBridge(Napi::Env env, Napi::Object inOptions, Napi::Object outOptions, Napi::Object bridgeOptions);
+  ~PaBridge();
+
+  void start(Napi::Env env);
+  void stop(PaContext::eStopFlag flag);
+
+  std::shared_ptr<PaContext> getInContext() const { return mInContext; }
+  std::shared_ptr<PaContext> getOutContext() const { return mOutContext; }
+
+  // the resampling ratio correction currently applied, 1.0 when the clocks agree
+  double ratioAdjust() const { return mRatioAdjust.load(); }
+  // drift of the input clock against the output clock measured from the stream timestamps
+  double driftPpm() const { return mDriftPpm.load(); }
+  double latencyMs() const { return mLatencyMs.load(); }
+
+private:
+  std::shared_ptr<BridgeOptions> mOptions;
+  std::shared_ptr<PaContext> mInContext;
+  std::shared_ptr<PaContext> mOutContext;
+  std::shared_ptr<ResampleStage> mResampler;
+  std::shared_ptr<Chunk> mOutChunk;
+  uint32_t mOutChunkFrames;
+  std::atomic<bool> mRunning;
+  std::atomic<double> mRatioAdjust;
+  std::atomic<double> mDriftPpm;
+  std::atomic<double> mLatencyMs;
+  std::thread mThread;
+
+  void run();
+  PaBridge(const PaBridge &);
+};
+
+} // namespace streampunk
+
+#endif
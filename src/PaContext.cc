@@ -16,67 +16,252 @@
 #include "PaContext.h"
 #include "Params.h"
 #include "Chunks.h"
+#include "MemoryPool.h"
+#include "RingBuffer.h"
+#include "PaHost.h"
+#include "SampleConvert.h"
+#include "ChannelMap.h"
+#include "Resampler.h"
+#include "Mixer.h"
+#include "Histogram.h"
+#include "NullDevice.h"
+#include "InsertChain.h"
+#include "SharedRing.h"
 #include <portaudio.h>
+#include <cmath>
+#ifdef __APPLE__
+#include <pa_mac_core.h>
+#endif
+#include <chrono>
 
 namespace streampunk {
 
+// Bounds the wait on the non real-time side - the callback signals without taking a lock
+// so a notification may occasionally be missed
+static const std::chrono::milliseconds sRingWait(10);
+
+// channels offered by the null device, and its period when framesPerBuffer is not set
+static const int sNullDeviceChannels = 256;
+static const uint32_t sNullDeviceFrames = 256;
+
+// frames of scratch space for mapping channels in the callback
+static const uint32_t sMapFrames = 256;
+// frames of float scratch space for mixing input into output in the callback
+static const uint32_t sPassFrames = 256;
+// frames of float scratch space for mixing sources in the callback
+static const uint32_t sMixFrames = 256;
+
+// host API specific stream info, which must outlive Pa_OpenStream
+struct HostChannelMap {
+#ifdef __APPLE__
+  PaMacCoreStreamInfo macCoreInfo;
+#endif
+};
+
 int PaCallback(const void *input, void *output, unsigned long frameCount, 
                const PaStreamCallbackTimeInfo *timeInfo, 
                PaStreamCallbackFlags statusFlags, void *userData) {
   PaContext *paContext = (PaContext *)userData;
+  if (paContext->callbackThreadPending())
+    paContext->initCallbackThread();
+  std::chrono::steady_clock::time_point start;
+  if (paContext->hasTiming())
+    start = std::chrono::steady_clock::now();
   double inTimestamp = timeInfo->inputBufferAdcTime > 0.0 ?
     timeInfo->inputBufferAdcTime :
     paContext->getCurTime() - paContext->getInLatency(); // approximation for timestamp of first sample
-  double outTimestamp = timeInfo->outputBufferDacTime;
+  double outTimestamp = timeInfo->outputBufferDacTime > 0.0 ?
+    timeInfo->outputBufferDacTime :
+    paContext->getCurTime() + paContext->getOutLatency();
   paContext->checkStatus(statusFlags);
   int inRetCode = paContext->hasInput() && paContext->readPaBuffer(input, frameCount, inTimestamp) ? paContinue : paComplete;
-  int outRetCode = paContext->hasOutput() && paContext->fillPaBuffer(output, frameCount) ? paContinue : paComplete;
+  int outRetCode = paContext->hasOutput() && paContext->fillPaBuffer(output, frameCount, outTimestamp) ? paContinue : paComplete;
+  if (paContext->hasPassthrough() && input && output)
+    paContext->passthrough(input, output, frameCount);
+  // the output chain processes all that reaches the device, passthrough included
+  if (paContext->hasOutInserts())
+    paContext->applyOutInserts(output, frameCount);
+  if (paContext->hasOutput() && (paComplete == outRetCode))
+    paContext->outputFinished();
+  if (paContext->hasTiming())
+    paContext->recordTiming(start, timeInfo->inputBufferAdcTime, timeInfo->outputBufferDacTime);
   return ((inRetCode == paComplete) && (outRetCode == paComplete)) ? paComplete : paContinue;
 }
 
 PaContext::PaContext(Napi::Env env, Napi::Object inOptions, Napi::Object outOptions)
-  : mInOptions(inOptions.IsEmpty() ? std::shared_ptr<AudioOptions>() : std::make_shared<AudioOptions>(env, inOptions)), 
+  : mPaHost(PaHost::acquire(env)),
+    mInOptions(inOptions.IsEmpty() ? std::shared_ptr<AudioOptions>() : std::make_shared<AudioOptions>(env, inOptions)), 
     mOutOptions(outOptions.IsEmpty() ? std::shared_ptr<AudioOptions>() : std::make_shared<AudioOptions>(env, outOptions)),
-    mInChunks(new Chunks(mInOptions ? mInOptions->maxQueue() : 0)),
-    mOutChunks(new Chunks(mOutOptions ? mOutOptions->maxQueue() : 0)),
-    mStream(nullptr) {
-
-  PaError errCode = Pa_Initialize();
-  if (errCode != paNoError) {
-    std::string err = std::string("Could not initialize PortAudio: ") + Pa_GetErrorText(errCode);
-    throw Napi::Error::New(env, err.c_str());
-  }
+    mCaptureOffset(0), mInDeviceChannels(0), mOutDeviceChannels(0), mPassInChannels(0), mPassGain(1.0f),
+    mCurTime({ 0, 0.0 }), mDropFrames(0), mOutFrames(0),
+    mPrefillFrames(mOutOptions ? mOutOptions->prefillFrames() : 0), mPrefilling(mPrefillFrames > 0),
+    mLowWaterFrames(mOutOptions ? mOutOptions->lowWaterFrames() : 0), mLowWaterArmed(true),
+    mActive(true), mStatusFlags(0),
+    mEventLog(std::make_shared<EventLog>(256)), mOutFinished(false),
+    mQuiet((mInOptions && mInOptions->quiet()) || (mOutOptions && mOutOptions->quiet())),
+    mLastAdcTime(0.0), mLastDacTime(0.0), mStream(nullptr), mCallbackThreadSet(false),
+    mInShared(nullptr), mOutShared(nullptr), mReadsPending(0), mWritesPending(0),
+    mInPeriodBytes(0) {
 
   if (!mInOptions && !mOutOptions)
     throw Napi::Error::New(env, "Input and/or Output options must be specified");
 
   if (mInOptions && mOutOptions &&
       (mInOptions->sampleRate() != mOutOptions->sampleRate()))
-    throw Napi::Error::New(env, "Input and Output sample rates must match");
+    throw Napi::Error::New(env, "Input and Output sample rates must match - set targetSampleRate to use a different rate in JS");
 
-  printf("%s\n", Pa_GetVersionInfo()->versionText);
-  if (mInOptions)
-    printf("Input %s\n", mInOptions->toString().c_str());
+  if (mInOptions && mOutOptions && mInOptions->framesPerBuffer() && mOutOptions->framesPerBuffer() &&
+      (mInOptions->framesPerBuffer() != mOutOptions->framesPerBuffer()))
+    throw Napi::Error::New(env, "Input and Output framesPerBuffer must match");
+
+  if (mInOptions && mOutOptions && (mInOptions->nullDevice() != mOutOptions->nullDevice()))
+    throw Napi::Error::New(env, "Input and Output must both use the null device or neither");
+  bool nullDevice = (mInOptions && mInOptions->nullDevice()) || (mOutOptions && mOutOptions->nullDevice());
+
+  if (mInOptions && mInOptions->zeroCopy() && mInOptions->converting())
+    throw Napi::Error::New(env, "zeroCopy requires deviceFormat to match sampleFormat");
+  if (mInOptions && mInOptions->zeroCopy() && !mInOptions->interleaved())
+    throw Napi::Error::New(env, "zeroCopy requires interleaved samples");
+  if (mInOptions && mInOptions->zeroCopy() && !mInOptions->channelMap().empty())
+    throw Napi::Error::New(env, "zeroCopy cannot be combined with a channelMap");
+
+  if (mInOptions && mInOptions->zeroCopy() && mInOptions->resampling())
+    throw Napi::Error::New(env, "zeroCopy requires targetSampleRate to match sampleRate");
+
+  // a shared ring holds the samples exactly as JS asked for them
+  if (mInOptions && mInOptions->sharedRing() &&
+      (mInOptions->zeroCopy() || mInOptions->converting() || mInOptions->resampling() || !mInOptions->interleaved()))
+    throw Napi::Error::New(env, "sharedRing requires interleaved samples without zeroCopy, a deviceFormat or a targetSampleRate");
+  if (mOutOptions && mOutOptions->sharedRing() &&
+      (mOutOptions->converting() || mOutOptions->resampling() || !mOutOptions->interleaved() ||
+       mOutOptions->mixerSources() || mOutOptions->scheduled()))
+    throw Napi::Error::New(env, "sharedRing requires interleaved samples without a deviceFormat, a targetSampleRate, mixerSources or scheduled");
+
+  if (mInOptions && mInOptions->resampling())
+    makeResamplers(env, /*isInput*/true, mInOptions, mInResamplers);
+  else if (mInOptions && mInOptions->converting())
+    mInConverter = std::make_shared<SampleConverter>(mInOptions->deviceFormat(), mInOptions->sampleFormat(), mInOptions->dither());
+  if (mOutOptions && mOutOptions->resampling())
+    makeResamplers(env, /*isInput*/false, mOutOptions, mOutResamplers);
+  else if (mOutOptions && mOutOptions->converting())
+    mOutConverter = std::make_shared<SampleConverter>(mOutOptions->sampleFormat(), mOutOptions->deviceFormat(), mOutOptions->dither());
+
+  if (mInOptions && mInOptions->zeroCopy()) {
+    // the callback captures straight into whole frames of pooled blocks that are handed on to JS
+    uint32_t frameBytes = mInOptions->frameBytes();
+    uint32_t blockBytes = std::max<uint32_t>(frameBytes, inBlockBytes() - inBlockBytes() % frameBytes);
+    mInPool = std::make_shared<MemoryPool>(mInOptions->poolSize(), blockBytes, mInOptions->batching() ? 64 : 0);
+    mInBlocks = std::make_shared<RingBuffer<std::shared_ptr<Chunk> > >(mInOptions->poolSize());
+  } else if (mInOptions) {
+    for (uint32_t p = 0; p < mInOptions->numPlanes(); ++p)
+      mInRings.push_back(std::make_shared<RingBuffer<uint8_t> >(mInOptions->ringFrames() * mInOptions->devicePlaneFrameBytes()));
+    mInTimes = std::make_shared<RingBuffer<TimeMark> >(1024);
+    mInPool = std::make_shared<MemoryPool>(mInOptions->poolSize(), inBlockBytes());
+  }
+  if ((mInOptions && mInOptions->timingStats()) || (mOutOptions && mOutOptions->timingStats())) {
+    mIntervalHist = std::make_shared<Histogram>();
+    mDurationHist = std::make_shared<Histogram>();
+    mAdcDeltaHist = std::make_shared<Histogram>();
+    mDacDeltaHist = std::make_shared<Histogram>();
+  }
+
+  if (mOutOptions && mOutOptions->mixerSources()) {
+    if (!mOutOptions->interleaved() || !mOutOptions->channelMap().empty() || mOutOptions->resampling())
+      throw Napi::Error::New(env, "mixerSources requires interleaved samples without a channelMap or targetSampleRate");
+    if (!SampleConverter::isValidFormat(mOutOptions->sampleFormat()) || !SampleConverter::isValidFormat(mOutOptions->deviceFormat()))
+      throw Napi::Error::New(env, "Invalid sampleFormat");
+    mMixer = std::make_shared<Mixer>(mOutOptions->mixerSources(), mOutOptions->channelCount(),
+                                     mOutOptions->sampleFormat(), mOutOptions->ringFrames());
+    mMixEncode = std::make_shared<SampleConverter>(1, mOutOptions->deviceFormat(), mOutOptions->dither());
+    mMixBuf.resize(sMixFrames * mOutOptions->channelCount());
+  }
+  if (mOutOptions && mOutOptions->scheduled()) {
+    if (!mOutOptions->channelMap().empty() || mOutOptions->mixerSources() || mOutOptions->resampling())
+      throw Napi::Error::New(env, "scheduled cannot be combined with a channelMap, mixerSources or targetSampleRate");
+    mOutMarks = std::make_shared<RingBuffer<TimeMark> >(1024);
+  }
   if (mOutOptions)
-    printf("Output %s\n", mOutOptions->toString().c_str());
+    mOutTimes = std::make_shared<RingBuffer<TimeMark> >(64);
+  for (uint32_t p = 0; mOutOptions && (p < mOutOptions->numPlanes()); ++p)
+    mOutRings.push_back(std::make_shared<RingBuffer<uint8_t> >(mOutOptions->ringFrames() * mOutOptions->devicePlaneFrameBytes()));
+
+  if (!mQuiet) {
+    printf("%s\n", Pa_GetVersionInfo()->versionText);
+    if (mInOptions)
+      printf("Input %s\n", mInOptions->toString().c_str());
+    if (mOutOptions)
+      printf("Output %s\n", mOutOptions->toString().c_str());
+  }
 
   double sampleRate;
   PaStreamParameters inParams;
   memset(&inParams, 0, sizeof(PaStreamParameters));
+  HostChannelMap inHostMap;
   if (mInOptions)
-    setParams(env, /*isInput*/true, mInOptions, inParams, sampleRate);
+    setParams(env, /*isInput*/true, mInOptions, inParams, inHostMap, sampleRate);
 
   PaStreamParameters outParams;
   memset(&outParams, 0, sizeof(PaStreamParameters));
+  HostChannelMap outHostMap;
   if (mOutOptions)
-    setParams(env, /*isInput*/false, mOutOptions, outParams, sampleRate);
+    setParams(env, /*isInput*/false, mOutOptions, outParams, outHostMap, sampleRate);
+
+  // a ring has to hold one period while the callback fills the next, or it never delivers whole reads
+  if (paFramesPerBufferUnspecified != mFramesPerBuffer) {
+    if (mInOptions && !mInOptions->zeroCopy() && (mInOptions->ringFrames() < 2 * mFramesPerBuffer))
+      throw Napi::Error::New(env, "Input ringFrames or bufferMs must hold at least two periods of framesPerBuffer");
+    if (mOutOptions && (mOutOptions->ringFrames() < 2 * mFramesPerBuffer))
+      throw Napi::Error::New(env, "Output ringFrames or bufferMs must hold at least two periods of framesPerBuffer");
+  }
+
+  if (!mInMap.empty())
+    mInGather.resize(sMapFrames * mInOptions->deviceFrameBytes());
+  if (!mOutMap.empty())
+    mOutScatter.resize(sMapFrames * mOutOptions->deviceFrameBytes());
+  if (mOutOptions && mOutOptions->passthrough())
+    makePassthrough(env);
+  if (mInOptions && !mInOptions->inserts().empty()) {
+    mInInserts = makeInserts(env, /*isInput*/true, mInOptions);
+    mInInsertStage.resize(InsertChain::blockFrames() * mInDeviceChannels * mInOptions->deviceSampleBits() / 8);
+  }
+  if (mOutOptions && !mOutOptions->inserts().empty())
+    mOutInserts = makeInserts(env, /*isInput*/false, mOutOptions);
 
   uint32_t framesPerBuffer = paFramesPerBufferUnspecified;
   #ifdef __arm__
   framesPerBuffer = 256;
   #endif
+  if (mInOptions && mInOptions->framesPerBuffer())
+    framesPerBuffer = mInOptions->framesPerBuffer();
+  else if (mOutOptions && mOutOptions->framesPerBuffer())
+    framesPerBuffer = mOutOptions->framesPerBuffer();
+  mFramesPerBuffer = framesPerBuffer;
+
+  mStreamFlags = (mInOptions ? mInOptions->streamFlags() : 0) | (mOutOptions ? mOutOptions->streamFlags() : 0);
+
+  // the host chooses the period when framesPerBuffer is unspecified, so assume a typical one
+  makeThreadPriorities(env, (paFramesPerBufferUnspecified == framesPerBuffer ? sNullDeviceFrames : framesPerBuffer) / sampleRate);
 
-  errCode = Pa_IsFormatSupported(mInOptions ? &inParams : NULL, mOutOptions ? &outParams : NULL, sampleRate);
+  if (nullDevice) {
+    // the simulated device takes the suggested latencies as they are
+    if (paFramesPerBufferUnspecified == framesPerBuffer)
+      mFramesPerBuffer = framesPerBuffer = sNullDeviceFrames;
+    NullDevice::Format inFormat = { 0, 0, true };
+    NullDevice::Format outFormat = { 0, 0, true };
+    if (mInOptions)
+      inFormat = { mInDeviceChannels, mInOptions->deviceSampleBits() / 8, mInOptions->interleaved() };
+    if (mOutOptions)
+      outFormat = { mOutDeviceChannels, mOutOptions->deviceSampleBits() / 8, mOutOptions->interleaved() };
+    mInLatency = mInOptions ? inParams.suggestedLatency : 0.0;
+    mOutLatency = mOutOptions ? outParams.suggestedLatency : 0.0;
+    mSampleRate = sampleRate;
+    mNullDevice = std::make_shared<NullDevice>(PaCallback, this, sampleRate, framesPerBuffer, inFormat, outFormat,
+                                               mInLatency, mOutLatency,
+                                               (mInOptions ? mInOptions : mOutOptions)->nullDeviceSpeed());
+    return;
+  }
+
+  PaError errCode = Pa_IsFormatSupported(mInOptions ? &inParams : NULL, mOutOptions ? &outParams : NULL, sampleRate);
   if (errCode != paFormatIsSupported) {
     std::string err = std::string("Format not supported: ") + Pa_GetErrorText(errCode);
     throw Napi::Error::New(env, err.c_str());
@@ -86,7 +271,7 @@ PaContext::PaContext(Napi::Env env, Napi::Object inOptions, Napi::Object outOpti
                           mInOptions ? &inParams : NULL,
                           mOutOptions ? &outParams : NULL,
                           sampleRate, framesPerBuffer,
-                          paNoFlag, PaCallback, this);
+                          (PaStreamFlags)mStreamFlags, PaCallback, this);
   if (errCode != paNoError) {
     std::string err = std::string("Could not open stream: ") + Pa_GetErrorText(errCode);
     throw Napi::Error::New(env, err.c_str());
@@ -94,15 +279,29 @@ PaContext::PaContext(Napi::Env env, Napi::Object inOptions, Napi::Object outOpti
 
   const PaStreamInfo *streamInfo = Pa_GetStreamInfo(mStream);
   mInLatency = streamInfo->inputLatency;
+  mOutLatency = streamInfo->outputLatency;
+  mSampleRate = streamInfo->sampleRate;
 }
 
 PaContext::~PaContext() {
-  Pa_AbortStream(mStream);
-  Pa_CloseStream(mStream);
-  Pa_Terminate();
+  if (mNullDevice)
+    mNullDevice->stop();
+  if (mStream) {
+    Pa_AbortStream(mStream);
+    Pa_CloseStream(mStream);
+  }
 }
 
 void PaContext::start(Napi::Env env) {
+  mLastDelivery = std::chrono::steady_clock::now();
+  if (mInShared)
+    SharedRing::setActive(mInShared, true);
+  if (mOutShared)
+    SharedRing::setActive(mOutShared, true);
+  if (mNullDevice) {
+    mNullDevice->start();
+    return;
+  }
   PaError errCode = Pa_StartStream(mStream);
   if (errCode != paNoError) {
     std::string err = std::string("Could not start stream: ") + Pa_GetErrorText(errCode);
@@ -111,165 +310,1044 @@ void PaContext::start(Napi::Env env) {
 }
 
 void PaContext::stop(eStopFlag flag) {
+  if (mInShared)
+    SharedRing::setActive(mInShared, false);
+  if (mOutShared)
+    SharedRing::setActive(mOutShared, false);
+  if (mNullDevice) {
+    mPrefilling = false;
+    std::unique_lock<std::mutex> lk(mRingMutex);
+    while ((eStopFlag::WAIT == flag) && hasOutput() && mOutRings.back()->readAvailable() && mNullDevice->isActive())
+      mOutCv.wait_for(lk, sRingWait);
+    lk.unlock();
+    mNullDevice->stop();
+    return;
+  }
+  if (!mStream)
+    return;
   if (eStopFlag::ABORT == flag)
     Pa_AbortStream(mStream);
-  else
+  else {
+    // let the callback play out whatever is left in the output ring
+    mPrefilling = false;
+    std::unique_lock<std::mutex> lk(mRingMutex);
+    while (hasOutput() && mOutRings.back()->readAvailable() && (1 == Pa_IsStreamActive(mStream)))
+      mOutCv.wait_for(lk, sRingWait);
+    lk.unlock();
     Pa_StopStream(mStream);
+  }
   Pa_CloseStream(mStream);
-  Pa_Terminate();
-}
-
-std::shared_ptr<Chunk> PaContext::pullInChunk(uint32_t numBytes, bool &finished) {
-  std::shared_ptr<Memory> result = Memory::makeNew(numBytes);
-  finished = false;
-  double timeStamp = 0.0;
-  uint32_t bytesRead = fillBuffer(result->buf(), numBytes, timeStamp, mInChunks, finished, /*isInput*/true);
-  if (bytesRead != numBytes) {
-    if (0 == bytesRead)
-      result = std::shared_ptr<Memory>();
-    else {
-      std::shared_ptr<Memory> trimResult = Memory::makeNew(bytesRead);
-      memcpy(trimResult->buf(), result->buf(), bytesRead);
-      result = trimResult;
-    }
+  mStream = nullptr;
+}
+
+bool PaContext::inputReady(uint32_t numBytes) const {
+  if (!mActive)
+    return true;
+  if (mInOptions->zeroCopy())
+    return mInBlocks->readAvailable() > 0;
+  uint32_t minBytes;
+  numBytes = inRingBytes(numBytes, minBytes);
+  uint32_t bytesAvailable = mInRings.back()->readAvailable();
+  if (inRingHolds(numBytes))
+    return true;
+  uint32_t intervalMs = mInOptions->maxDeliveryIntervalMs();
+  return intervalMs && (bytesAvailable >= minBytes) &&
+    (std::chrono::steady_clock::now() >= mLastDelivery + std::chrono::milliseconds(intervalMs));
+}
+
+bool PaContext::outputReady(uint32_t numBytes) const {
+  if (!mActive)
+    return true;
+  // a chunk bigger than the ring goes in once the ring has emptied
+  uint32_t bytesAvailable = outWriteAvailable();
+  return (bytesAvailable >= outPlaneBytes(numBytes)) || (bytesAvailable == mOutRings[0]->capacity());
+}
+
+std::shared_ptr<Chunk> PaContext::pullInChunk(uint32_t numBytes, bool &finished,
+                                              const std::atomic<bool> *keepWaiting) {
+  if (mInOptions->zeroCopy())
+    return pullInBlock(finished, keepWaiting);
+
+  uint32_t minBytes;
+  numBytes = inRingBytes(numBytes, minBytes);
+  uint32_t bytesRead = waitInRing(numBytes, minBytes, finished, keepWaiting);
+  if (0 == bytesRead)
+    return std::make_shared<Chunk>(std::shared_ptr<Memory>(), 0.0);
+
+  double ts;
+  uint32_t chunkBytes = inDeliveredBytes(bytesRead, ts);
+  if (0 == chunkBytes) {
+    // only possible once the stream has stopped with fewer frames left than the filter needs
+    finished = true;
+    return std::make_shared<Chunk>(std::shared_ptr<Memory>(), 0.0);
   }
 
-  return std::make_shared<Chunk>(result, timeStamp);
+  std::shared_ptr<Chunk> result = mInPool->alloc(chunkBytes, ts);
+  if (mInOptions->batching())
+    ringPeriods(mInRings[0]->readPos(), bytesRead, result);
+  readInRings(bytesRead, chunkBytes, result->buf());
+  mLastDelivery = std::chrono::steady_clock::now();
+  return result;
 }
 
-void PaContext::pushOutChunk(std::shared_ptr<Chunk> chunk) {
-  mOutChunks->push(chunk);
+uint8_t *PaContext::intoStage(uint32_t numBytes) {
+  if (mIntoStage.size() < numBytes)
+    mIntoStage.resize(numBytes);
+  return mIntoStage.data();
 }
 
-void PaContext::checkStatus(uint32_t statusFlags) {
-  if (statusFlags) {
-    std::string err = std::string("portAudio status - ");
-    if (statusFlags & paInputUnderflow)
-      err += "input underflow ";
-    if (statusFlags & paInputOverflow)
-      err += "input overflow ";
-    if (statusFlags & paOutputUnderflow)
-      err += "output underflow ";
-    if (statusFlags & paOutputOverflow)
-      err += "output overflow ";
-    if (statusFlags & paPrimingOutput)
-      err += "priming output ";
+uint32_t PaContext::pullInto(uint8_t *dst, uint32_t dstBytes, bool &finished, double &ts,
+                             const std::atomic<bool> *keepWaiting) {
+  uint32_t frameBytes = mInOptions->devicePlaneFrameBytes();
+  uint32_t minBytes;
+  uint32_t numBytes = inRingBytes(dstBytes, minBytes);
+  uint32_t bytesRead = waitInRing(numBytes, minBytes, finished, keepWaiting);
+
+  // never deliver more than the destination holds
+  if (!mInResamplers.empty()) {
+    while (bytesRead && (mInResamplers[0]->outputFramesFor(bytesRead / frameBytes) * mInOptions->frameBytes() > dstBytes))
+      bytesRead -= frameBytes;
+  } else if (mInConverter || (mInOptions->numPlanes() > 1))
+    bytesRead = std::min<uint32_t>(bytesRead, dstBytes / mInOptions->frameBytes() * frameBytes);
+  else
+    bytesRead = std::min<uint32_t>(bytesRead, dstBytes - dstBytes % frameBytes);
+  ts = 0.0;
+  if (0 == bytesRead)
+    return 0;
+
+  uint32_t chunkBytes = inDeliveredBytes(bytesRead, ts);
+  if (0 == chunkBytes) {
+    finished = true;
+    return 0;
+  }
+  readInRings(bytesRead, chunkBytes, dst);
+  mLastDelivery = std::chrono::steady_clock::now();
+  return chunkBytes;
+}
+
+uint32_t PaContext::sharedRingBytes(bool isInput) const {
+  std::shared_ptr<AudioOptions> options = isInput ? mInOptions : mOutOptions;
+  if (!options || !options->sharedRing())
+    return 0;
+  return SharedRing::bytesFor(options->ringFrames() * options->devicePlaneFrameBytes());
+}
+
+void PaContext::shareRing(bool isInput, uint8_t *mem) {
+  std::shared_ptr<AudioOptions> options = isInput ? mInOptions : mOutOptions;
+  std::shared_ptr<RingBuffer<uint8_t> > ring = SharedRing::make(mem,
+    options->ringFrames() * options->devicePlaneFrameBytes(), options->devicePlaneFrameBytes(),
+    options->channelCount(), options->sampleFormat(), options->sampleRate());
+  if (isInput) {
+    mInRings[0] = ring;
+    mInShared = mem;
+  } else {
+    mOutRings[0] = ring;
+    mOutShared = mem;
+  }
+}
+
+void PaContext::pushOutChunk(std::shared_ptr<Chunk> chunk, const std::atomic<bool> *keepWaiting) {
+  uint32_t numPlanes = mOutOptions->numPlanes();
+  const uint8_t *buf = chunk->buf();
+  uint32_t planeBytes = chunk->numBytes() / numPlanes;
+  // convert here rather than in the callback, any trailing partial sample or frame is dropped
+  if (!mOutResamplers.empty()) {
+    uint32_t inFrames = planeBytes / (mOutOptions->frameBytes() / numPlanes);
+    uint32_t stageBytes = mOutResamplers[0]->outputFramesFor(inFrames) * mOutOptions->devicePlaneFrameBytes();
+    if (mOutStage.size() < stageBytes * numPlanes)
+      mOutStage.resize(stageBytes * numPlanes);
+    for (uint32_t p = 0; p < numPlanes; ++p)
+      mOutResamplers[p]->process(buf + p * planeBytes, inFrames, mOutStage.data() + p * stageBytes);
+    buf = mOutStage.data();
+    planeBytes = stageBytes;
+  } else if (mOutConverter) {
+    uint32_t numSamples = planeBytes / mOutConverter->srcBytes();
+    uint32_t stageBytes = numSamples * mOutConverter->dstBytes();
+    if (mOutStage.size() < stageBytes * numPlanes)
+      mOutStage.resize(stageBytes * numPlanes);
+    for (uint32_t p = 0; p < numPlanes; ++p)
+      mOutConverter->convert(buf + p * planeBytes, mOutStage.data() + p * stageBytes, numSamples);
+    buf = mOutStage.data();
+    planeBytes = stageBytes;
+  }
+
+  // the mark goes in ahead of the samples so the callback never reads past it unseen
+  if (mOutMarks && (chunk->ts() > 0.0)) {
+    TimeMark mark = { mOutRings[0]->writePos(), chunk->ts() };
+    mOutMarks->write(&mark, 1);
+  }
+
+  uint32_t bytesDone = 0;
+  while (bytesDone < planeBytes) {
+    uint32_t bytesWritten = std::min<uint32_t>(planeBytes - bytesDone, outWriteAvailable());
+    for (uint32_t p = 0; p < numPlanes; ++p)
+      mOutRings[p]->write(buf + p * planeBytes + bytesDone, bytesWritten);
+    bytesDone += bytesWritten;
+
+    std::unique_lock<std::mutex> lk(mRingMutex);
+    while (mActive && (!keepWaiting || *keepWaiting) && (bytesDone < planeBytes) && !outWriteAvailable())
+      mOutCv.wait_for(lk, sRingWait);
+    if (!mActive || (keepWaiting && !*keepWaiting))
+      break;
+  }
+}
 
-    std::lock_guard<std::mutex> lk(m);
-    mErrStr = err;
+bool PaContext::tryPushOutChunk(std::shared_ptr<Chunk> chunk) {
+  // only a plain copy runs on the JS thread, and never ahead of a write already queued
+  if (writePending() || mOutConverter || !mOutResamplers.empty())
+    return false;
+  if (outPlaneBytes(chunk->numBytes()) > outWriteAvailable())
+    return false;
+  pushOutChunk(chunk);
+  return true;
+}
+
+void PaContext::checkStatus(uint32_t statusFlags) {
+  ++mStats.callbacks;
+  if (!statusFlags)
+    return;
+  if (statusFlags & paInputUnderflow) {
+    ++mStats.inputUnderflows;
+    logEvent(EventLog::eEvent::INPUT_UNDERFLOW);
+  }
+  if (statusFlags & paInputOverflow) {
+    ++mStats.inputOverflows;
+    logEvent(EventLog::eEvent::INPUT_OVERFLOW);
   }
+  if (statusFlags & paOutputUnderflow) {
+    ++mStats.outputUnderflows;
+    logEvent(EventLog::eEvent::OUTPUT_UNDERFLOW);
+  }
+  if (statusFlags & paOutputOverflow) {
+    ++mStats.outputOverflows;
+    logEvent(EventLog::eEvent::OUTPUT_OVERFLOW);
+  }
+  if (statusFlags & paPrimingOutput) {
+    ++mStats.primingOutputs;
+    logEvent(EventLog::eEvent::PRIMING_OUTPUT);
+  }
+  // the message is only built when it is collected, off the real-time thread
+  mStatusFlags |= statusFlags;
 }
 
 bool PaContext::getErrStr(std::string& errStr, bool isInput) {
-  std::lock_guard<std::mutex> lk(m);
+  uint32_t statusFlags = mStatusFlags.exchange(0);
+  if (!statusFlags)
+    return false;
+
+  std::string err = std::string("portAudio status - ");
+  if (statusFlags & paInputUnderflow)
+    err += "input underflow ";
+  if (statusFlags & paInputOverflow)
+    err += "input overflow ";
+  if (statusFlags & paOutputUnderflow)
+    err += "output underflow ";
+  if (statusFlags & paOutputOverflow)
+    err += "output overflow ";
+  if (statusFlags & paPrimingOutput)
+    err += "priming output ";
+
   std::shared_ptr<streampunk::AudioOptions> options = isInput ? mInOptions : mOutOptions;
   if (options->closeOnError()) // propagate the error back to the stream handler
-    errStr = mErrStr;
-  else if (mErrStr.length())
-    printf("AudioIO: %s\n", mErrStr.c_str());
-  mErrStr.clear();
+    errStr = err;
+  else if (!mQuiet)
+    printf("AudioIO: %s\n", err.c_str());
   return !errStr.empty();
 }
 
 void PaContext::quit() {
-  if (mInOptions)
-    mInChunks->quit();
-  if (mOutOptions)
-    mOutChunks->quit();
+  std::lock_guard<std::mutex> lk(mRingMutex);
+  mActive = false;
+  mInCv.notify_all();
+  mOutCv.notify_all();
+  if (mMixer)
+    mMixer->quit();
 }
 
 bool PaContext::readPaBuffer(const void *srcBuf, uint32_t frameCount, double inTimestamp) {
-  uint32_t bytesAvailable = frameCount * mInOptions->channelCount() * mInOptions->sampleBits() / 8;
-  std::shared_ptr<Memory> chunk = Memory::makeNew(bytesAvailable);
-  memcpy(chunk->buf(), srcBuf, bytesAvailable);
-  mInChunks->push(std::make_shared<Chunk>(chunk, inTimestamp));
+  if (mInOptions->zeroCopy())
+    return readPaBlocks((const uint8_t *)srcBuf, frameCount, inTimestamp);
+
+  // non-interleaved buffers arrive as an array of pointers, one per channel
+  uint32_t numPlanes = mInOptions->numPlanes();
+  const uint8_t *const *planes = mInOptions->interleaved() ? (const uint8_t *const *)&srcBuf : (const uint8_t *const *)srcBuf;
+  uint32_t bytesAvailable = frameCount * mInOptions->devicePlaneFrameBytes();
+  mInPeriodBytes.store(bytesAvailable, std::memory_order_relaxed);
+  if (mInRings[0]->writeAvailable() < bytesAvailable) {
+    // never wait on the real-time thread - drop the whole period and count it
+    ++mStats.inOverruns;
+    logEvent(EventLog::eEvent::INPUT_OVERRUN);
+    return true;
+  }
+
+  TimeMark mark = { mInRings[0]->writePos(), inTimestamp };
+  mInTimes->write(&mark, 1);
+  if (mInInserts) {
+    // inserts process a copy of the callback buffer a block of frames at a time
+    uint32_t frameBytes = mInDeviceChannels * mInOptions->deviceSampleBits() / 8;
+    for (uint32_t f = 0; f < frameCount; f += InsertChain::blockFrames()) {
+      uint32_t numFrames = std::min<uint32_t>(InsertChain::blockFrames(), frameCount - f);
+      mInInserts->process(planes[0] + f * frameBytes, mInInsertStage.data(), numFrames);
+      writeInFrames(mInInsertStage.data(), numFrames);
+    }
+  } else if (!mInOptions->interleaved()) {
+    for (uint32_t p = 0; p < numPlanes; ++p)
+      mInRings[p]->write(planes[mInMap.empty() ? p : mInMap[p]], bytesAvailable);
+  } else
+    writeInFrames(planes[0], frameCount);
+  mStats.inFrames += frameCount;
+  uint32_t queuedFrames = mInRings[0]->readAvailable() / mInOptions->devicePlaneFrameBytes();
+  if (queuedFrames > mStats.inQueueHighWater.load(std::memory_order_relaxed))
+    mStats.inQueueHighWater.store(queuedFrames, std::memory_order_relaxed);
+  mInCv.notify_one();
+  return true;
+}
+
+void PaContext::applyOutInserts(void *dstBuf, uint32_t frameCount) {
+  mOutInserts->process((const uint8_t *)dstBuf, (uint8_t *)dstBuf, frameCount);
+}
+
+bool PaContext::fillPaBuffer(void *dstBuf, uint32_t frameCount, double outTimestamp) {
+  // device frames played against the time they reach the DAC, skipped while the reader is behind
+  TimeMark mark = { mOutFrames, outTimestamp };
+  mOutTimes->write(&mark, 1);
+  mOutFrames += frameCount;
+
+  if (mMixer)
+    return fillPaMixed(dstBuf, frameCount);
+
+  uint32_t queuedFrames = mOutRings.back()->readAvailable() / mOutOptions->devicePlaneFrameBytes();
+  if (mPrefilling) {
+    // a stop lifts the prefill so whatever has been queued still plays out
+    if (mActive && (queuedFrames < mPrefillFrames)) {
+      silencePaBuffer(dstBuf, frameCount);
+      return true;
+    }
+    mPrefilling = false;
+  }
+  if (mLowWaterFrames)
+    checkLowWater(queuedFrames, frameCount);
+  if (mOutMarks)
+    return fillPaScheduled(dstBuf, frameCount, outTimestamp);
+
+  if (queuedFrames > mStats.outQueueHighWater.load(std::memory_order_relaxed))
+    mStats.outQueueHighWater.store(queuedFrames, std::memory_order_relaxed);
+  mStats.outFrames += std::min(queuedFrames, frameCount);
+  if (!mOutMap.empty())
+    return fillPaMapped(dstBuf, frameCount);
+
+  uint32_t numPlanes = mOutOptions->numPlanes();
+  uint8_t *const *planes = mOutOptions->interleaved() ? (uint8_t *const *)&dstBuf : (uint8_t *const *)dstBuf;
+  uint32_t numBytes = frameCount * mOutOptions->devicePlaneFrameBytes();
+  // pushOutChunk writes the planes in order, so the last ring has the least available
+  uint32_t bytesRead = std::min<uint32_t>(numBytes, mOutRings.back()->readAvailable());
+  for (uint32_t p = 0; p < numPlanes; ++p) {
+    mOutRings[p]->read(planes[p], bytesRead);
+    memset(planes[p] + bytesRead, 0, numBytes - bytesRead);
+  }
+  if (bytesRead)
+    mOutCv.notify_one();
+  if (bytesRead < numBytes) {
+    if (!mActive)
+      return false;
+    if (mPassMap.empty() || bytesRead) {
+      ++mStats.outUnderruns;
+      logEvent(EventLog::eEvent::OUTPUT_UNDERRUN);
+    }
+  }
+  return true;
+}
+
+bool PaContext::readOutTime(TimeMark &mark) {
+  bool found = false;
+  while (mOutTimes->read(&mark, 1))
+    found = true;
+  return found;
+}
+
+uint32_t PaContext::outQueuedFrames() const {
+  return mOutRings.back()->readAvailable() / mOutOptions->devicePlaneFrameBytes();
+}
+
+void PaContext::outputFinished() {
+  if (!mOutFinished)
+    logEvent(EventLog::eEvent::OUTPUT_FINISHED);
+  mOutFinished = true;
+}
+
+void PaContext::recordTiming(std::chrono::steady_clock::time_point start, double adcTime, double dacTime) {
+  std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+  mDurationHist->record(std::chrono::duration<double, std::micro>(end - start).count());
+  // the first callback after a start has nothing to measure against
+  if (mLastCallback.time_since_epoch().count())
+    mIntervalHist->record(std::chrono::duration<double, std::micro>(start - mLastCallback).count());
+  if ((adcTime > 0.0) && (mLastAdcTime > 0.0))
+    mAdcDeltaHist->record((adcTime - mLastAdcTime) * 1e6);
+  if ((dacTime > 0.0) && (mLastDacTime > 0.0))
+    mDacDeltaHist->record((dacTime - mLastDacTime) * 1e6);
+  mLastCallback = start;
+  mLastAdcTime = adcTime;
+  mLastDacTime = dacTime;
+}
+
+double PaContext::getCpuLoad() const {
+  if (mNullDevice)
+    return mNullDevice->cpuLoad();
+  return mStream ? Pa_GetStreamCpuLoad(mStream) : 0.0;
+}
+
+void PaContext::initCallbackThread() {
+  mCallbackThread->apply(mCallbackReport);
+  mCallbackThreadSet = true;
+}
+
+void PaContext::initWorkerThread(const std::string &name) {
+  if (!mWorkerThread)
+    return;
+  ThreadPriority::Report report;
+  mWorkerThread->apply(report);
+  std::lock_guard<std::mutex> lk(mThreadMutex);
+  for (auto &worker : mWorkerReports)
+    if (0 == worker.first.compare(name)) {
+      worker.second = report;
+      return;
+    }
+  mWorkerReports.push_back(std::make_pair(name, report));
+}
+
+bool PaContext::getCallbackThread(ThreadPriority::Report &report) const {
+  if (!mCallbackThreadSet)
+    return false;
+  report = mCallbackReport;
   return true;
 }
 
-bool PaContext::fillPaBuffer(void *dstBuf, uint32_t frameCount) {
-  uint32_t bytesRemaining = frameCount * mOutOptions->channelCount() * mOutOptions->sampleBits() / 8;
-  bool finished = false;
-  double timeStamp = 0.0;
-  fillBuffer((uint8_t *)dstBuf, bytesRemaining, timeStamp, mOutChunks, finished, /*isInput*/false);
-  return !finished;
+std::vector<std::pair<std::string, ThreadPriority::Report> > PaContext::getWorkerThreads() const {
+  std::lock_guard<std::mutex> lk(mThreadMutex);
+  return mWorkerReports;
 }
 
 double PaContext::getCurTime() const  { 
-  return Pa_GetStreamTime(mStream);
+  if (mNullDevice)
+    return mNullDevice->time();
+  return mStream ? Pa_GetStreamTime(mStream) : 0.0;
+}
+
+void PaContext::passthrough(const void *srcBuf, void *dstBuf, uint32_t frameCount) {
+  uint32_t inChannels = mPassInChannels;
+  uint32_t outChannels = (uint32_t)mPassMap.size();
+  bool inInterleaved = mInOptions->interleaved();
+  bool outInterleaved = mOutOptions->interleaved();
+  uint32_t inBytes = mPassInDecode->srcBytes();
+  uint32_t outBytes = mPassOutEncode->dstBytes();
+  const uint8_t *const *inPlanes = inInterleaved ? (const uint8_t *const *)&srcBuf : (const uint8_t *const *)srcBuf;
+  uint8_t *const *outPlanes = outInterleaved ? (uint8_t *const *)&dstBuf : (uint8_t *const *)dstBuf;
+  // scratch samples are laid out like the callback buffers, interleaved or a plane per channel
+  uint32_t inStride = inInterleaved ? inChannels : 1;
+  uint32_t inChannelStep = inInterleaved ? 1 : sPassFrames;
+  uint32_t outStride = outInterleaved ? outChannels : 1;
+  uint32_t outChannelStep = outInterleaved ? 1 : sPassFrames;
+  float *in = mPassIn.data();
+  float *out = mPassOut.data();
+
+  for (uint32_t f = 0; f < frameCount; f += sPassFrames) {
+    uint32_t numFrames = std::min<uint32_t>(sPassFrames, frameCount - f);
+    if (inInterleaved)
+      mPassInDecode->convert(inPlanes[0] + f * inChannels * inBytes, (uint8_t *)in, numFrames * inChannels);
+    else
+      for (uint32_t c = 0; c < inChannels; ++c)
+        mPassInDecode->convert(inPlanes[c] + f * inBytes, (uint8_t *)(in + c * sPassFrames), numFrames);
+    if (outInterleaved)
+      mPassOutDecode->convert(outPlanes[0] + f * outChannels * outBytes, (uint8_t *)out, numFrames * outChannels);
+    else
+      for (uint32_t c = 0; c < outChannels; ++c)
+        mPassOutDecode->convert(outPlanes[c] + f * outBytes, (uint8_t *)(out + c * sPassFrames), numFrames);
+
+    // sum onto whatever JS wrote, saturating at full scale
+    for (uint32_t c = 0; c < outChannels; ++c) {
+      if (mPassMap[c] < 0)
+        continue;
+      const float *src = in + mPassMap[c] * inChannelStep;
+      float *dst = out + c * outChannelStep;
+      for (uint32_t i = 0; i < numFrames; ++i) {
+        float sum = dst[i * outStride] + mPassGain * src[i * inStride];
+        dst[i * outStride] = std::min(1.0f, std::max(-1.0f, sum));
+      }
+    }
+
+    if (outInterleaved)
+      mPassOutEncode->convert((const uint8_t *)out, outPlanes[0] + f * outChannels * outBytes, numFrames * outChannels);
+    else
+      for (uint32_t c = 0; c < outChannels; ++c)
+        mPassOutEncode->convert((const uint8_t *)(out + c * sPassFrames), outPlanes[c] + f * outBytes, numFrames);
+  }
 }
 
 // private
-uint32_t PaContext::fillBuffer(uint8_t *buf, uint32_t numBytes, double &timeStamp,
-                               std::shared_ptr<Chunks> chunks,
-                               bool &finished, bool isInput) {
-  uint32_t bufOff = 0;
-  timeStamp = 0.0;
-  while (numBytes) {
-    if (!chunks->curBuf() || (chunks->curBuf() && (chunks->curBytes() == chunks->curOffset()))) {
-      chunks->waitNext();
-      if (!chunks->curBuf()) {
-        printf("Finishing %s - %d bytes not available to fill the last buffer\n", isInput ? "input" : "output", numBytes);
-        memset(buf + bufOff, 0, numBytes);
-        finished = true;
+void PaContext::makeResamplers(Napi::Env env, bool isInput, std::shared_ptr<AudioOptions> options,
+                               std::vector<std::shared_ptr<ResampleStage> > &resamplers) {
+  Resampler::eQuality quality;
+  if (!Resampler::parseQuality(options->resampleQuality(), quality))
+    throw Napi::Error::New(env, "Invalid resampleQuality - expects \'low\', \'medium\' or \'high\'");
+  if (!SampleConverter::isValidFormat(options->sampleFormat()) || !SampleConverter::isValidFormat(options->deviceFormat()))
+    throw Napi::Error::New(env, "Invalid sampleFormat");
+  if (0 == options->targetSampleRate())
+    throw Napi::Error::New(env, "Invalid targetSampleRate");
+
+  uint32_t channels = options->channelCount() / options->numPlanes();
+  double deviceRate = options->sampleRate();
+  double targetRate = options->targetSampleRate();
+  for (uint32_t p = 0; p < options->numPlanes(); ++p) {
+    if (isInput)
+      resamplers.push_back(std::make_shared<ResampleStage>(channels, options->deviceFormat(), options->sampleFormat(),
+                                                           deviceRate, targetRate, quality, options->dither()));
+    else
+      resamplers.push_back(std::make_shared<ResampleStage>(channels, options->sampleFormat(), options->deviceFormat(),
+                                                           targetRate, deviceRate, quality, options->dither()));
+  }
+}
+
+void PaContext::makeThreadPriorities(Napi::Env env, double periodSecs) {
+  // a duplex stream takes its thread settings from inOptions
+  std::shared_ptr<AudioOptions> options = mInOptions ? mInOptions : mOutOptions;
+  ThreadPriority::ePriority callbackPriority;
+  if (!ThreadPriority::parsePriority(options->callbackPriority(), callbackPriority))
+    throw Napi::Error::New(env, "Invalid callbackPriority - expects \'default\', \'high\' or \'realtime\'");
+  ThreadPriority::ePriority workerPriority;
+  if (!ThreadPriority::parsePriority(options->workerPriority(), workerPriority))
+    throw Napi::Error::New(env, "Invalid workerPriority - expects \'default\', \'high\' or \'realtime\'");
+
+  // workers wait on the callback, so they stay below it to never hold it off
+  int32_t level = (int32_t)options->realtimePriority();
+  std::shared_ptr<ThreadPriority> callbackThread =
+    std::make_shared<ThreadPriority>(callbackPriority, level, options->callbackCpus(), periodSecs);
+  std::shared_ptr<ThreadPriority> workerThread =
+    std::make_shared<ThreadPriority>(workerPriority, std::max(1, level - 5), options->workerCpus(), periodSecs);
+  if (!callbackThread->isDefault())
+    mCallbackThread = callbackThread;
+  if (!workerThread->isDefault())
+    mWorkerThread = workerThread;
+}
+
+std::shared_ptr<InsertChain> PaContext::makeInserts(Napi::Env env, bool isInput, std::shared_ptr<AudioOptions> options) {
+  std::string err;
+  if (!InsertChain::validate(options->inserts(), err))
+    throw Napi::Error::New(env, err);
+  if (!options->interleaved())
+    throw Napi::Error::New(env, "inserts require interleaved samples");
+  if (!SampleConverter::isValidFormat(options->deviceFormat()))
+    throw Napi::Error::New(env, "Invalid deviceFormat");
+  return std::make_shared<InsertChain>(isInput ? mInDeviceChannels : mOutDeviceChannels, options->deviceFormat(),
+                                       options->sampleRate(), options->dither(), options->inserts());
+}
+
+void PaContext::makePassthrough(Napi::Env env) {
+  if (!mInOptions)
+    throw Napi::Error::New(env, "passthrough requires a duplex stream with both inOptions and outOptions");
+  if (mInOptions->zeroCopy())
+    throw Napi::Error::New(env, "passthrough cannot be combined with zeroCopy");
+  if (!SampleConverter::isValidFormat(mInOptions->deviceFormat()) || !SampleConverter::isValidFormat(mOutOptions->deviceFormat()))
+    throw Napi::Error::New(env, "Invalid deviceFormat");
+
+  // the map is given in stream channels, combine it with any channelMap to work on the callback buffers
+  std::vector<int32_t> streamMap = mOutOptions->passthroughMap();
+  if (streamMap.empty()) {
+    for (uint32_t c = 0; c < mOutOptions->channelCount(); ++c)
+      streamMap.push_back(c < mInOptions->channelCount() ? (int32_t)c : -1);
+  } else if (streamMap.size() != mOutOptions->channelCount())
+    throw Napi::Error::New(env, "passthroughMap must have an entry for each output channel");
+  for (auto c : streamMap)
+    if ((c < -1) || (c >= (int32_t)mInOptions->channelCount()))
+      throw Napi::Error::New(env, "passthroughMap entries must be input channels or -1");
+
+  for (uint32_t d = 0; d < mOutDeviceChannels; ++d) {
+    int32_t outChannel = mOutMap.empty() ? (int32_t)d : mOutMap[d];
+    int32_t inChannel = outChannel < 0 ? -1 : streamMap[outChannel];
+    mPassMap.push_back((inChannel < 0) || mInMap.empty() ? inChannel : mInMap[inChannel]);
+  }
+  mPassInChannels = mInDeviceChannels;
+  mPassGain = (float)mOutOptions->passthroughGain();
+
+  mPassInDecode = std::make_shared<SampleConverter>(mInOptions->deviceFormat(), 1, false);
+  mPassOutDecode = std::make_shared<SampleConverter>(mOutOptions->deviceFormat(), 1, false);
+  mPassOutEncode = std::make_shared<SampleConverter>(1, mOutOptions->deviceFormat(), mOutOptions->dither());
+  mPassIn.resize(sPassFrames * mPassInChannels);
+  mPassOut.resize(sPassFrames * mOutDeviceChannels);
+}
+
+bool PaContext::fillPaMapped(void *dstBuf, uint32_t frameCount) {
+  uint32_t numPlanes = mOutOptions->numPlanes();
+  uint32_t sampleBytes = mOutOptions->deviceSampleBits() / 8;
+  uint32_t frameBytes = mOutOptions->devicePlaneFrameBytes();
+  // only whole frames are mapped, as each frame is spread across the device channels
+  uint32_t framesRead = std::min<uint32_t>(frameCount, mOutRings.back()->readAvailable() / frameBytes);
+
+  if (!mOutOptions->interleaved()) {
+    // read each stream plane into the first device channel it plays on, then copy it to the others
+    uint8_t *const *planes = (uint8_t *const *)dstBuf;
+    uint32_t planeBytes = frameCount * sampleBytes;
+    uint32_t bytesRead = framesRead * sampleBytes;
+    for (uint32_t d = 0; d < mOutDeviceChannels; ++d)
+      memset(planes[d], 0, planeBytes);
+    for (uint32_t p = 0; p < numPlanes; ++p) {
+      int32_t first = -1;
+      for (uint32_t d = 0; d < mOutDeviceChannels; ++d) {
+        if (mOutMap[d] != (int32_t)p)
+          continue;
+        if (first < 0) {
+          mOutRings[p]->read(planes[d], bytesRead);
+          first = (int32_t)d;
+        } else
+          memcpy(planes[d], planes[first], bytesRead);
+      }
+      if (first < 0)
+        mOutRings[p]->skip(bytesRead);
+    }
+  } else {
+    uint8_t *dst = (uint8_t *)dstBuf;
+    for (uint32_t f = 0; f < framesRead; f += sMapFrames) {
+      uint32_t numFrames = std::min<uint32_t>(sMapFrames, framesRead - f);
+      mOutRings[0]->read(mOutScatter.data(), numFrames * frameBytes);
+      scatterChannels(sampleBytes, mOutScatter.data(), mOutOptions->channelCount(), dst, mOutMap, numFrames);
+      dst += numFrames * mOutDeviceChannels * sampleBytes;
+    }
+    memset(dst, 0, (frameCount - framesRead) * mOutDeviceChannels * sampleBytes);
+  }
+
+  if (framesRead)
+    mOutCv.notify_one();
+  if (framesRead < frameCount) {
+    if (!mActive)
+      return false;
+    // with passthrough JS need not write at all, only count running out part way through
+    if (mPassMap.empty() || framesRead) {
+      ++mStats.outUnderruns;
+      logEvent(EventLog::eEvent::OUTPUT_UNDERRUN);
+    }
+  }
+  return true;
+}
+
+bool PaContext::fillPaMixed(void *dstBuf, uint32_t frameCount) {
+  uint32_t channels = mOutOptions->channelCount();
+  uint32_t frameBytes = mOutOptions->deviceFrameBytes();
+  uint8_t *dst = (uint8_t *)dstBuf;
+  uint32_t framesMixed = 0;
+  for (uint32_t f = 0; f < frameCount; f += sMixFrames) {
+    uint32_t numFrames = std::min<uint32_t>(sMixFrames, frameCount - f);
+    framesMixed += mMixer->mix(mMixBuf.data(), numFrames);
+    mMixEncode->convert((const uint8_t *)mMixBuf.data(), dst + f * frameBytes, numFrames * channels);
+  }
+  mStats.outFrames += framesMixed;
+  // each source counts its own underruns, the stream only finishes once they have all run dry
+  return mActive || framesMixed;
+}
+
+void PaContext::logEvent(EventLog::eEvent type, uint32_t value) {
+  mEventLog->push(type, getCurTime(), value);
+}
+
+bool PaContext::fillPaScheduled(void *dstBuf, uint32_t frameCount, double outTimestamp) {
+  uint32_t numPlanes = mOutOptions->numPlanes();
+  uint8_t *const *planes = mOutOptions->interleaved() ? (uint8_t *const *)&dstBuf : (uint8_t *const *)dstBuf;
+  uint32_t frameBytes = mOutOptions->devicePlaneFrameBytes();
+  double sampleRate = mOutOptions->sampleRate();
+  int64_t toleranceFrames = (int64_t)(mOutOptions->scheduleToleranceMs() * sampleRate / 1000.0);
+
+  uint32_t queuedFrames = mOutRings.back()->readAvailable() / frameBytes;
+  if (queuedFrames > mStats.outQueueHighWater.load(std::memory_order_relaxed))
+    mStats.outQueueHighWater.store(queuedFrames, std::memory_order_relaxed);
+
+  uint32_t framesDone = 0;
+  uint32_t framesPlayed = 0;
+  bool waiting = false;
+  while (framesDone < frameCount) {
+    uint32_t framesAvailable = mOutRings.back()->readAvailable() / frameBytes;
+    TimeMark mark;
+    bool haveMark = mOutMarks->peek(mark);
+    uint32_t framesToMark = haveMark ? (mark.pos - mOutRings[0]->readPos()) / frameBytes : frameCount;
+
+    if (mDropFrames) {
+      // finish dropping a late chunk as it arrives, but never into the next scheduled one
+      uint32_t numFrames = std::min(std::min(mDropFrames, framesAvailable), framesToMark);
+      for (uint32_t p = 0; p < numPlanes; ++p)
+        mOutRings[p]->skip(numFrames * frameBytes);
+      mDropFrames = (haveMark && (numFrames == framesToMark)) ? 0 : mDropFrames - numFrames;
+      if (mDropFrames && !numFrames)
+        break;
+      continue;
+    }
+
+    if (haveMark && (0 == framesToMark)) {
+      // the next frame starts a scheduled chunk, compare when it is due with when it would play
+      double playTime = outTimestamp + framesDone / sampleRate;
+      int64_t offset = (int64_t)std::llround((mark.ts - playTime) * sampleRate);
+      if (offset > toleranceFrames) {
+        // early - hold it back with silence, for the rest of this buffer if need be
+        uint32_t numFrames = (uint32_t)std::min<int64_t>(offset, frameCount - framesDone);
+        for (uint32_t p = 0; p < numPlanes; ++p)
+          memset(planes[p] + framesDone * frameBytes, 0, numFrames * frameBytes);
+        framesDone += numFrames;
+        waiting = true;
+        if ((int64_t)numFrames < offset)
+          break;
+      } else if (offset < -toleranceFrames) {
+        // late - drop what should already have played
+        mDropFrames = (uint32_t)std::min<int64_t>(-offset, mOutRings[0]->capacity() / frameBytes);
+      }
+      mOutMarks->skip(1);
+      continue;
+    }
+
+    uint32_t numFrames = std::min(std::min(frameCount - framesDone, framesAvailable), framesToMark);
+    if (!numFrames)
+      break;
+    for (uint32_t p = 0; p < numPlanes; ++p)
+      mOutRings[p]->read(planes[p] + framesDone * frameBytes, numFrames * frameBytes);
+    framesDone += numFrames;
+    framesPlayed += numFrames;
+  }
+  for (uint32_t p = 0; p < numPlanes; ++p)
+    memset(planes[p] + framesDone * frameBytes, 0, (frameCount - framesDone) * frameBytes);
+  mStats.outFrames += framesPlayed;
+
+  if (framesPlayed)
+    mOutCv.notify_one();
+  if ((framesDone < frameCount) && !waiting) {
+    if (!mActive && !framesPlayed)
+      return false;
+    if (mPassMap.empty() || framesPlayed) {
+      ++mStats.outUnderruns;
+      logEvent(EventLog::eEvent::OUTPUT_UNDERRUN);
+    }
+  }
+  return true;
+}
+
+uint32_t PaContext::outWriteAvailable() const {
+  uint32_t bytesAvailable = mOutRings[0]->writeAvailable();
+  for (uint32_t p = 1; p < mOutRings.size(); ++p)
+    bytesAvailable = std::min<uint32_t>(bytesAvailable, mOutRings[p]->writeAvailable());
+  return bytesAvailable;
+}
+
+uint32_t PaContext::inRingBytes(uint32_t numBytes, uint32_t &minBytes) const {
+  // the rings hold samples in the device format, numBytes is in the delivered format
+  uint32_t numPlanes = mInOptions->numPlanes();
+  uint32_t frameBytes = mInOptions->devicePlaneFrameBytes();
+  minBytes = frameBytes;
+  if (!mInResamplers.empty()) {
+    // enough device frames to produce the requested number of frames at the target rate
+    uint32_t outFrames = mInOptions->batchFrames() ? mInOptions->batchFrames() : std::max<uint32_t>(1, numBytes / mInOptions->frameBytes());
+    numBytes = std::max<uint32_t>(1, mInResamplers[0]->inputFramesFor(outFrames)) * frameBytes;
+    minBytes = std::max<uint32_t>(1, mInResamplers[0]->inputFramesFor(1)) * frameBytes;
+  } else if (mInOptions->batchFrames())
+    numBytes = mInOptions->batchFrames() * frameBytes;
+  else if (mInConverter || (numPlanes > 1))
+    numBytes = std::max<uint32_t>(1, numBytes / mInOptions->frameBytes()) * frameBytes;
+  // the ring is only ever filled a whole period at a time, so it may never reach its capacity
+  uint32_t ringBytes = mInOptions->ringFrames() * frameBytes;
+  if ((paFramesPerBufferUnspecified != mFramesPerBuffer) && (ringBytes > mFramesPerBuffer * frameBytes))
+    ringBytes -= mFramesPerBuffer * frameBytes;
+  ringBytes = std::min<uint32_t>(ringBytes, mInRings[0]->capacity());
+  return std::max<uint32_t>(frameBytes, std::min<uint32_t>(numBytes, ringBytes - ringBytes % frameBytes));
+}
+
+bool PaContext::inRingHolds(uint32_t numBytes) const {
+  // a ring too full to take the next period has all it is going to get until it is read
+  uint32_t bytesAvailable = mInRings.back()->readAvailable();
+  return (bytesAvailable >= numBytes) || (bytesAvailable + mInPeriodBytes > mInRings[0]->capacity());
+}
+
+uint32_t PaContext::waitInRing(uint32_t numBytes, uint32_t minBytes, bool &finished,
+                              const std::atomic<bool> *keepWaiting) {
+  const std::shared_ptr<RingBuffer<uint8_t> > &ring = mInRings[0];
+  uint32_t frameBytes = mInOptions->devicePlaneFrameBytes();
+
+  // with a maximum delivery interval, hand over whatever whole frames have arrived once it expires
+  uint32_t intervalMs = mInOptions->maxDeliveryIntervalMs();
+  std::chrono::steady_clock::time_point deadline = mLastDelivery + std::chrono::milliseconds(intervalMs);
+  std::unique_lock<std::mutex> lk(mRingMutex);
+  while (mActive && (!keepWaiting || *keepWaiting) && !inRingHolds(numBytes)) {
+    std::chrono::steady_clock::duration wait = sRingWait;
+    if (intervalMs) {
+      std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+      if ((now >= deadline) && (ring->readAvailable() >= minBytes))
+        break;
+      if ((now < deadline) && (deadline - now < wait))
+        wait = deadline - now;
+    }
+    mInCv.wait_for(lk, wait);
+  }
+  lk.unlock();
+
+  // the callback writes ring 0 first, so the last ring has the least available
+  uint32_t bytesRead = std::min<uint32_t>(numBytes, mInRings.back()->readAvailable());
+  finished = !mActive && (bytesRead < numBytes);
+  if (bytesRead < numBytes)
+    bytesRead -= bytesRead % frameBytes;
+  return bytesRead;
+}
+
+uint32_t PaContext::inDeliveredBytes(uint32_t bytesRead, double &ts) {
+  // whole frames unless the ring is passed straight through
+  uint32_t inFrames = bytesRead / mInOptions->devicePlaneFrameBytes();
+  uint32_t chunkBytes = bytesRead;
+  ts = ringTimestamp(mInRings[0]->readPos());
+  if (!mInResamplers.empty()) {
+    chunkBytes = mInResamplers[0]->outputFramesFor(inFrames) * mInOptions->frameBytes();
+    ts += mInResamplers[0]->outputOffset() / mInOptions->sampleRate();
+  } else if (mInConverter || (mInOptions->numPlanes() > 1))
+    chunkBytes = inFrames * mInOptions->frameBytes();
+  return chunkBytes;
+}
+
+void PaContext::readInRings(uint32_t bytesRead, uint32_t chunkBytes, uint8_t *buf) {
+  uint32_t numPlanes = mInOptions->numPlanes();
+  uint32_t inFrames = bytesRead / mInOptions->devicePlaneFrameBytes();
+  uint32_t planeBytes = chunkBytes / numPlanes;
+  // planes are laid out one after another, so each ring is read in a single pass
+  for (uint32_t p = 0; p < numPlanes; ++p) {
+    uint8_t *dst = buf + p * planeBytes;
+    if (!mInResamplers.empty() || mInConverter) {
+      if (mInStage.size() < bytesRead)
+        mInStage.resize(bytesRead);
+      mInRings[p]->read(mInStage.data(), bytesRead);
+      if (!mInResamplers.empty())
+        mInResamplers[p]->process(mInStage.data(), inFrames, dst);
+      else
+        mInConverter->convert(mInStage.data(), dst, bytesRead / mInConverter->srcBytes());
+    } else
+      mInRings[p]->read(dst, bytesRead);
+  }
+}
+
+uint32_t PaContext::outPlaneBytes(uint32_t numBytes) const {
+  // the bytes each output ring takes for numBytes in the written format
+  uint32_t numPlanes = mOutOptions->numPlanes();
+  uint32_t planeBytes = numBytes / numPlanes;
+  if (!mOutResamplers.empty())
+    return mOutResamplers[0]->outputFramesFor(planeBytes / (mOutOptions->frameBytes() / numPlanes)) * mOutOptions->devicePlaneFrameBytes();
+  if (mOutConverter)
+    return planeBytes / mOutConverter->srcBytes() * mOutConverter->dstBytes();
+  return planeBytes;
+}
+
+void PaContext::silencePaBuffer(void *dstBuf, uint32_t frameCount) {
+  uint32_t sampleBytes = mOutOptions->deviceSampleBits() / 8;
+  if (mOutOptions->interleaved())
+    memset(dstBuf, 0, frameCount * mOutDeviceChannels * sampleBytes);
+  else {
+    uint8_t *const *planes = (uint8_t *const *)dstBuf;
+    for (uint32_t d = 0; d < mOutDeviceChannels; ++d)
+      memset(planes[d], 0, frameCount * sampleBytes);
+  }
+}
+
+void PaContext::checkLowWater(uint32_t queuedFrames, uint32_t frameCount) {
+  // logged once as the ring drains through the level, then rearmed when it fills past it again
+  uint32_t framesLeft = queuedFrames - std::min(queuedFrames, frameCount);
+  if (mLowWaterArmed && (framesLeft < mLowWaterFrames)) {
+    logEvent(EventLog::eEvent::OUTPUT_LOW_WATER, framesLeft);
+    mLowWaterArmed = false;
+  } else if (framesLeft >= mLowWaterFrames)
+    mLowWaterArmed = true;
+}
+
+uint32_t PaContext::inBlockBytes() const {
+  return mInOptions->batchFrames() ? mInOptions->batchFrames() * mInOptions->frameBytes() : mInOptions->highwaterMark();
+}
+
+void PaContext::writeInFrames(const uint8_t *src, uint32_t frameCount) {
+  if (mInMap.empty()) {
+    mInRings[0]->write(src, frameCount * mInOptions->deviceFrameBytes());
+    return;
+  }
+  // pick out the mapped channels a block of frames at a time
+  uint32_t sampleBytes = mInOptions->deviceSampleBits() / 8;
+  uint32_t frameBytes = mInOptions->deviceFrameBytes();
+  for (uint32_t f = 0; f < frameCount; f += sMapFrames) {
+    uint32_t numFrames = std::min<uint32_t>(sMapFrames, frameCount - f);
+    gatherChannels(sampleBytes, src, mInDeviceChannels, mInGather.data(), mInMap, numFrames);
+    mInRings[0]->write(mInGather.data(), numFrames * frameBytes);
+    src += numFrames * mInDeviceChannels * sampleBytes;
+  }
+}
+
+bool PaContext::readPaBlocks(const uint8_t *srcBuf, uint32_t frameCount, double inTimestamp) {
+  uint32_t frameBytes = mInOptions->frameBytes();
+  uint32_t blockBytes = mInPool->blockBytes();
+  uint32_t bytesRemaining = frameCount * frameBytes;
+  while (bytesRemaining) {
+    uint32_t framesDone = frameCount - bytesRemaining / frameBytes;
+    double ts = inTimestamp + (double)framesDone / mInOptions->sampleRate();
+    if (!mCaptureBlock) {
+      mCaptureBlock = mInPool->acquire(blockBytes, ts);
+      mCaptureOffset = 0;
+      if (!mCaptureBlock) {
+        // every block is still held by JS or waiting to be read
+        ++mStats.inOverruns;
+        logEvent(EventLog::eEvent::INPUT_OVERRUN);
         break;
       }
     }
-    if ((0 == bufOff) && isInput) {
-      // offset the chunk timestamp by the chunk offset
-      double timeOffset = (double)chunks->curOffset() / mInOptions->channelCount() / (mInOptions->sampleBits() / 8) / mInOptions->sampleRate();
-      timeStamp = chunks->curTs() + timeOffset;
+    if ((0 == framesDone) || (0 == mCaptureOffset))
+      mCaptureBlock->addPeriod(mCaptureOffset, ts);
+
+    uint32_t curBytes = std::min<uint32_t>(bytesRemaining, blockBytes - mCaptureOffset);
+    memcpy(mCaptureBlock->buf() + mCaptureOffset, srcBuf, curBytes);
+    // inserts run in place on the block, never across a block boundary
+    if (mInInserts)
+      mInInserts->process(mCaptureBlock->buf() + mCaptureOffset, mCaptureBlock->buf() + mCaptureOffset, curBytes / frameBytes);
+    srcBuf += curBytes;
+    mCaptureOffset += curBytes;
+    bytesRemaining -= curBytes;
+
+    if (blockBytes == mCaptureOffset) {
+      // the block ring is as large as the pool so there is always room
+      mInBlocks->write(&mCaptureBlock, 1);
+      mCaptureBlock.reset();
+      mInCv.notify_one();
     }
+  }
+  mStats.inFrames += frameCount - bytesRemaining / frameBytes;
+  return true;
+}
 
-    uint32_t curBytes = std::min<uint32_t>(numBytes, chunks->curBytes() - chunks->curOffset());
-    void *srcBuf = chunks->curBuf() + chunks->curOffset();
-    memcpy(buf + bufOff, srcBuf, curBytes);
+std::shared_ptr<Chunk> PaContext::pullInBlock(bool &finished, const std::atomic<bool> *keepWaiting) {
+  std::unique_lock<std::mutex> lk(mRingMutex);
+  while (mActive && (!keepWaiting || *keepWaiting) && !mInBlocks->readAvailable())
+    mInCv.wait_for(lk, sRingWait);
+  lk.unlock();
 
-    bufOff += curBytes;
-    chunks->incOffset(curBytes);
-    numBytes -= curBytes;
+  std::shared_ptr<Chunk> result;
+  // a cancelled wait returns an empty chunk without finishing while the stream is still running
+  finished = !mInBlocks->read(&result, 1) && !mActive;
+  if (finished && mCaptureBlock && mCaptureOffset) {
+    // the stream has stopped so the callback has let go of the partly filled block
+    result = mCaptureBlock;
+    result->reset(mCaptureOffset, result->ts());
+    mCaptureBlock.reset();
   }
+  return result ? result : std::make_shared<Chunk>(std::shared_ptr<Memory>(), 0.0);
+}
 
-  return bufOff;
+void PaContext::ringPeriods(uint32_t pos, uint32_t numBytes, std::shared_ptr<Chunk> chunk) {
+  // the first period starts at the chunk timestamp, later ones at each callback within the chunk
+  uint32_t deviceFrameBytes = mInOptions->devicePlaneFrameBytes();
+  chunk->reservePeriods(1 + mInTimes->readAvailable());
+  chunk->addPeriod(0, chunk->ts());
+  TimeMark mark;
+  while (mInTimes->peek(mark) && ((int32_t)(pos + numBytes - mark.pos) > 0)) {
+    // ring positions are in the device format and rate, chunk positions in the delivered format and rate
+    double frame = (double)((mark.pos - pos) / deviceFrameBytes);
+    if (!mInResamplers.empty())
+      frame = std::max(0.0, std::round((frame - mInResamplers[0]->outputOffset()) * mInOptions->targetSampleRate() / mInOptions->sampleRate()));
+    chunk->addPeriod((uint32_t)frame * mInOptions->frameBytes(), mark.ts);
+    mCurTime = mark;
+    mInTimes->skip(1);
+  }
+}
+
+double PaContext::ringTimestamp(uint32_t pos) {
+  // advance to the latest callback timestamp at or before the read position
+  TimeMark mark;
+  while (mInTimes->peek(mark) && ((int32_t)(pos - mark.pos) >= 0)) {
+    mCurTime = mark;
+    mInTimes->skip(1);
+  }
+  double timeOffset = (double)(pos - mCurTime.pos) / mInOptions->devicePlaneFrameBytes() / mInOptions->sampleRate();
+  return mCurTime.ts + timeOffset;
 }
 
 void PaContext::setParams(Napi::Env env, bool isInput, 
                           std::shared_ptr<AudioOptions> options, 
-                          PaStreamParameters &params, double &sampleRate) {
+                          PaStreamParameters &params, HostChannelMap &hostMap, double &sampleRate) {
+  bool nullDevice = options->nullDevice();
   int32_t deviceID = (int32_t)options->deviceID();
-  if ((deviceID >= 0) && (deviceID < Pa_GetDeviceCount()))
+  if (nullDevice)
+    params.device = paNoDevice;
+  else if ((deviceID >= 0) && (deviceID < Pa_GetDeviceCount()))
     params.device = (PaDeviceIndex)deviceID;
   else
     params.device = isInput ? Pa_GetDefaultInputDevice() : Pa_GetDefaultOutputDevice();
-  if (params.device == paNoDevice)
+  if (!nullDevice && (params.device == paNoDevice))
     throw Napi::Error::New(env, "No default device");
 
-  printf("%s device name is %s\n", isInput?"Input":"Output", Pa_GetDeviceInfo(params.device)->name);
+  if (!mQuiet)
+    printf("%s device name is %s\n", isInput?"Input":"Output", nullDevice ? "null device" : Pa_GetDeviceInfo(params.device)->name);
 
   params.channelCount = options->channelCount();
-  int maxChannels = isInput ? Pa_GetDeviceInfo(params.device)->maxInputChannels : Pa_GetDeviceInfo(params.device)->maxOutputChannels;
+  int maxChannels = nullDevice ? sNullDeviceChannels :
+    isInput ? Pa_GetDeviceInfo(params.device)->maxInputChannels : Pa_GetDeviceInfo(params.device)->maxOutputChannels;
+  params.hostApiSpecificStreamInfo = NULL;
+
+  const std::vector<int32_t> &channelMap = options->channelMap();
+  if (!channelMap.empty()) {
+    int32_t deviceChannels = 0;
+    if (isInput) {
+      if (channelMap.size() != options->channelCount())
+        throw Napi::Error::New(env, "Input channelMap must have an entry for each of channelCount channels");
+      for (auto c : channelMap) {
+        if ((c < 0) || (c >= maxChannels))
+          throw Napi::Error::New(env, "Input channelMap entries must be device channels");
+        deviceChannels = std::max<int32_t>(deviceChannels, c + 1);
+      }
+    } else {
+      for (auto c : channelMap)
+        if ((c < -1) || (c >= (int32_t)options->channelCount()))
+          throw Napi::Error::New(env, "Output channelMap entries must be stream channels or -1");
+      deviceChannels = (int32_t)channelMap.size();
+    }
+
+    const PaHostApiInfo *hostApiInfo = nullDevice ? nullptr : Pa_GetHostApiInfo(Pa_GetDeviceInfo(params.device)->hostApi);
+#ifdef __APPLE__
+    if (hostApiInfo && (paCoreAudio == hostApiInfo->type)) {
+      // CoreAudio maps channels in the HAL using the same convention, the stream only carries the mapped channels
+      PaMacCore_SetupStreamInfo(&hostMap.macCoreInfo, paMacCorePlayNice);
+      PaMacCore_SetupChannelMap(&hostMap.macCoreInfo, (const SInt32 *)channelMap.data(), channelMap.size());
+      params.hostApiSpecificStreamInfo = &hostMap.macCoreInfo;
+      deviceChannels = 0;
+    }
+#endif
+    if (deviceChannels) {
+      if (!mQuiet)
+        printf("%s channels mapped natively with %s\n", isInput?"Input":"Output", hostApiInfo ? hostApiInfo->name : "null device");
+      params.channelCount = deviceChannels;
+      (isInput ? mInMap : mOutMap) = channelMap;
+    }
+  }
+  (isInput ? mInDeviceChannels : mOutDeviceChannels) = params.channelCount;
+
   if (params.channelCount > maxChannels)
     throw Napi::Error::New(env, "Channel count exceeds maximum number of channels for device");
 
-  uint32_t sampleFormat = options->sampleFormat();
-  switch(sampleFormat) {
+  if (!SampleConverter::isValidFormat(options->sampleFormat()))
+    throw Napi::Error::New(env, "Invalid sampleFormat");
+
+  uint32_t deviceFormat = options->deviceFormat();
+  switch(deviceFormat) {
   case 1: params.sampleFormat = paFloat32; break;
   case 8: params.sampleFormat = paInt8; break;
   case 16: params.sampleFormat = paInt16; break;
   case 24: params.sampleFormat = paInt24; break;
   case 32: params.sampleFormat = paInt32; break;
-  default: throw Napi::Error::New(env, "Invalid sampleFormat");
+  default: throw Napi::Error::New(env, "Invalid deviceFormat");
   }
+  if (!options->interleaved())
+    params.sampleFormat |= paNonInterleaved;
 
-  params.suggestedLatency = isInput ? Pa_GetDeviceInfo(params.device)->defaultLowInputLatency : 
-                                      Pa_GetDeviceInfo(params.device)->defaultLowOutputLatency;
-  params.hostApiSpecificStreamInfo = NULL;
+  const PaDeviceInfo *deviceInfo = nullDevice ? nullptr : Pa_GetDeviceInfo(params.device);
+  if (options->suggestedLatency() > 0.0)
+    params.suggestedLatency = options->suggestedLatency();
+  else if (0 == options->latencyMode().compare("low"))
+    params.suggestedLatency = !deviceInfo ? 0.01 : isInput ? deviceInfo->defaultLowInputLatency : deviceInfo->defaultLowOutputLatency;
+  else if (0 == options->latencyMode().compare("high"))
+    params.suggestedLatency = !deviceInfo ? 0.1 : isInput ? deviceInfo->defaultHighInputLatency : deviceInfo->defaultHighOutputLatency;
+  else
+    throw Napi::Error::New(env, "Invalid suggestedLatency - expects a number of seconds, \'low\' or \'high\'");
 
   sampleRate = (double)options->sampleRate();
-
-  #ifdef __arm__
-  params.suggestedLatency = isInput ? Pa_GetDeviceInfo(params.device)->defaultHighInputLatency : 
-                                      Pa_GetDeviceInfo(params.device)->defaultHighOutputLatency;
-  #endif
 }
 
 } // namespace streampunk
\ No newline at end of file
@@ -19,14 +19,54 @@
 #include <napi.h>
 #include <memory>
 #include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <chrono>
+#include <vector>
+#include "Chunks.h"
+#include "EventLog.h"
+#include "ThreadPriority.h"
 
 struct PaStreamParameters;
 
 namespace streampunk {
 
 class AudioOptions;
-class Chunk;
-class Chunks;
+class MemoryPool;
+class PaHost;
+class SampleConverter;
+class ResampleStage;
+class Mixer;
+class Histogram;
+class NullDevice;
+class InsertChain;
+template <class T> class RingBuffer;
+struct HostChannelMap;
+
+// counters kept by the callback, which is their only writer, and cheap to read at any time
+struct StreamStats {
+  StreamStats()
+    : callbacks(0), inputUnderflows(0), inputOverflows(0), outputUnderflows(0), outputOverflows(0),
+      primingOutputs(0), inOverruns(0), outUnderruns(0), inFrames(0), outFrames(0),
+      inQueueHighWater(0), outQueueHighWater(0) {}
+
+  std::atomic<uint64_t> callbacks;
+  // PortAudio status flags reported to the callback
+  std::atomic<uint32_t> inputUnderflows;
+  std::atomic<uint32_t> inputOverflows;
+  std::atomic<uint32_t> outputUnderflows;
+  std::atomic<uint32_t> outputOverflows;
+  std::atomic<uint32_t> primingOutputs;
+  // periods dropped or padded with silence at the rings
+  std::atomic<uint32_t> inOverruns;
+  std::atomic<uint32_t> outUnderruns;
+  // device frames passed through the rings
+  std::atomic<uint64_t> inFrames;
+  std::atomic<uint64_t> outFrames;
+  // most frames seen queued in the rings
+  std::atomic<uint32_t> inQueueHighWater;
+  std::atomic<uint32_t> outQueueHighWater;
+};
 
 class PaContext {
 public:
@@ -37,12 +77,42 @@ public:
 
   bool hasInput() { return mInOptions ? true : false; }
   bool hasOutput() { return mOutOptions ? true : false; }
+  std::shared_ptr<AudioOptions> getInOptions() const { return mInOptions; }
+  std::shared_ptr<AudioOptions> getOutOptions() const { return mOutOptions; }
 
   void start(Napi::Env env);
   void stop(eStopFlag flag);
+  // false once the stream has stopped or quit
+  bool isActive() const { return mActive; }
 
-  std::shared_ptr<Chunk> pullInChunk(uint32_t numBytes, bool &finished);
-  void pushOutChunk(std::shared_ptr<Chunk> chunk);
+  // waiting for input also stops early once a keepWaiting flag is cleared
+  std::shared_ptr<Chunk> pullInChunk(uint32_t numBytes, bool &finished,
+                                     const std::atomic<bool> *keepWaiting = nullptr);
+  // reads into a caller owned buffer instead of a pooled chunk, returns the bytes written
+  uint32_t pullInto(uint8_t *dst, uint32_t dstBytes, bool &finished, double &ts,
+                    const std::atomic<bool> *keepWaiting = nullptr);
+  // waiting for room also stops early once a keepWaiting flag is cleared
+  void pushOutChunk(std::shared_ptr<Chunk> chunk, const std::atomic<bool> *keepWaiting = nullptr);
+  // pushes the chunk only if it needs no conversion, no write is pending and the ring has room for all of it now
+  bool tryPushOutChunk(std::shared_ptr<Chunk> chunk);
+  // true when a pullInChunk or pushOutChunk of numBytes would not wait
+  bool inputReady(uint32_t numBytes) const;
+  bool outputReady(uint32_t numBytes) const;
+  // the input rings have a single consumer, so only one read from JS may be outstanding
+  void beginRead() { ++mReadsPending; }
+  void endRead() { --mReadsPending; }
+  bool readPending() const { return mReadsPending > 0; }
+  // the stage a readInto pulls through, grown on demand and only touched by the one claimed read
+  uint8_t *intoStage(uint32_t numBytes);
+  // writes from JS that have yet to finish with the output rings, no file may play alongside them
+  void beginWrite() { ++mWritesPending; }
+  void endWrite() { --mWritesPending; }
+  bool writePending() const { return mWritesPending > 0; }
+
+  // bytes of SharedArrayBuffer needed to share the ring for the direction, zero when it is not shared
+  uint32_t sharedRingBytes(bool isInput) const;
+  // moves the ring into memory shared with JS, before the stream starts - mem must stay valid until it closes
+  void shareRing(bool isInput, uint8_t *mem);
 
   void checkStatus(uint32_t statusFlags);
   bool getErrStr(std::string& errStr, bool isInput);
@@ -50,29 +120,174 @@ public:
   void quit();
 
   bool readPaBuffer(const void *srcBuf, uint32_t frameCount, double inTimestamp);
-  bool fillPaBuffer(void *dstBuf, uint32_t frameCount);
+  bool fillPaBuffer(void *dstBuf, uint32_t frameCount, double outTimestamp);
+  void outputFinished();
+  // mixes the input callback buffer into the output callback buffer
+  bool hasPassthrough() const { return !mPassMap.empty(); }
+  void passthrough(const void *srcBuf, void *dstBuf, uint32_t frameCount);
+  // runs the output insert chain over the callback buffer once it has been filled
+  bool hasOutInserts() const { return mOutInserts ? true : false; }
+  void applyOutInserts(void *dstBuf, uint32_t frameCount);
+  std::shared_ptr<InsertChain> getInInserts() const { return mInInserts; }
+  std::shared_ptr<InsertChain> getOutInserts() const { return mOutInserts; }
+
+  // latest count of device frames played and the DAC time of the first of them
+  bool readOutTime(TimeMark &mark);
+  uint32_t outQueuedFrames() const;
 
   double getCurTime() const;
   double getInLatency() const { return mInLatency; }
+  double getOutLatency() const { return mOutLatency; }
+  double getSampleRate() const { return mSampleRate; }
+  uint32_t getFramesPerBuffer() const { return mFramesPerBuffer; }
+  uint32_t getStreamFlags() const { return mStreamFlags; }
+
+  std::shared_ptr<MemoryPool> getInPool() const { return mInPool; }
+  std::shared_ptr<Mixer> getMixer() const { return mMixer; }
+
+  uint32_t inOverruns() const { return mStats.inOverruns; }
+  uint32_t outUnderruns() const { return mStats.outUnderruns; }
+  const StreamStats &getStats() const { return mStats; }
+  std::shared_ptr<EventLog> getEventLog() const { return mEventLog; }
+  double getCpuLoad() const;
+
+  // callback timing histograms in microseconds, null unless timingStats is set
+  bool hasTiming() const { return mDurationHist ? true : false; }
+  void recordTiming(std::chrono::steady_clock::time_point start, double adcTime, double dacTime);
+  std::shared_ptr<Histogram> getIntervalHist() const { return mIntervalHist; }
+  std::shared_ptr<Histogram> getDurationHist() const { return mDurationHist; }
+  std::shared_ptr<Histogram> getAdcDeltaHist() const { return mAdcDeltaHist; }
+  std::shared_ptr<Histogram> getDacDeltaHist() const { return mDacDeltaHist; }
+
+  // the callback applies callbackPriority and callbackCpus to its own thread the first time it runs
+  bool callbackThreadPending() const { return mCallbackThread && !mCallbackThreadSet; }
+  void initCallbackThread();
+  // applies workerPriority and workerCpus to the calling thread and records the outcome under name
+  void initWorkerThread(const std::string &name);
+  // false until the callback thread settings have been applied
+  bool getCallbackThread(ThreadPriority::Report &report) const;
+  std::vector<std::pair<std::string, ThreadPriority::Report> > getWorkerThreads() const;
 
 private:
+  std::shared_ptr<PaHost> mPaHost;
   std::shared_ptr<AudioOptions> mInOptions;
   std::shared_ptr<AudioOptions> mOutOptions;
-  std::shared_ptr<Chunks> mInChunks;
-  std::shared_ptr<Chunks> mOutChunks;
+  // one ring per plane, all advanced in step - ring 0 carries the positions used for timing
+  std::vector<std::shared_ptr<RingBuffer<uint8_t> > > mInRings;
+  std::shared_ptr<RingBuffer<TimeMark> > mInTimes;
+  std::shared_ptr<MemoryPool> mInPool;
+  std::shared_ptr<RingBuffer<std::shared_ptr<Chunk> > > mInBlocks;
+  std::shared_ptr<Chunk> mCaptureBlock;
+  uint32_t mCaptureOffset;
+  std::vector<std::shared_ptr<RingBuffer<uint8_t> > > mOutRings;
+  std::shared_ptr<SampleConverter> mInConverter;
+  std::shared_ptr<SampleConverter> mOutConverter;
+  // one resampler per plane when the target rate differs from the device rate
+  std::vector<std::shared_ptr<ResampleStage> > mInResamplers;
+  std::vector<std::shared_ptr<ResampleStage> > mOutResamplers;
+  std::vector<uint8_t> mInStage;
+  std::vector<uint8_t> mOutStage;
+  std::vector<uint8_t> mIntoStage;
+  // channel maps applied in the callback, empty when every channel is used or the host API maps them
+  std::vector<int32_t> mInMap;
+  std::vector<int32_t> mOutMap;
+  uint32_t mInDeviceChannels;
+  uint32_t mOutDeviceChannels;
+  std::vector<uint8_t> mInGather;
+  std::vector<uint8_t> mOutScatter;
+  // passthrough from each output callback channel to an input callback channel, or -1
+  std::vector<int32_t> mPassMap;
+  uint32_t mPassInChannels;
+  float mPassGain;
+  std::shared_ptr<SampleConverter> mPassInDecode;
+  std::shared_ptr<SampleConverter> mPassOutDecode;
+  std::shared_ptr<SampleConverter> mPassOutEncode;
+  std::vector<float> mPassIn;
+  std::vector<float> mPassOut;
+  // sources are mixed in float then encoded to the device format
+  std::shared_ptr<Mixer> mMixer;
+  std::shared_ptr<SampleConverter> mMixEncode;
+  std::vector<float> mMixBuf;
+  // DSP inserts on the device samples, input runs on a copy as the callback buffer is read only
+  std::shared_ptr<InsertChain> mInInserts;
+  std::shared_ptr<InsertChain> mOutInserts;
+  std::vector<uint8_t> mInInsertStage;
+  TimeMark mCurTime;
+  std::shared_ptr<RingBuffer<TimeMark> > mOutTimes;
+  // ring positions of scheduled chunks and the stream time each should reach the DAC
+  std::shared_ptr<RingBuffer<TimeMark> > mOutMarks;
+  uint32_t mDropFrames;
+  uint32_t mOutFrames;
+  // the callback plays silence until the output ring first holds the prefill
+  uint32_t mPrefillFrames;
+  std::atomic<bool> mPrefilling;
+  uint32_t mLowWaterFrames;
+  bool mLowWaterArmed;
+  std::chrono::steady_clock::time_point mLastDelivery;
+  std::atomic<bool> mActive;
+  StreamStats mStats;
+  std::atomic<uint32_t> mStatusFlags;
+  std::shared_ptr<EventLog> mEventLog;
+  bool mOutFinished;
+  bool mQuiet;
+  std::shared_ptr<Histogram> mIntervalHist;
+  std::shared_ptr<Histogram> mDurationHist;
+  std::shared_ptr<Histogram> mAdcDeltaHist;
+  std::shared_ptr<Histogram> mDacDeltaHist;
+  std::chrono::steady_clock::time_point mLastCallback;
+  double mLastAdcTime;
+  double mLastDacTime;
   void *mStream;
+  std::shared_ptr<NullDevice> mNullDevice;
+  std::shared_ptr<ThreadPriority> mCallbackThread;
+  std::shared_ptr<ThreadPriority> mWorkerThread;
+  ThreadPriority::Report mCallbackReport;
+  std::atomic<bool> mCallbackThreadSet;
+  mutable std::mutex mThreadMutex;
+  std::vector<std::pair<std::string, ThreadPriority::Report> > mWorkerReports;
   double mInLatency;
-  std::string mErrStr;
-  std::mutex m;
+  double mOutLatency;
+  double mSampleRate;
+  uint32_t mFramesPerBuffer;
+  uint32_t mStreamFlags;
+  std::mutex mRingMutex;
+  std::condition_variable mInCv;
+  std::condition_variable mOutCv;
+  uint8_t *mInShared;
+  uint8_t *mOutShared;
+  std::atomic<uint32_t> mReadsPending;
+  std::atomic<uint32_t> mWritesPending;
+  // bytes of the last input period, which is dropped whole if the ring cannot take it
+  std::atomic<uint32_t> mInPeriodBytes;
 
-  uint32_t fillBuffer(uint8_t *buf, uint32_t numBytes,
-                      double &timeStamp,
-                      std::shared_ptr<Chunks> chunks,
-                      bool &finished, bool isInput);
+  uint32_t inBlockBytes() const;
+  void logEvent(EventLog::eEvent type, uint32_t value = 0);
+  uint32_t outWriteAvailable() const;
+  uint32_t inRingBytes(uint32_t numBytes, uint32_t &minBytes) const;
+  bool inRingHolds(uint32_t numBytes) const;
+  uint32_t waitInRing(uint32_t numBytes, uint32_t minBytes, bool &finished, const std::atomic<bool> *keepWaiting);
+  uint32_t inDeliveredBytes(uint32_t bytesRead, double &ts);
+  void readInRings(uint32_t bytesRead, uint32_t chunkBytes, uint8_t *buf);
+  uint32_t outPlaneBytes(uint32_t numBytes) const;
+  void silencePaBuffer(void *dstBuf, uint32_t frameCount);
+  void checkLowWater(uint32_t queuedFrames, uint32_t frameCount);
+  bool fillPaMapped(void *dstBuf, uint32_t frameCount);
+  bool fillPaMixed(void *dstBuf, uint32_t frameCount);
+  bool fillPaScheduled(void *dstBuf, uint32_t frameCount, double outTimestamp);
+  void makePassthrough(Napi::Env env);
+  void makeThreadPriorities(Napi::Env env, double periodSecs);
+  std::shared_ptr<InsertChain> makeInserts(Napi::Env env, bool isInput, std::shared_ptr<AudioOptions> options);
+  void makeResamplers(Napi::Env env, bool isInput, std::shared_ptr<AudioOptions> options,
+                      std::vector<std::shared_ptr<ResampleStage> > &resamplers);
+  void writeInFrames(const uint8_t *src, uint32_t frameCount);
+  bool readPaBlocks(const uint8_t *srcBuf, uint32_t frameCount, double inTimestamp);
+  std::shared_ptr<Chunk> pullInBlock(bool &finished, const std::atomic<bool> *keepWaiting);
+  double ringTimestamp(uint32_t pos);
+  void ringPeriods(uint32_t pos, uint32_t numBytes, std::shared_ptr<Chunk> chunk);
 
   void setParams(Napi::Env env, bool isInput, 
                  std::shared_ptr<AudioOptions> options, 
-                 PaStreamParameters &params, double &sampleRate);
+                 PaStreamParameters &params, HostChannelMap &hostMap, double &sampleRate);
 };
 
 } // namespace streampunk
@@ -0,0 +1,95 @@
+/* Copyright 2019 Streampunk Media Ltd.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#include "PaHost.h"
+#include <portaudio.h>
+#include <algorithm>
+
+namespace streampunk {
+
+std::mutex PaHost::sMutex;
+std::shared_ptr<PaHost> PaHost::sHost;
+bool PaHost::sCleanupHooked = false;
+
+std::shared_ptr<PaHost> PaHost::acquire(Napi::Env env) {
+  std::lock_guard<std::mutex> lk(sMutex);
+  if (!sHost)
+    init(env);
+  return sHost;
+}
+
+bool PaHost::refresh(Napi::Env env, std::vector<DeviceInfo> &added, std::vector<DeviceInfo> &removed) {
+  std::lock_guard<std::mutex> lk(sMutex);
+  if (sHost && (sHost.use_count() > 1))
+    return false;
+
+  std::vector<DeviceInfo> oldDevices;
+  if (sHost)
+    oldDevices = sHost->mDevices;
+  sHost.reset();
+  init(env);
+
+  const std::vector<DeviceInfo> &newDevices = sHost->mDevices;
+  for (auto &d : newDevices)
+    if (std::none_of(oldDevices.begin(), oldDevices.end(), [&d](const DeviceInfo &o) { return d.sameDevice(o); }))
+      added.push_back(d);
+  for (auto &o : oldDevices)
+    if (std::none_of(newDevices.begin(), newDevices.end(), [&o](const DeviceInfo &d) { return d.sameDevice(o); }))
+      removed.push_back(o);
+  return true;
+}
+
+PaHost::PaHost() {
+  int32_t numDevices = Pa_GetDeviceCount();
+  for (int32_t i = 0; i < numDevices; ++i) {
+    const PaDeviceInfo *paInfo = Pa_GetDeviceInfo(i);
+    DeviceInfo deviceInfo;
+    deviceInfo.name = paInfo->name;
+    deviceInfo.hostAPIName = Pa_GetHostApiInfo(paInfo->hostApi)->name;
+    deviceInfo.maxInputChannels = paInfo->maxInputChannels;
+    deviceInfo.maxOutputChannels = paInfo->maxOutputChannels;
+    deviceInfo.defaultSampleRate = paInfo->defaultSampleRate;
+    deviceInfo.defaultLowInputLatency = paInfo->defaultLowInputLatency;
+    deviceInfo.defaultLowOutputLatency = paInfo->defaultLowOutputLatency;
+    deviceInfo.defaultHighInputLatency = paInfo->defaultHighInputLatency;
+    deviceInfo.defaultHighOutputLatency = paInfo->defaultHighOutputLatency;
+    mDevices.push_back(deviceInfo);
+  }
+}
+
+PaHost::~PaHost() {
+  Pa_Terminate();
+}
+
+// sMutex must be held
+void PaHost::init(Napi::Env env) {
+  PaError errCode = Pa_Initialize();
+  if (errCode != paNoError) {
+    std::string err = std::string("Could not initialize PortAudio: ") + Pa_GetErrorText(errCode);
+    throw Napi::Error::New(env, err.c_str());
+  }
+  sHost = std::shared_ptr<PaHost>(new PaHost());
+  if (!sCleanupHooked) {
+    napi_add_env_cleanup_hook(env, cleanup, nullptr);
+    sCleanupHooked = true;
+  }
+}
+
+void PaHost::cleanup(void *arg) {
+  std::lock_guard<std::mutex> lk(sMutex);
+  sHost.reset();
+}
+
+} // namespace streampunk
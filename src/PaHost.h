@@ -0,0 +1,73 @@
+/* Copyright 2019 Streampunk Media Ltd.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef PAHOST_H
+#define PAHOST_H
+
+#include <napi.h>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace streampunk {
+
+struct DeviceInfo {
+  std::string name;
+  std::string hostAPIName;
+  int32_t maxInputChannels;
+  int32_t maxOutputChannels;
+  double defaultSampleRate;
+  double defaultLowInputLatency;
+  double defaultLowOutputLatency;
+  double defaultHighInputLatency;
+  double defaultHighOutputLatency;
+
+  bool sameDevice(const DeviceInfo &other) const {
+    return (name == other.name) && (hostAPIName == other.hostAPIName);
+  }
+};
+
+// Process-wide PortAudio initialisation shared by every entry point of the addon.
+// The module holds a reference until its environment is torn down and each open
+// stream holds another, so Pa_Terminate only runs once nothing is using PortAudio.
+class PaHost {
+public:
+  static std::shared_ptr<PaHost> acquire(Napi::Env env);
+  ~PaHost();
+
+  // snapshot of the devices taken when PortAudio was initialised
+  const std::vector<DeviceInfo> &devices() const { return mDevices; }
+
+  // PortAudio only enumerates devices as it initialises, so this reinitialises it.
+  // Returns false, leaving everything as it was, when any stream is open.
+  static bool refresh(Napi::Env env, std::vector<DeviceInfo> &added, std::vector<DeviceInfo> &removed);
+
+private:
+  PaHost();
+
+  std::vector<DeviceInfo> mDevices;
+
+  static std::mutex sMutex;
+  static std::shared_ptr<PaHost> sHost;
+  static bool sCleanupHooked;
+
+  static void init(Napi::Env env);
+  static void cleanup(void *arg);
+  PaHost(const PaHost &);
+};
+
+} // namespace streampunk
+
+#endif
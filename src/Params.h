@@ -18,6 +18,9 @@
 
 #include <napi.h>
 #include <sstream>
+#include <algorithm>
+#include <vector>
+#include <memory>
 
 using namespace Napi;
 
@@ -52,6 +55,14 @@ protected:
     return result;
   } 
 
+  double unpackDouble(Napi::Env env, Napi::Object tags, const std::string& key, double dflt) {
+    double result = dflt;
+    Napi::Value val = getKey(env, tags, key);
+    if ((env.Null() != val) && val.IsNumber())
+      result = val.As<Napi::Number>().DoubleValue();
+    return result;
+  } 
+
   std::string unpackStr(Napi::Env env, Napi::Object tags, const std::string& key, std::string dflt) {
     std::string result = dflt;
     Napi::Value val = getKey(env, tags, key);
@@ -60,31 +71,219 @@ protected:
     return result;
   } 
 
+  std::vector<int32_t> unpackIntArray(Napi::Env env, Napi::Object tags, const std::string& key) {
+    std::vector<int32_t> result;
+    Napi::Value val = getKey(env, tags, key);
+    if ((env.Null() != val) && val.IsArray()) {
+      Napi::Array arr = val.As<Napi::Array>();
+      for (uint32_t i = 0; i < arr.Length(); ++i) {
+        Napi::Value el = arr.Get(i);
+        if (!el.IsNumber())
+          throw Napi::Error::New(env, key + " must be an array of numbers");
+        result.push_back(el.As<Napi::Number>().Int32Value());
+      }
+    }
+    return result;
+  }
+
 private:
   Params(const Params &);
 };
 
 
+#ifdef __arm__
+static const char *sDefaultLatency = "high";
+#else
+static const char *sDefaultLatency = "low";
+#endif
+
+// one stage of the DSP insert chain that runs on a stream in the audio callback
+class InsertOptions : public Params {
+public:
+  InsertOptions(Napi::Env env, Napi::Object tags)
+    : mType(unpackStr(env, tags, "type", "")),
+      mGain(unpackDouble(env, tags, "gain", 1.0)),
+      mMute(unpackBool(env, tags, "mute", false)),
+      mRampMs(unpackDouble(env, tags, "rampMs", 10.0)),
+      mWindowMs(unpackDouble(env, tags, "windowMs", 300.0)),
+      mCutoff(unpackDouble(env, tags, "cutoff", 10.0)),
+      mShape(unpackStr(env, tags, "shape", "peaking")),
+      mFrequency(unpackDouble(env, tags, "frequency", 1000.0)),
+      mQ(unpackDouble(env, tags, "q", 0.7071)),
+      mGainDb(unpackDouble(env, tags, "gainDb", 0.0))
+  {}
+  ~InsertOptions() {}
+
+  // 'gain', 'meter', 'dcBlock' or 'biquad'
+  const std::string &type() const  { return mType; }
+  // gain - linear gain, muting, and the time taken to move to a new gain
+  double gain() const  { return mGain; }
+  bool mute() const  { return mMute; }
+  double rampMs() const  { return mRampMs; }
+  // meter - time constant of the RMS average
+  double windowMs() const  { return mWindowMs; }
+  // dcBlock - corner frequency of the high pass in Hz
+  double cutoff() const  { return mCutoff; }
+  // biquad - 'lowpass', 'highpass', 'bandpass', 'notch', 'peaking', 'lowshelf' or 'highshelf'
+  const std::string &shape() const  { return mShape; }
+  double frequency() const  { return mFrequency; }
+  double q() const  { return mQ; }
+  double gainDb() const  { return mGainDb; }
+
+  std::string toString() const  {
+    std::stringstream ss;
+    ss << mType;
+    if (0 == mType.compare("gain"))
+      ss << " " << mGain << (mMute ? " muted" : "") << " ramp " << mRampMs << "ms";
+    else if (0 == mType.compare("meter"))
+      ss << " window " << mWindowMs << "ms";
+    else if (0 == mType.compare("dcBlock"))
+      ss << " cutoff " << mCutoff << "Hz";
+    else if (0 == mType.compare("biquad"))
+      ss << " " << mShape << " " << mFrequency << "Hz q " << mQ << " gain " << mGainDb << "dB";
+    return ss.str();
+  }
+
+private:
+  std::string mType;
+  double mGain;
+  bool mMute;
+  double mRampMs;
+  double mWindowMs;
+  double mCutoff;
+  std::string mShape;
+  double mFrequency;
+  double mQ;
+  double mGainDb;
+};
+
 class AudioOptions : public Params {
 public:
   AudioOptions(Napi::Env env, Napi::Object tags)
     : mDeviceID(unpackNum(env, tags, "deviceId", 0xffffffff)),
       mSampleRate(unpackNum(env, tags, "sampleRate", 44100)),
+      mTargetSampleRate(unpackNum(env, tags, "targetSampleRate", mSampleRate)),
+      mResampleQuality(unpackStr(env, tags, "resampleQuality", "medium")),
       mChannelCount(unpackNum(env, tags, "channelCount", 2)),
       mSampleFormat(unpackNum(env, tags, "sampleFormat", 8)),
       mSampleBits(1 == mSampleFormat ? 32 : mSampleFormat),
+      mDeviceFormat(unpackNum(env, tags, "deviceFormat", mSampleFormat)),
+      mDeviceSampleBits(1 == mDeviceFormat ? 32 : mDeviceFormat),
+      mDither(unpackBool(env, tags, "dither", false)),
+      mInterleaved(unpackBool(env, tags, "interleaved", true)),
+      mChannelMap(unpackIntArray(env, tags, "channelMap")),
+      mPassthrough(unpackBool(env, tags, "passthrough", false)),
+      mPassthroughGain(unpackDouble(env, tags, "passthroughGain", 1.0)),
+      mPassthroughMap(unpackIntArray(env, tags, "passthroughMap")),
+      mMixerSources(unpackNum(env, tags, "mixerSources", 0)),
+      mScheduled(unpackBool(env, tags, "scheduled", false)),
+      mScheduleToleranceMs(unpackDouble(env, tags, "scheduleToleranceMs", 1.0)),
       mMaxQueue(unpackNum(env, tags, "maxQueue", 2)),
-      mCloseOnError(unpackBool(env, tags, "closeOnError", true))
+      mRingFrames(unpackNum(env, tags, "ringFrames", 8192)),
+      mBufferMs(unpackDouble(env, tags, "bufferMs", 0.0)),
+      mPrefillFrames(unpackNum(env, tags, "prefillFrames", 0)),
+      mPrefillMs(unpackDouble(env, tags, "prefillMs", 0.0)),
+      mLowWaterFrames(unpackNum(env, tags, "lowWaterFrames", 0)),
+      mLowWaterMs(unpackDouble(env, tags, "lowWaterMs", 0.0)),
+      mHighwaterMark(unpackNum(env, tags, "highwaterMark", 16384)),
+      mPoolSize(unpackNum(env, tags, "poolSize", 8)),
+      mZeroCopy(unpackBool(env, tags, "zeroCopy", false)),
+      mSharedRing(unpackBool(env, tags, "sharedRing", false)),
+      mIOThread(unpackBool(env, tags, "ioThread", false)),
+      mBatchFrames(unpackNum(env, tags, "batchFrames", 0)),
+      mMaxDeliveryIntervalMs(unpackNum(env, tags, "maxDeliveryIntervalMs", 0)),
+      mFramesPerBuffer(unpackNum(env, tags, "framesPerBuffer", 0)),
+      mSuggestedLatency(unpackDouble(env, tags, "suggestedLatency", 0.0)),
+      mLatencyMode(unpackStr(env, tags, "suggestedLatency", sDefaultLatency)),
+      mStreamFlags(unpackNum(env, tags, "streamFlags", 0)),
+      mCloseOnError(unpackBool(env, tags, "closeOnError", true)),
+      mTimingStats(unpackBool(env, tags, "timingStats", false)),
+      mQuiet(unpackBool(env, tags, "quiet", false)),
+      mNullDevice(unpackBool(env, tags, "nullDevice", false)),
+      mNullDeviceSpeed(unpackDouble(env, tags, "nullDeviceSpeed", 1.0)),
+      mCallbackPriority(unpackStr(env, tags, "callbackPriority", "default")),
+      mWorkerPriority(unpackStr(env, tags, "workerPriority", "default")),
+      mRealtimePriority(unpackNum(env, tags, "realtimePriority", 70)),
+      mCallbackCpus(unpackIntArray(env, tags, "callbackCpus")),
+      mWorkerCpus(unpackIntArray(env, tags, "workerCpus")),
+      mInserts(unpackInserts(env, tags))
   {}
   ~AudioOptions() {}
 
   uint32_t deviceID() const  { return mDeviceID; }
   uint32_t sampleRate() const  { return mSampleRate; }
+  // rate delivered to or taken from JS, the device runs at sampleRate
+  uint32_t targetSampleRate() const  { return mTargetSampleRate; }
+  bool resampling() const  { return mTargetSampleRate != mSampleRate; }
+  const std::string &resampleQuality() const  { return mResampleQuality; }
   uint32_t channelCount() const  { return mChannelCount; }
   uint32_t sampleFormat() const  { return mSampleFormat; }
   uint32_t sampleBits() const  { return mSampleBits; }
+  uint32_t frameBytes() const  { return mChannelCount * mSampleBits / 8; }
+  // format the device is opened with, samples are converted to and from sampleFormat when they differ
+  uint32_t deviceFormat() const  { return mDeviceFormat; }
+  uint32_t deviceSampleBits() const  { return mDeviceSampleBits; }
+  uint32_t deviceFrameBytes() const  { return mChannelCount * mDeviceSampleBits / 8; }
+  bool converting() const  { return mDeviceFormat != mSampleFormat; }
+  bool dither() const  { return mDither; }
+  // non-interleaved streams carry each channel in its own plane
+  bool interleaved() const  { return mInterleaved; }
+  uint32_t numPlanes() const  { return mInterleaved ? 1 : mChannelCount; }
+  uint32_t devicePlaneFrameBytes() const  { return deviceFrameBytes() / numPlanes(); }
+  // input - the device channel for each stream channel
+  // output - the stream channel for each device channel, or -1 for silence
+  const std::vector<int32_t> &channelMap() const  { return mChannelMap; }
+  // output only - mix the input of a duplex stream straight into the output in the callback
+  bool passthrough() const  { return mPassthrough; }
+  double passthroughGain() const  { return mPassthroughGain; }
+  // the input stream channel for each output stream channel, or -1 for none
+  const std::vector<int32_t> &passthroughMap() const  { return mPassthroughMap; }
+  // output only - number of mixer source slots, zero for a stream written directly
+  uint32_t mixerSources() const  { return mMixerSources; }
+  // output only - play buffers carrying a presentationTime when that time reaches the DAC
+  bool scheduled() const  { return mScheduled; }
+  // timing errors up to this size are left alone rather than corrected with silence or dropped frames
+  double scheduleToleranceMs() const  { return mScheduleToleranceMs; }
   uint32_t maxQueue() const  { return mMaxQueue; }
+  // ring size in device frames, from bufferMs when it is set
+  uint32_t ringFrames() const  { return mBufferMs > 0.0 ? msToFrames(mBufferMs) : mRingFrames; }
+  // output only - frames queued before the callback first takes from the ring
+  uint32_t prefillFrames() const  { return std::min(ringFrames(), mPrefillMs > 0.0 ? msToFrames(mPrefillMs) : mPrefillFrames); }
+  // output only - a queue level that logs an outputLowWater event when the ring drains below it
+  uint32_t lowWaterFrames() const  { return std::min(ringFrames(), mLowWaterMs > 0.0 ? msToFrames(mLowWaterMs) : mLowWaterFrames); }
+  uint32_t highwaterMark() const  { return mHighwaterMark; }
+  uint32_t poolSize() const  { return mPoolSize; }
+  bool zeroCopy() const  { return mZeroCopy; }
+  // keep the ring in a SharedArrayBuffer for a JS worker to read or write directly
+  bool sharedRing() const  { return mSharedRing; }
+  bool ioThread() const  { return mIOThread; }
+  uint32_t batchFrames() const  { return mBatchFrames; }
+  uint32_t maxDeliveryIntervalMs() const  { return mMaxDeliveryIntervalMs; }
+  bool batching() const  { return mBatchFrames || mMaxDeliveryIntervalMs; }
+  uint32_t framesPerBuffer() const  { return mFramesPerBuffer; }
+  // explicit latency in seconds, or zero to use the device default latency for latencyMode()
+  double suggestedLatency() const  { return mSuggestedLatency; }
+  const std::string &latencyMode() const  { return mLatencyMode; }
+  uint32_t streamFlags() const  { return mStreamFlags; }
   bool closeOnError() const  { return mCloseOnError; }
+  // record callback timing histograms for the stream
+  bool timingStats() const  { return mTimingStats; }
+  // no console output about the stream
+  bool quiet() const  { return mQuiet; }
+  // run the stream on a simulated device instead of PortAudio hardware
+  bool nullDevice() const  { return mNullDevice; }
+  // pace of the simulated device against real time, zero to run flat out
+  double nullDeviceSpeed() const  { return mNullDeviceSpeed; }
+  // 'default', 'high' or 'realtime' scheduling for the callback thread and the addon's own threads
+  const std::string &callbackPriority() const  { return mCallbackPriority; }
+  const std::string &workerPriority() const  { return mWorkerPriority; }
+  // SCHED_FIFO priority of a realtime callback, workers run just below it
+  uint32_t realtimePriority() const  { return mRealtimePriority; }
+  // cores to pin the threads to, empty to leave them free
+  const std::vector<int32_t> &callbackCpus() const  { return mCallbackCpus; }
+  const std::vector<int32_t> &workerCpus() const  { return mWorkerCpus; }
+  // DSP stages applied in order to the device samples in the callback
+  const std::vector<std::shared_ptr<InsertOptions> > &inserts() const  { return mInserts; }
 
   std::string toString() const  { 
     std::stringstream ss;
@@ -94,21 +293,294 @@ public:
     else
       ss << "device " << mDeviceID << ", ";
     ss << "sample rate " << mSampleRate << ", ";
+    if (resampling())
+      ss << "target sample rate " << mTargetSampleRate << " (" << mResampleQuality << " quality), ";
     ss << "channels " << mChannelCount << ", ";
+    if (!mChannelMap.empty()) {
+      ss << "channel map [";
+      for (size_t i = 0; i < mChannelMap.size(); ++i)
+        ss << (i ? "," : "") << mChannelMap[i];
+      ss << "], ";
+    }
+    if (mPassthrough) {
+      ss << "passthrough gain " << mPassthroughGain << ", ";
+      if (!mPassthroughMap.empty()) {
+        ss << "passthrough map [";
+        for (size_t i = 0; i < mPassthroughMap.size(); ++i)
+          ss << (i ? "," : "") << mPassthroughMap[i];
+        ss << "], ";
+      }
+    }
+    if (mMixerSources)
+      ss << "mixer sources " << mMixerSources << ", ";
+    if (mScheduled)
+      ss << "scheduled, tolerance " << mScheduleToleranceMs << "ms, ";
     ss << "bits per sample " << mSampleBits << ", ";
-    ss << "max queue " << mMaxQueue << ", ";
+    if (converting()) {
+      ss << "device bits per sample " << mDeviceSampleBits << ", ";
+      ss << "dither " << (mDither ? "true" : "false") << ", ";
+    }
+    if (!mInterleaved)
+      ss << "non-interleaved, ";
+    ss << "ring frames " << ringFrames() << ", ";
+    if (prefillFrames())
+      ss << "prefill frames " << prefillFrames() << ", ";
+    if (lowWaterFrames())
+      ss << "low water frames " << lowWaterFrames() << ", ";
+    ss << "pool size " << mPoolSize << ", ";
+    ss << "zero copy " << (mZeroCopy ? "true" : "false") << ", ";
+    if (mSharedRing)
+      ss << "shared ring true, ";
+    ss << "io thread " << (mIOThread ? "true" : "false") << ", ";
+    if (mBatchFrames)
+      ss << "batch frames " << mBatchFrames << ", ";
+    if (mMaxDeliveryIntervalMs)
+      ss << "max delivery interval " << mMaxDeliveryIntervalMs << "ms, ";
+    if (mFramesPerBuffer)
+      ss << "frames per buffer " << mFramesPerBuffer << ", ";
+    if (mSuggestedLatency > 0.0)
+      ss << "suggested latency " << mSuggestedLatency << "s, ";
+    else
+      ss << mLatencyMode << " latency, ";
+    if (mStreamFlags)
+      ss << "stream flags 0x" << std::hex << mStreamFlags << std::dec << ", ";
     ss << "close on error " << (mCloseOnError ? "true" : "false");
+    if (mTimingStats)
+      ss << ", timing stats true";
+    if (mNullDevice)
+      ss << ", null device speed " << mNullDeviceSpeed;
+    if (mCallbackPriority.compare("default") || !mCallbackCpus.empty())
+      ss << ", callback priority " << mCallbackPriority << cpusString(mCallbackCpus);
+    if (mWorkerPriority.compare("default") || !mWorkerCpus.empty())
+      ss << ", worker priority " << mWorkerPriority << cpusString(mWorkerCpus);
+    if (!mInserts.empty()) {
+      ss << ", inserts [";
+      for (size_t i = 0; i < mInserts.size(); ++i)
+        ss << (i ? ", " : "") << mInserts[i]->toString();
+      ss << "]";
+    }
     return ss.str();
   }
 
 private:
   uint32_t mDeviceID;
   uint32_t mSampleRate;
+  uint32_t mTargetSampleRate;
+  std::string mResampleQuality;
   uint32_t mChannelCount;
   uint32_t mSampleFormat;
   uint32_t mSampleBits;
+  uint32_t mDeviceFormat;
+  uint32_t mDeviceSampleBits;
+  bool mDither;
+  bool mInterleaved;
+  std::vector<int32_t> mChannelMap;
+  bool mPassthrough;
+  double mPassthroughGain;
+  std::vector<int32_t> mPassthroughMap;
+  uint32_t mMixerSources;
+  bool mScheduled;
+  double mScheduleToleranceMs;
   uint32_t mMaxQueue;
+  uint32_t mRingFrames;
+  double mBufferMs;
+  uint32_t mPrefillFrames;
+  double mPrefillMs;
+  uint32_t mLowWaterFrames;
+  double mLowWaterMs;
+  uint32_t mHighwaterMark;
+  uint32_t mPoolSize;
+  bool mZeroCopy;
+  bool mSharedRing;
+  bool mIOThread;
+  uint32_t mBatchFrames;
+  uint32_t mMaxDeliveryIntervalMs;
+  uint32_t mFramesPerBuffer;
+  double mSuggestedLatency;
+  std::string mLatencyMode;
+  uint32_t mStreamFlags;
   bool mCloseOnError;
+  bool mTimingStats;
+  bool mQuiet;
+  bool mNullDevice;
+  double mNullDeviceSpeed;
+  std::string mCallbackPriority;
+  std::string mWorkerPriority;
+  uint32_t mRealtimePriority;
+  std::vector<int32_t> mCallbackCpus;
+  std::vector<int32_t> mWorkerCpus;
+  std::vector<std::shared_ptr<InsertOptions> > mInserts;
+
+  std::vector<std::shared_ptr<InsertOptions> > unpackInserts(Napi::Env env, Napi::Object tags) {
+    std::vector<std::shared_ptr<InsertOptions> > result;
+    Napi::Value val = getKey(env, tags, "inserts");
+    if ((env.Null() != val) && val.IsArray()) {
+      Napi::Array arr = val.As<Napi::Array>();
+      for (uint32_t i = 0; i < arr.Length(); ++i) {
+        Napi::Value el = arr.Get(i);
+        if (!el.IsObject())
+          throw Napi::Error::New(env, "inserts must be an array of objects");
+        result.push_back(std::make_shared<InsertOptions>(env, el.As<Napi::Object>()));
+      }
+    }
+    return result;
+  }
+
+  static std::string cpusString(const std::vector<int32_t> &cpus) {
+    std::stringstream ss;
+    if (!cpus.empty()) {
+      ss << " on cpus [";
+      for (size_t i = 0; i < cpus.size(); ++i)
+        ss << (i ? "," : "") << cpus[i];
+      ss << "]";
+    }
+    return ss.str();
+  }
+
+  uint32_t msToFrames(double ms) const  { return std::max<uint32_t>(1, (uint32_t)(ms * mSampleRate / 1000.0 + 0.5)); }
+};
+
+class BridgeOptions : public Params {
+public:
+  BridgeOptions(Napi::Env env, Napi::Object tags)
+    : mTargetLatencyMs(unpackNum(env, tags, "targetLatencyMs", 20)),
+      mBlockFrames(unpackNum(env, tags, "blockFrames", 256)),
+      mResampleQuality(unpackStr(env, tags, "resampleQuality", "medium"))
+  {}
+  ~BridgeOptions() {}
+
+  // frames held in the output ring that the drift control aims for
+  uint32_t targetLatencyMs() const  { return mTargetLatencyMs; }
+  uint32_t blockFrames() const  { return mBlockFrames; }
+  const std::string &resampleQuality() const  { return mResampleQuality; }
+
+  std::string toString() const  {
+    std::stringstream ss;
+    ss << "bridge options: ";
+    ss << "target latency " << mTargetLatencyMs << "ms, ";
+    ss << "block frames " << mBlockFrames << ", ";
+    ss << "resample quality " << mResampleQuality;
+    return ss.str();
+  }
+
+private:
+  uint32_t mTargetLatencyMs;
+  uint32_t mBlockFrames;
+  std::string mResampleQuality;
+};
+
+class RecordOptions : public Params {
+public:
+  RecordOptions(Napi::Env env, Napi::Object tags)
+    : mPath(unpackStr(env, tags, "path", "")),
+      mFormat(unpackStr(env, tags, "format", "wav")),
+      mDirect(unpackBool(env, tags, "direct", false)),
+      mPreallocateBytes(unpackDouble(env, tags, "preallocateBytes", 0.0)),
+      mWriteBlockBytes(unpackNum(env, tags, "writeBlockBytes", 1048576)),
+      mProgressIntervalMs(unpackNum(env, tags, "progressIntervalMs", 1000))
+  {}
+  ~RecordOptions() {}
+
+  const std::string &path() const  { return mPath; }
+  // 'wav' switches to RF64 if the file grows past 4GB, 'rf64' always writes RF64, or 'caf'
+  const std::string &format() const  { return mFormat; }
+  // bypass the page cache where the platform allows it
+  bool direct() const  { return mDirect; }
+  // space reserved on disk for each file when it is opened
+  uint64_t preallocateBytes() const  { return (uint64_t)mPreallocateBytes; }
+  // size of each write to the file, a whole number of 4096 byte pages
+  uint32_t writeBlockBytes() const  { return std::max<uint32_t>(1, (mWriteBlockBytes + 4095) / 4096) * 4096; }
+  uint32_t progressIntervalMs() const  { return mProgressIntervalMs; }
+
+  std::string toString() const  {
+    std::stringstream ss;
+    ss << "record options: ";
+    ss << "path " << mPath << ", ";
+    ss << "format " << mFormat << ", ";
+    ss << "direct " << (mDirect ? "true" : "false") << ", ";
+    if (mPreallocateBytes > 0.0)
+      ss << "preallocate " << preallocateBytes() << " bytes, ";
+    ss << "write block " << writeBlockBytes() << " bytes, ";
+    ss << "progress interval " << mProgressIntervalMs << "ms";
+    return ss.str();
+  }
+
+private:
+  std::string mPath;
+  std::string mFormat;
+  bool mDirect;
+  double mPreallocateBytes;
+  uint32_t mWriteBlockBytes;
+  uint32_t mProgressIntervalMs;
+};
+
+class PlaybackOptions : public Params {
+public:
+  PlaybackOptions(Napi::Env env, Napi::Object tags)
+    : mPath(unpackStr(env, tags, "path", "")),
+      mStartFrame(unpackDouble(env, tags, "start", 0.0)),
+      mLoop(unpackBool(env, tags, "loop", false)),
+      mLoopStart(unpackDouble(env, tags, "loopStart", 0.0)),
+      mLoopEnd(unpackDouble(env, tags, "loopEnd", 0.0)),
+      mChunkFrames(unpackNum(env, tags, "chunkFrames", 0)),
+      mReadAheadMs(unpackNum(env, tags, "readAheadMs", 1000))
+  {}
+  ~PlaybackOptions() {}
+
+  // a WAV or RF64 file, or raw samples in the stream format
+  const std::string &path() const  { return mPath; }
+  uint64_t startFrame() const  { return (uint64_t)mStartFrame; }
+  bool loop() const  { return mLoop; }
+  uint64_t loopStart() const  { return (uint64_t)mLoopStart; }
+  // zero loops at the end of the file
+  uint64_t loopEnd() const  { return (uint64_t)mLoopEnd; }
+  // frames passed to the output ring at a time, zero for a quarter of the ring
+  uint32_t chunkFrames() const  { return mChunkFrames; }
+  // how far ahead of the play position the file is paged in
+  uint32_t readAheadMs() const  { return mReadAheadMs; }
+
+  std::string toString() const  {
+    std::stringstream ss;
+    ss << "playback options: ";
+    ss << "path " << mPath << ", ";
+    ss << "start frame " << startFrame() << ", ";
+    if (mLoop)
+      ss << "loop " << loopStart() << " to " << loopEnd() << ", ";
+    if (mChunkFrames)
+      ss << "chunk frames " << mChunkFrames << ", ";
+    ss << "read ahead " << mReadAheadMs << "ms";
+    return ss.str();
+  }
+
+private:
+  std::string mPath;
+  double mStartFrame;
+  bool mLoop;
+  double mLoopStart;
+  double mLoopEnd;
+  uint32_t mChunkFrames;
+  uint32_t mReadAheadMs;
+};
+
+class ManagerOptions : public Params {
+public:
+  ManagerOptions(Napi::Env env, Napi::Object tags)
+    : mPollIntervalMs(unpackNum(env, tags, "pollIntervalMs", 2))
+  {}
+  ~ManagerOptions() {}
+
+  // how often waiting reads and writes are checked, and so the longest a completion is held back
+  uint32_t pollIntervalMs() const  { return std::max<uint32_t>(1, mPollIntervalMs); }
+
+  std::string toString() const  {
+    std::stringstream ss;
+    ss << "manager options: ";
+    ss << "poll interval " << pollIntervalMs() << "ms";
+    return ss.str();
+  }
+
+private:
+  uint32_t mPollIntervalMs;
 };
 
 } // namespace streampunk
@@ -0,0 +1,450 @@
+/* Copyright 2019 Streampunk Media Ltd.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#include "Recorder.h"
+#include "PaContext.h"
+#include "Params.h"
+#include <chrono>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <io.h>
+#include <malloc.h>
+#else
+#include <unistd.h>
+#include <stdlib.h>
+#endif
+
+namespace streampunk {
+
+// the header fills the first page so the samples that follow stay page aligned for direct writes
+static const uint32_t sHeaderBytes = 4096;
+static const uint32_t sPageBytes = 4096;
+static const uint64_t sMaxRiffBytes = 0xffffffffULL;
+
+static void *allocAligned(size_t bytes) {
+#ifdef _WIN32
+  return _aligned_malloc(bytes, sPageBytes);
+#else
+  void *buf = nullptr;
+  return posix_memalign(&buf, sPageBytes, bytes) ? nullptr : buf;
+#endif
+}
+
+static void freeAligned(void *buf) {
+#ifdef _WIN32
+  _aligned_free(buf);
+#else
+  free(buf);
+#endif
+}
+
+static bool writeAt(int fd, const uint8_t *buf, uint32_t numBytes, uint64_t offset) {
+  while (numBytes) {
+#ifdef _WIN32
+    if (_lseeki64(fd, (__int64)offset, SEEK_SET) < 0)
+      return false;
+    int written = _write(fd, buf, numBytes);
+#else
+    ssize_t written = pwrite(fd, buf, numBytes, (off_t)offset);
+#endif
+    if (written < 0) {
+      if (EINTR == errno)
+        continue;
+      return false;
+    }
+    buf += written;
+    numBytes -= (uint32_t)written;
+    offset += written;
+  }
+  return true;
+}
+
+static uint8_t *putTag(uint8_t *p, const char *tag) { memcpy(p, tag, 4); return p + 4; }
+static uint8_t *putLE16(uint8_t *p, uint32_t v) { p[0] = v & 0xff; p[1] = (v >> 8) & 0xff; return p + 2; }
+static uint8_t *putLE32(uint8_t *p, uint32_t v) { putLE16(p, v & 0xffff); return putLE16(p + 2, v >> 16); }
+static uint8_t *putLE64(uint8_t *p, uint64_t v) { putLE32(p, (uint32_t)v); return putLE32(p + 4, (uint32_t)(v >> 32)); }
+static uint8_t *putBE32(uint8_t *p, uint32_t v) { p[0] = v >> 24; p[1] = (v >> 16) & 0xff; p[2] = (v >> 8) & 0xff; p[3] = v & 0xff; return p + 4; }
+static uint8_t *putBE16(uint8_t *p, uint32_t v) { p[0] = (v >> 8) & 0xff; p[1] = v & 0xff; return p + 2; }
+static uint8_t *putBE64(uint8_t *p, uint64_t v) { putBE32(p, (uint32_t)(v >> 32)); return putBE32(p + 4, (uint32_t)v); }
+
+// One output file, written in whole blocks from a page aligned buffer
+class AudioFile {
+public:
+  AudioFile(const std::string &path, const RecordOptions &options,
+            uint32_t channels, uint32_t sampleFormat, uint32_t sampleRate)
+    : mPath(path), mFormat(options.format()), mChannels(channels),
+      mFloat(1 == sampleFormat), mSampleBits(1 == sampleFormat ? 32 : sampleFormat),
+      mSampleRate(sampleRate), mDirect(options.direct()), mPreallocateBytes(options.preallocateBytes()),
+      mBlockBytes(options.writeBlockBytes()), mFd(-1),
+      mBlock((uint8_t *)allocAligned(mBlockBytes)), mHeader((uint8_t *)allocAligned(sHeaderBytes)),
+      mBlockFill(0), mDiskBytes(0), mDataBytes(0)
+  {}
+  ~AudioFile() {
+    if (mFd >= 0)
+#ifdef _WIN32
+      _close(mFd);
+#else
+      ::close(mFd);
+#endif
+    freeAligned(mBlock);
+    freeAligned(mHeader);
+  }
+
+  const std::string &path() const { return mPath; }
+  uint64_t dataBytes() const { return mDataBytes; }
+  uint64_t frames() const { return mDataBytes / frameBytes(); }
+  double seconds() const { return (double)frames() / mSampleRate; }
+
+  bool open(std::string &err) {
+    if (!mBlock || !mHeader)
+      return fail(err, "failed to allocate buffers for");
+#ifdef _WIN32
+    // direct writes need different handles on Windows so the page cache is used there
+    mFd = _open(mPath.c_str(), _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+    int flags = O_WRONLY | O_CREAT | O_TRUNC;
+#ifdef O_DIRECT
+    if (mDirect)
+      flags |= O_DIRECT;
+#endif
+    mFd = ::open(mPath.c_str(), flags, 0644);
+#ifdef O_DIRECT
+    if ((mFd < 0) && mDirect && (EINVAL == errno))
+      // the filesystem does not support direct writes
+      mFd = ::open(mPath.c_str(), flags & ~O_DIRECT, 0644);
+#endif
+#endif
+    if (mFd < 0)
+      return fail(err, "failed to open");
+#if defined(__APPLE__)
+    if (mDirect)
+      fcntl(mFd, F_NOCACHE, 1);
+#endif
+#if defined(__linux__)
+    // reserving space is a hint, so filesystems without it just carry on
+    if (mPreallocateBytes && fallocate(mFd, 0, 0, (off_t)mPreallocateBytes))
+      mPreallocateBytes = 0;
+#endif
+    return writeHeader(err);
+  }
+
+  bool write(const uint8_t *buf, uint32_t numBytes, std::string &err) {
+    mDataBytes += numBytes;
+    while (numBytes) {
+      uint32_t bytes = std::min<uint32_t>(numBytes, mBlockBytes - mBlockFill);
+      if ((8 == mSampleBits) && !isCaf()) {
+        // WAV holds 8 bit samples unsigned
+        for (uint32_t i = 0; i < bytes; ++i)
+          mBlock[mBlockFill + i] = buf[i] ^ 0x80;
+      } else
+        memcpy(mBlock + mBlockFill, buf, bytes);
+      mBlockFill += bytes;
+      buf += bytes;
+      numBytes -= bytes;
+      if (mBlockFill == mBlockBytes) {
+        if (!writeAt(mFd, mBlock, mBlockBytes, sHeaderBytes + mDiskBytes))
+          return fail(err, "failed to write");
+        mDiskBytes += mBlockBytes;
+        mBlockFill = 0;
+      }
+    }
+    return true;
+  }
+
+  // describes the samples written to disk so far
+  bool writeHeader(std::string &err) {
+    memset(mHeader, 0, sHeaderBytes);
+    if (isCaf())
+      makeCafHeader(mDiskBytes);
+    else
+      makeWavHeader(mDiskBytes);
+    if (!writeAt(mFd, mHeader, sHeaderBytes, 0))
+      return fail(err, "failed to write header to");
+    return true;
+  }
+
+  bool close(std::string &err) {
+    if (mFd < 0)
+      return true;
+    bool ok = true;
+#ifdef O_DIRECT
+    // direct writes must be whole pages, so the tail is written through the page cache
+    if (mDirect)
+      fcntl(mFd, F_SETFL, fcntl(mFd, F_GETFL) & ~O_DIRECT);
+#endif
+    if (!isCaf() && (mBlockFill & 1) && (mBlockFill < mBlockBytes))
+      // RIFF chunks are padded to an even length
+      mBlock[mBlockFill++] = 0;
+    if (mBlockFill && !writeAt(mFd, mBlock, mBlockFill, sHeaderBytes + mDiskBytes))
+      ok = fail(err, "failed to write");
+    mDiskBytes = mDataBytes;
+    mBlockFill = 0;
+    if (ok)
+      ok = writeHeader(err);
+#ifdef _WIN32
+    int result = _close(mFd);
+#else
+    // drops any reserved space beyond the end of the samples
+    if (ok && mPreallocateBytes && ftruncate(mFd, (off_t)(sHeaderBytes + mDataBytes + (mDataBytes & 1))))
+      ok = fail(err, "failed to truncate");
+    int result = ::close(mFd);
+#endif
+    mFd = -1;
+    if (ok && result)
+      ok = fail(err, "failed to close");
+    return ok;
+  }
+
+private:
+  std::string mPath;
+  std::string mFormat;
+  uint32_t mChannels;
+  bool mFloat;
+  uint32_t mSampleBits;
+  uint32_t mSampleRate;
+  bool mDirect;
+  uint64_t mPreallocateBytes;
+  uint32_t mBlockBytes;
+  int mFd;
+  uint8_t *mBlock;
+  uint8_t *mHeader;
+  uint32_t mBlockFill;
+  uint64_t mDiskBytes;
+  uint64_t mDataBytes;
+
+  bool isCaf() const { return 0 == mFormat.compare("caf"); }
+  uint32_t frameBytes() const { return mChannels * mSampleBits / 8; }
+
+  bool fail(std::string &err, const char *what) {
+    err = std::string(what) + " recording file " + mPath + ": " + strerror(errno);
+    return false;
+  }
+
+  void makeWavHeader(uint64_t dataBytes) {
+    uint64_t riffBytes = sHeaderBytes - 8 + dataBytes + (dataBytes & 1);
+    bool rf64 = (0 == mFormat.compare("rf64")) || (riffBytes > sMaxRiffBytes);
+    bool extensible = (mChannels > 2) || (mSampleBits > 16);
+    uint32_t blockAlign = frameBytes();
+
+    uint8_t *p = putTag(mHeader, rf64 ? "RF64" : "RIFF");
+    p = putLE32(p, rf64 ? 0xffffffff : (uint32_t)riffBytes);
+    p = putTag(p, "WAVE");
+    // space for the RF64 sizes, left as padding while the file is plain RIFF
+    p = putTag(p, rf64 ? "ds64" : "JUNK");
+    p = putLE32(p, 28);
+    if (rf64) {
+      p = putLE64(p, riffBytes);
+      p = putLE64(p, dataBytes);
+      p = putLE64(p, dataBytes / blockAlign);
+      p = putLE32(p, 0);
+    } else
+      p += 28;
+
+    p = putTag(p, "fmt ");
+    p = putLE32(p, extensible ? 40 : (mFloat ? 18 : 16));
+    p = putLE16(p, extensible ? 0xfffe : (mFloat ? 3 : 1));
+    p = putLE16(p, mChannels);
+    p = putLE32(p, mSampleRate);
+    p = putLE32(p, mSampleRate * blockAlign);
+    p = putLE16(p, blockAlign);
+    p = putLE16(p, mSampleBits);
+    if (extensible) {
+      static const uint8_t subFormatTail[14] =
+        { 0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x80, 0x00, 0x00, 0xaa, 0x00, 0x38, 0x9b, 0x71 };
+      p = putLE16(p, 22);
+      p = putLE16(p, mSampleBits);
+      p = putLE32(p, 0);
+      p = putLE16(p, mFloat ? 3 : 1);
+      memcpy(p, subFormatTail, sizeof(subFormatTail));
+      p += sizeof(subFormatTail);
+    } else if (mFloat)
+      p = putLE16(p, 0);
+
+    // pad so that the data chunk header ends the page
+    uint8_t *dataHeader = mHeader + sHeaderBytes - 8;
+    p = putTag(p, "JUNK");
+    putLE32(p, (uint32_t)(dataHeader - p - 4));
+    p = putTag(dataHeader, "data");
+    putLE32(p, rf64 ? 0xffffffff : (uint32_t)dataBytes);
+  }
+
+  void makeCafHeader(uint64_t dataBytes) {
+    union { double d; uint64_t u; } rate;
+    rate.d = mSampleRate;
+
+    uint8_t *p = putTag(mHeader, "caff");
+    p = putBE16(p, 1);
+    p = putBE16(p, 0);
+    p = putTag(p, "desc");
+    p = putBE64(p, 32);
+    p = putBE64(p, rate.u);
+    p = putTag(p, "lpcm");
+    // samples keep the little endian order they arrive in
+    p = putBE32(p, (mFloat ? 1 : 0) | 2);
+    p = putBE32(p, frameBytes());
+    p = putBE32(p, 1);
+    p = putBE32(p, mChannels);
+    p = putBE32(p, mSampleBits);
+
+    // pad so that the data chunk header and its edit count end the page
+    uint8_t *dataHeader = mHeader + sHeaderBytes - 16;
+    p = putTag(p, "free");
+    putBE64(p, (uint64_t)(dataHeader - p - 8));
+    p = putTag(dataHeader, "data");
+    p = putBE64(p, 4 + dataBytes);
+    putBE32(p, 0);
+  }
+
+  AudioFile(const AudioFile &);
+};
+
+Recorder::Recorder(Napi::Env env, std::shared_ptr<PaContext> paContext, Napi::Object options,
+                   const Napi::Function &callback)
+  : mPaContext(paContext), mOptions(std::make_shared<RecordOptions>(env, options)), mRecording(false) {
+  if (!mPaContext->hasInput())
+    throw Napi::Error::New(env, "AudioIO recording requires an input stream");
+  std::shared_ptr<AudioOptions> inOptions = mPaContext->getInOptions();
+  if (!inOptions->interleaved())
+    throw Napi::Error::New(env, "AudioIO recording requires interleaved input");
+  if (mOptions->path().empty())
+    throw Napi::Error::New(env, "AudioIO recording requires a path");
+  const std::string &format = mOptions->format();
+  if (format.compare("wav") && format.compare("rf64") && format.compare("caf"))
+    throw Napi::Error::New(env, "AudioIO recording format must be one of 'wav', 'rf64' or 'caf'");
+
+  std::string err;
+  mFile = makeFile(mOptions->path());
+  if (!mFile->open(err))
+    throw Napi::Error::New(env, err);
+
+  mTsfn = Napi::ThreadSafeFunction::New(env, callback, "AudioRecorder", 0, 1);
+  mRecording = true;
+  mThread = std::thread(&Recorder::run, this);
+}
+
+Recorder::~Recorder() {
+  stop();
+}
+
+void Recorder::rotate(const std::string &path) {
+  std::lock_guard<std::mutex> lk(m);
+  mRotatePath = path;
+}
+
+void Recorder::stop() {
+  if (!mThread.joinable())
+    return;
+  mRecording = false;
+  mThread.join();
+  mTsfn.Release();
+}
+
+// private
+std::shared_ptr<AudioFile> Recorder::makeFile(const std::string &path) const {
+  std::shared_ptr<AudioOptions> inOptions = mPaContext->getInOptions();
+  return std::make_shared<AudioFile>(path, *mOptions, inOptions->channelCount(),
+                                     inOptions->sampleFormat(), inOptions->targetSampleRate());
+}
+
+void Recorder::run() {
+  mPaContext->initWorkerThread("recorder");
+  std::shared_ptr<AudioOptions> inOptions = mPaContext->getInOptions();
+  // a quarter of the ring at a time keeps the callback well clear of a full ring
+  uint32_t pullBytes = std::max<uint32_t>(1, inOptions->ringFrames() / 4) * inOptions->frameBytes();
+  std::chrono::milliseconds interval(mOptions->progressIntervalMs());
+  std::chrono::steady_clock::time_point lastReport = std::chrono::steady_clock::now();
+  std::string err;
+
+  bool finished = false;
+  while (!finished) {
+    // the input already queued is written after a stop
+    bool recording = mRecording;
+    std::shared_ptr<Chunk> chunk = mPaContext->pullInChunk(pullBytes, finished, &mRecording);
+    if (chunk->numBytes() && !mFile->write(chunk->buf(), chunk->numBytes(), err))
+      break;
+    if (!recording)
+      break;
+
+    std::string rotatePath;
+    {
+      std::lock_guard<std::mutex> lk(m);
+      rotatePath.swap(mRotatePath);
+    }
+    if (!rotatePath.empty()) {
+      std::shared_ptr<AudioFile> nextFile = makeFile(rotatePath);
+      if (!nextFile->open(err))
+        break;
+      std::shared_ptr<AudioFile> lastFile = mFile;
+      mFile = nextFile;
+      if (!lastFile->close(err))
+        break;
+      report("rotated", lastFile);
+    }
+
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if (interval.count() && (now - lastReport >= interval)) {
+      if (!mFile->writeHeader(err))
+        break;
+      report("progress", mFile);
+      lastReport = now;
+    }
+  }
+
+  std::string closeErr;
+  if (!mFile->close(closeErr) && err.empty())
+    err = closeErr;
+  if (err.empty())
+    report("stopped", mFile);
+  else
+    report("error", mFile, err);
+  mRecording = false;
+}
+
+void Recorder::report(const char *type, std::shared_ptr<AudioFile> file, const std::string &error) {
+  struct Report {
+    std::string type;
+    std::string path;
+    std::string error;
+    uint64_t frames;
+    uint64_t bytes;
+    double seconds;
+  };
+  Report *r = new Report;
+  r->type = type;
+  r->path = file->path();
+  r->error = error;
+  r->frames = file->frames();
+  r->bytes = file->dataBytes();
+  r->seconds = file->seconds();
+
+  mTsfn.BlockingCall(r, [](Napi::Env env, Napi::Function callback, Report *r) {
+    Napi::HandleScope scope(env);
+    Napi::Object reportVal = Napi::Object::New(env);
+    reportVal.Set(Napi::String::New(env, "type"), Napi::String::New(env, r->type));
+    reportVal.Set(Napi::String::New(env, "path"), Napi::String::New(env, r->path));
+    reportVal.Set(Napi::String::New(env, "frames"), Napi::Number::New(env, (double)r->frames));
+    reportVal.Set(Napi::String::New(env, "bytes"), Napi::Number::New(env, (double)r->bytes));
+    reportVal.Set(Napi::String::New(env, "seconds"), Napi::Number::New(env, r->seconds));
+    if (!r->error.empty())
+      reportVal.Set(Napi::String::New(env, "error"), Napi::String::New(env, r->error));
+    callback.Call({reportVal});
+    delete r;
+  });
+}
+
+} // namespace streampunk
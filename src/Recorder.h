@@ -0,0 +1,67 @@
+/* Copyright 2019 Streampunk Media Ltd.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef RECORDER_H
+#define RECORDER_H
+
+#include <napi.h>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <string>
+
+namespace streampunk {
+
+class PaContext;
+class RecordOptions;
+class AudioFile;
+
+// Writes the input of a stream straight to a WAV, RF64 or CAF file.
+// A writer thread takes the input from the rings, gathers it into large page aligned blocks
+// and writes those to disk, so none of the samples pass through JS. The header is rewritten
+// with each progress report so that a file cut short still plays up to that point.
+class Recorder {
+public:
+  Recorder(Napi::Env env, std::shared_ptr<PaContext> paContext, Napi::Object options,
+           const Napi::Function &callback);
+  ~Recorder();
+
+  bool isRecording() const { return mRecording; }
+
+  // call on the JS thread - the writer switches files between two reads from the input
+  void rotate(const std::string &path);
+  // finishes the current file, blocking until the writer thread has closed it
+  void stop();
+
+private:
+  std::shared_ptr<PaContext> mPaContext;
+  std::shared_ptr<RecordOptions> mOptions;
+  std::shared_ptr<AudioFile> mFile;
+  std::atomic<bool> mRecording;
+  std::mutex m;
+  std::string mRotatePath;
+  Napi::ThreadSafeFunction mTsfn;
+  std::thread mThread;
+
+  std::shared_ptr<AudioFile> makeFile(const std::string &path) const;
+  void run();
+  void report(const char *type, std::shared_ptr<AudioFile> file, const std::string &error = std::string());
+  Recorder(const Recorder &);
+};
+
+} // namespace streampunk
+
+#endif
@@ -0,0 +1,228 @@
+/* Copyright 2019 Streampunk Media Ltd.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#include "Resampler.h"
+#include "SampleConvert.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define RESAMPLER_SSE
+#include <xmmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define RESAMPLER_NEON
+#include <arm_neon.h>
+#endif
+
+namespace streampunk {
+
+const uint32_t Resampler::sPhases;
+const uint32_t Resampler::sBlockFrames;
+
+// taps, passband fraction of the output Nyquist frequency and Kaiser window beta for each quality
+static const struct { uint32_t taps; double rolloff; double beta; } sQualities[] = {
+  { 16, 0.85, 5.0 },
+  { 32, 0.90, 7.0 },
+  { 64, 0.95, 9.0 }
+};
+static const uint32_t sMaxTaps = 512;
+static const double sFixedOne = 4294967296.0;
+
+// taps is always a multiple of 4
+static inline float dotProduct(const float *a, const float *b, uint32_t taps) {
+#if defined(RESAMPLER_SSE)
+  __m128 acc = _mm_setzero_ps();
+  for (uint32_t i = 0; i < taps; i += 4)
+    acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+  acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+  acc = _mm_add_ss(acc, _mm_shuffle_ps(acc, acc, 1));
+  return _mm_cvtss_f32(acc);
+#elif defined(RESAMPLER_NEON)
+  float32x4_t acc = vdupq_n_f32(0.0f);
+  for (uint32_t i = 0; i < taps; i += 4)
+    acc = vmlaq_f32(acc, vld1q_f32(a + i), vld1q_f32(b + i));
+  float32x2_t sum = vadd_f32(vget_low_f32(acc), vget_high_f32(acc));
+  return vget_lane_f32(vpadd_f32(sum, sum), 0);
+#else
+  float acc[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+  for (uint32_t i = 0; i < taps; i += 4)
+    for (uint32_t j = 0; j < 4; ++j)
+      acc[j] += a[i + j] * b[i + j];
+  return (acc[0] + acc[1]) + (acc[2] + acc[3]);
+#endif
+}
+
+// zeroth order modified Bessel function of the first kind, for the Kaiser window
+static double besselI0(double x) {
+  double sum = 1.0;
+  double term = 1.0;
+  for (uint32_t k = 1; k < 50; ++k) {
+    term *= (x / (2.0 * k)) * (x / (2.0 * k));
+    sum += term;
+    if (term < sum * 1e-12)
+      break;
+  }
+  return sum;
+}
+
+Resampler::Resampler(uint32_t channels, double srcRate, double dstRate, eQuality quality)
+  : mChannels(channels),
+    mTaps(std::min<uint32_t>(sMaxTaps, ((uint32_t)std::ceil(sQualities[(uint32_t)quality].taps * std::max(1.0, srcRate / dstRate)) + 3) & ~3u)),
+    mNominalStep((uint64_t)std::llround(srcRate / dstRate * sFixedOne)),
+    mStep(mNominalStep), mPos((uint64_t)(mTaps / 2 - 1) << 32), mFill(mTaps / 2 - 1),
+    mHistory(channels, std::vector<float>(mTaps + sBlockFrames, 0.0f)) {
+  makeFilter(0.5 * std::min(1.0, dstRate / srcRate) * sQualities[(uint32_t)quality].rolloff,
+             sQualities[(uint32_t)quality].beta);
+}
+
+bool Resampler::parseQuality(const std::string &str, eQuality &quality) {
+  if (0 == str.compare("low"))
+    quality = eQuality::LOW;
+  else if (0 == str.compare("medium"))
+    quality = eQuality::MEDIUM;
+  else if (0 == str.compare("high"))
+    quality = eQuality::HIGH;
+  else
+    return false;
+  return true;
+}
+
+uint32_t Resampler::inputFramesFor(uint32_t outFrames) const {
+  if (0 == outFrames)
+    return 0;
+  uint64_t lastFrame = ((mPos + (outFrames - 1) * mStep) >> 32) + mTaps / 2 + 1;
+  return lastFrame > mFill ? (uint32_t)(lastFrame - mFill) : 0;
+}
+
+uint32_t Resampler::outputFramesFor(uint32_t inFrames) const {
+  uint64_t fill = (uint64_t)mFill + inFrames;
+  if (fill <= mTaps / 2)
+    return 0;
+  uint64_t limit = (fill - mTaps / 2) << 32;
+  return mPos < limit ? (uint32_t)((limit - mPos + mStep - 1) / mStep) : 0;
+}
+
+double Resampler::outputOffset() const {
+  return (double)mPos / sFixedOne - mFill;
+}
+
+void Resampler::setRatioAdjust(double adjust) {
+  mStep = (uint64_t)std::llround((double)mNominalStep * adjust);
+}
+
+uint32_t Resampler::process(const float *in, uint32_t inFrames, float *out) {
+  const uint32_t halfTaps = mTaps / 2;
+  uint32_t outFrames = 0;
+  while (inFrames) {
+    // deinterleave a block into the per channel history so that each filter runs over contiguous samples
+    uint32_t numFrames = std::min<uint32_t>(inFrames, sBlockFrames);
+    for (uint32_t c = 0; c < mChannels; ++c) {
+      float *h = mHistory[c].data() + mFill;
+      for (uint32_t f = 0; f < numFrames; ++f)
+        h[f] = in[f * mChannels + c];
+    }
+    mFill += numFrames;
+    in += numFrames * mChannels;
+    inFrames -= numFrames;
+
+    while ((mPos >> 32) + halfTaps < mFill) {
+      uint32_t start = (uint32_t)(mPos >> 32) - halfTaps + 1;
+      uint64_t phasePos = (mPos & 0xffffffff) * sPhases;
+      const float *c0 = mCoeffs.data() + (phasePos >> 32) * mTaps;
+      const float *c1 = c0 + mTaps;
+      float frac = (float)((phasePos & 0xffffffff) / sFixedOne);
+      for (uint32_t c = 0; c < mChannels; ++c) {
+        const float *h = mHistory[c].data() + start;
+        float d0 = dotProduct(h, c0, mTaps);
+        float d1 = dotProduct(h, c1, mTaps);
+        *out++ = d0 + frac * (d1 - d0);
+      }
+      mPos += mStep;
+      ++outFrames;
+    }
+
+    // drop the history before the window of the next output frame
+    uint32_t shift = std::min<uint32_t>(mFill, (uint32_t)(mPos >> 32) - (halfTaps - 1));
+    if (shift) {
+      for (uint32_t c = 0; c < mChannels; ++c)
+        memmove(mHistory[c].data(), mHistory[c].data() + shift, (mFill - shift) * sizeof(float));
+      mFill -= shift;
+      mPos -= (uint64_t)shift << 32;
+    }
+  }
+  return outFrames;
+}
+
+// private
+void Resampler::makeFilter(double cutoff, double beta) {
+  // one row of taps per phase, plus a final row for interpolating beyond the last phase
+  mCoeffs.resize((sPhases + 1) * mTaps);
+  const double halfTaps = mTaps / 2;
+  const double i0Beta = besselI0(beta);
+  for (uint32_t p = 0; p <= sPhases; ++p) {
+    float *row = mCoeffs.data() + p * mTaps;
+    double phase = (double)p / sPhases;
+    double sum = 0.0;
+    for (uint32_t j = 0; j < mTaps; ++j) {
+      double t = (double)j - (halfTaps - 1.0) - phase;
+      double x = 2.0 * cutoff * t;
+      double sinc = (std::fabs(x) < 1e-9) ? 1.0 : std::sin(M_PI * x) / (M_PI * x);
+      double w = t / halfTaps;
+      double window = (std::fabs(w) >= 1.0) ? 0.0 : besselI0(beta * std::sqrt(1.0 - w * w)) / i0Beta;
+      row[j] = (float)(sinc * window);
+      sum += row[j];
+    }
+    // unity gain at DC for every phase
+    for (uint32_t j = 0; j < mTaps; ++j)
+      row[j] = (float)(row[j] / sum);
+  }
+}
+
+ResampleStage::ResampleStage(uint32_t channels, uint32_t srcFormat, uint32_t dstFormat,
+                             double srcRate, double dstRate, Resampler::eQuality quality, bool dither)
+  : mChannels(channels), mResampler(channels, srcRate, dstRate, quality),
+    mDecoder(new SampleConverter(srcFormat, 1, false)),
+    mEncoder(new SampleConverter(1, dstFormat, dither)) {}
+
+ResampleStage::~ResampleStage() {}
+
+uint32_t ResampleStage::process(const uint8_t *src, uint32_t inFrames, uint8_t *dst) {
+  const uint32_t blockFrames = 1024;
+  uint32_t srcFrameBytes = mChannels * mDecoder->srcBytes();
+  uint32_t dstFrameBytes = mChannels * mEncoder->dstBytes();
+  uint32_t outFrames = 0;
+  while (inFrames) {
+    uint32_t numFrames = std::min<uint32_t>(inFrames, blockFrames);
+    uint32_t numOut = mResampler.outputFramesFor(numFrames);
+    // sized on first use, then only grows if the ratio is adjusted upwards
+    if (mSrcFloat.size() < numFrames * mChannels)
+      mSrcFloat.resize(numFrames * mChannels);
+    if (mDstFloat.size() < numOut * mChannels)
+      mDstFloat.resize(numOut * mChannels);
+
+    mDecoder->convert(src, (uint8_t *)mSrcFloat.data(), numFrames * mChannels);
+    numOut = mResampler.process(mSrcFloat.data(), numFrames, mDstFloat.data());
+    mEncoder->convert((const uint8_t *)mDstFloat.data(), dst, numOut * mChannels);
+
+    src += numFrames * srcFrameBytes;
+    dst += numOut * dstFrameBytes;
+    inFrames -= numFrames;
+    outFrames += numOut;
+  }
+  return outFrames;
+}
+
+} // namespace streampunk
@@ -0,0 +1,106 @@
+/* Copyright 2019 Streampunk Media Ltd.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef RESAMPLER_H
+#define RESAMPLER_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace streampunk {
+
+// Polyphase windowed sinc sample rate converter for interleaved float samples.
+// Output positions are tracked in 32.32 fixed point input frames, so the number of
+// frames consumed and produced is exact and can be predicted ahead of processing.
+// Each output frame is interpolated between the two nearest of 256 filter phases.
+// Not thread safe - use one resampler per direction of a stream.
+class Resampler {
+public:
+  enum class eQuality : uint8_t { LOW = 0, MEDIUM = 1, HIGH = 2 };
+
+  Resampler(uint32_t channels, double srcRate, double dstRate, eQuality quality);
+  ~Resampler() {}
+
+  static bool parseQuality(const std::string &str, eQuality &quality);
+
+  uint32_t channels() const  { return mChannels; }
+  uint32_t taps() const  { return mTaps; }
+  // input frames the filter looks ahead of each output frame
+  uint32_t latencyFrames() const  { return mTaps / 2; }
+
+  // input frames required for the next outFrames output frames
+  uint32_t inputFramesFor(uint32_t outFrames) const;
+  // output frames that processing inFrames input frames will produce
+  uint32_t outputFramesFor(uint32_t inFrames) const;
+  // time of the next output frame relative to the next input frame, in input frames
+  double outputOffset() const;
+
+  // scales the conversion ratio by a factor close to 1.0, to follow a drifting clock
+  void setRatioAdjust(double adjust);
+
+  // out must have room for outputFramesFor(inFrames) frames, returns the frames produced
+  uint32_t process(const float *in, uint32_t inFrames, float *out);
+
+private:
+  static const uint32_t sPhases = 256;
+  static const uint32_t sBlockFrames = 1024;
+
+  const uint32_t mChannels;
+  const uint32_t mTaps;
+  const uint64_t mNominalStep;
+  uint64_t mStep;
+  uint64_t mPos;
+  uint32_t mFill;
+  std::vector<float> mCoeffs;
+  std::vector<std::vector<float> > mHistory;
+
+  void makeFilter(double cutoff, double beta);
+  Resampler(const Resampler &);
+};
+
+class SampleConverter;
+
+// Resampler for samples in any of the AudioOptions sample formats, converting through
+// float on the way in and out so that the format conversion and resampling are one pass
+class ResampleStage {
+public:
+  ResampleStage(uint32_t channels, uint32_t srcFormat, uint32_t dstFormat,
+                double srcRate, double dstRate, Resampler::eQuality quality, bool dither);
+  ~ResampleStage();
+
+  uint32_t inputFramesFor(uint32_t outFrames) const  { return mResampler.inputFramesFor(outFrames); }
+  uint32_t outputFramesFor(uint32_t inFrames) const  { return mResampler.outputFramesFor(inFrames); }
+  double outputOffset() const  { return mResampler.outputOffset(); }
+  void setRatioAdjust(double adjust)  { mResampler.setRatioAdjust(adjust); }
+
+  // dst must have room for outputFramesFor(inFrames) frames, returns the frames produced
+  uint32_t process(const uint8_t *src, uint32_t inFrames, uint8_t *dst);
+
+private:
+  const uint32_t mChannels;
+  Resampler mResampler;
+  std::unique_ptr<SampleConverter> mDecoder;
+  std::unique_ptr<SampleConverter> mEncoder;
+  std::vector<float> mSrcFloat;
+  std::vector<float> mDstFloat;
+
+  ResampleStage(const ResampleStage &);
+};
+
+} // namespace streampunk
+
+#endif
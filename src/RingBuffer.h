@@ -0,0 +1,114 @@
+/* Copyright 2019 Streampunk Media Ltd.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef RINGBUFFER_H
+#define RINGBUFFER_H
+
+#include <atomic>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+
+namespace streampunk {
+
+// Wait-free single producer / single consumer ring of elements.
+// One thread may call the producer methods (write, writeAvailable) while another
+// calls the consumer methods (read, peek, skip, readAvailable), neither ever blocks.
+// Positions are free running 32 bit counters, capacity is rounded up to a power of two.
+// The elements and positions may instead live in memory owned by the caller, shared
+// with a consumer or producer outside the addon, which must outlive the ring.
+template <class T>
+class RingBuffer {
+public:
+  RingBuffer(uint32_t capacity)
+    : mCapacity(roundUpPow2(capacity)), mMask(mCapacity - 1), mBuf(mCapacity), mData(mBuf.data()),
+      mWritePosStore(0), mReadPosStore(0), mWritePos(mWritePosStore), mReadPos(mReadPosStore) {}
+  // capacity must already be a power of two
+  RingBuffer(uint32_t capacity, T *data, std::atomic<uint32_t> &writePos, std::atomic<uint32_t> &readPos)
+    : mCapacity(capacity), mMask(mCapacity - 1), mData(data),
+      mWritePosStore(0), mReadPosStore(0), mWritePos(writePos), mReadPos(readPos) {}
+  ~RingBuffer() {}
+
+  uint32_t capacity() const  { return mCapacity; }
+  uint32_t writePos() const  { return mWritePos.load(std::memory_order_acquire); }
+  uint32_t readPos() const  { return mReadPos.load(std::memory_order_acquire); }
+
+  uint32_t readAvailable() const  {
+    return mWritePos.load(std::memory_order_acquire) - mReadPos.load(std::memory_order_relaxed);
+  }
+  uint32_t writeAvailable() const  {
+    return mCapacity - (mWritePos.load(std::memory_order_relaxed) - mReadPos.load(std::memory_order_acquire));
+  }
+
+  uint32_t write(const T *src, uint32_t count) {
+    uint32_t pos = mWritePos.load(std::memory_order_relaxed);
+    count = std::min<uint32_t>(count, mCapacity - (pos - mReadPos.load(std::memory_order_acquire)));
+    uint32_t off = pos & mMask;
+    uint32_t first = std::min<uint32_t>(count, mCapacity - off);
+    std::copy(src, src + first, mData + off);
+    std::copy(src + first, src + count, mData);
+    mWritePos.store(pos + count, std::memory_order_release);
+    return count;
+  }
+
+  uint32_t read(T *dst, uint32_t count) {
+    uint32_t pos = mReadPos.load(std::memory_order_relaxed);
+    count = std::min<uint32_t>(count, mWritePos.load(std::memory_order_acquire) - pos);
+    uint32_t off = pos & mMask;
+    uint32_t first = std::min<uint32_t>(count, mCapacity - off);
+    std::move(mData + off, mData + off + first, dst);
+    std::move(mData, mData + (count - first), dst + first);
+    mReadPos.store(pos + count, std::memory_order_release);
+    return count;
+  }
+
+  bool peek(T &t) const {
+    uint32_t pos = mReadPos.load(std::memory_order_relaxed);
+    if (mWritePos.load(std::memory_order_acquire) == pos)
+      return false;
+    t = mData[pos & mMask];
+    return true;
+  }
+
+  uint32_t skip(uint32_t count) {
+    uint32_t pos = mReadPos.load(std::memory_order_relaxed);
+    count = std::min<uint32_t>(count, mWritePos.load(std::memory_order_acquire) - pos);
+    mReadPos.store(pos + count, std::memory_order_release);
+    return count;
+  }
+
+private:
+  const uint32_t mCapacity;
+  const uint32_t mMask;
+  std::vector<T> mBuf;
+  T *mData;
+  std::atomic<uint32_t> mWritePosStore;
+  std::atomic<uint32_t> mReadPosStore;
+  std::atomic<uint32_t> &mWritePos;
+  std::atomic<uint32_t> &mReadPos;
+
+  static uint32_t roundUpPow2(uint32_t n) {
+    uint32_t p = 1;
+    while (p < n)
+      p <<= 1;
+    return p;
+  }
+
+  RingBuffer(const RingBuffer &);
+};
+
+} // namespace streampunk
+
+#endif
@@ -0,0 +1,317 @@
+/* Copyright 2019 Streampunk Media Ltd.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#include "SampleConvert.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define SAMPLECONVERT_SSE2
+#include <emmintrin.h>
+#ifdef __SSSE3__
+#include <tmmintrin.h>
+#endif
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define SAMPLECONVERT_NEON
+#include <arm_neon.h>
+#endif
+
+namespace streampunk {
+
+// Integer full scale for each format, samples are normalised to [-1.0, 1.0)
+static const float sScale8 = 128.0f;
+static const float sScale16 = 32768.0f;
+static const float sScale24 = 8388608.0f;
+static const float sScale32 = 2147483648.0f;
+// largest float below 2^31, anything above overflows the conversion to int32
+static const float sMax32 = 2147483520.0f;
+
+// 24 bit samples are packed little endian - widen to the top of an int32
+static inline int32_t loadInt24(const uint8_t *p) {
+  return (int32_t)(((uint32_t)p[0] << 8) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 24));
+}
+
+static inline void storeInt24(uint8_t *p, int32_t v) {
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+  p[2] = (uint8_t)(v >> 16);
+}
+
+static inline int32_t clampRound(float f, float lo, float hi) {
+  return (int32_t)lrintf(std::min(std::max(f, lo), hi));
+}
+
+#ifdef SAMPLECONVERT_NEON
+static inline int32x4_t neonRound(float32x4_t f) {
+#ifdef __aarch64__
+  return vcvtnq_s32_f32(f);
+#else
+  // round half away from zero, vcvtq truncates
+  uint32x4_t sign = vandq_u32(vreinterpretq_u32_f32(f), vdupq_n_u32(0x80000000));
+  float32x4_t half = vreinterpretq_f32_u32(vorrq_u32(vreinterpretq_u32_f32(vdupq_n_f32(0.5f)), sign));
+  return vcvtq_s32_f32(vaddq_f32(f, half));
+#endif
+}
+#endif
+
+// decode - source format to normalised float
+
+static void decodeInt8(const uint8_t *src, float *dst, uint32_t n) {
+  const int8_t *s = (const int8_t *)src;
+  for (uint32_t i = 0; i < n; ++i)
+    dst[i] = s[i] * (1.0f / sScale8);
+}
+
+static void decodeInt16(const uint8_t *src, float *dst, uint32_t n) {
+  const int16_t *s = (const int16_t *)src;
+  uint32_t i = 0;
+#if defined(SAMPLECONVERT_SSE2)
+  const __m128 scale = _mm_set1_ps(1.0f / sScale16);
+  for (; i + 8 <= n; i += 8) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(s + i));
+    // interleave into the top half of each int32 then shift down to sign extend
+    __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+    __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+    _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+    _mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+  }
+#elif defined(SAMPLECONVERT_NEON)
+  const float32x4_t scale = vdupq_n_f32(1.0f / sScale16);
+  for (; i + 8 <= n; i += 8) {
+    int16x8_t v = vld1q_s16(s + i);
+    vst1q_f32(dst + i, vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(v))), scale));
+    vst1q_f32(dst + i + 4, vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(v))), scale));
+  }
+#endif
+  for (; i < n; ++i)
+    dst[i] = s[i] * (1.0f / sScale16);
+}
+
+static void decodeInt24(const uint8_t *src, float *dst, uint32_t n) {
+  uint32_t i = 0;
+#if defined(SAMPLECONVERT_SSE2) && defined(__SSSE3__)
+  const __m128 scale = _mm_set1_ps(1.0f / sScale32);
+  const __m128i shuffle = _mm_setr_epi8(-1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11);
+  // each load reads 16 bytes for 4 samples, stop while there are still 16 to read
+  for (; i + 6 <= n; i += 4) {
+    __m128i v = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(src + i * 3)), shuffle);
+    _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(v), scale));
+  }
+#elif defined(SAMPLECONVERT_SSE2)
+  const __m128 scale = _mm_set1_ps(1.0f / sScale32);
+  for (; i + 4 <= n; i += 4) {
+    const uint8_t *p = src + i * 3;
+    __m128i v = _mm_setr_epi32(loadInt24(p), loadInt24(p + 3), loadInt24(p + 6), loadInt24(p + 9));
+    _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(v), scale));
+  }
+#elif defined(SAMPLECONVERT_NEON)
+  const float32x4_t scale = vdupq_n_f32(1.0f / sScale32);
+  for (; i + 8 <= n; i += 8) {
+    // de-interleave the three bytes of 8 samples, then zip the halves together at the top of each lane
+    uint8x8x3_t b = vld3_u8(src + i * 3);
+    uint16x8_t lo = vshll_n_u8(b.val[0], 8);
+    uint16x8_t hi = vorrq_u16(vmovl_u8(b.val[1]), vshll_n_u8(b.val[2], 8));
+    uint16x8x2_t z = vzipq_u16(lo, hi);
+    vst1q_f32(dst + i, vmulq_f32(vcvtq_f32_s32(vreinterpretq_s32_u16(z.val[0])), scale));
+    vst1q_f32(dst + i + 4, vmulq_f32(vcvtq_f32_s32(vreinterpretq_s32_u16(z.val[1])), scale));
+  }
+#endif
+  for (; i < n; ++i)
+    dst[i] = loadInt24(src + i * 3) * (1.0f / sScale32);
+}
+
+static void decodeInt32(const uint8_t *src, float *dst, uint32_t n) {
+  const int32_t *s = (const int32_t *)src;
+  uint32_t i = 0;
+#if defined(SAMPLECONVERT_SSE2)
+  const __m128 scale = _mm_set1_ps(1.0f / sScale32);
+  for (; i + 4 <= n; i += 4)
+    _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(_mm_loadu_si128((const __m128i *)(s + i))), scale));
+#elif defined(SAMPLECONVERT_NEON)
+  const float32x4_t scale = vdupq_n_f32(1.0f / sScale32);
+  for (; i + 4 <= n; i += 4)
+    vst1q_f32(dst + i, vmulq_f32(vcvtq_f32_s32(vld1q_s32(s + i)), scale));
+#endif
+  for (; i < n; ++i)
+    dst[i] = s[i] * (1.0f / sScale32);
+}
+
+// encode - normalised float to destination format
+// noise, when present, is in units of the destination LSB and is added before rounding
+
+static void encodeInt8(const float *src, const float *noise, uint8_t *dst, uint32_t n) {
+  int8_t *d = (int8_t *)dst;
+  for (uint32_t i = 0; i < n; ++i)
+    d[i] = (int8_t)clampRound(src[i] * sScale8 + (noise ? noise[i] : 0.0f), -sScale8, sScale8 - 1.0f);
+}
+
+static void encodeInt16(const float *src, const float *noise, uint8_t *dst, uint32_t n) {
+  int16_t *d = (int16_t *)dst;
+  uint32_t i = 0;
+#if defined(SAMPLECONVERT_SSE2)
+  const __m128 scale = _mm_set1_ps(sScale16);
+  const __m128 zero = _mm_setzero_ps();
+  for (; i + 8 <= n; i += 8) {
+    __m128 lo = _mm_mul_ps(_mm_loadu_ps(src + i), scale);
+    __m128 hi = _mm_mul_ps(_mm_loadu_ps(src + i + 4), scale);
+    lo = _mm_add_ps(lo, noise ? _mm_loadu_ps(noise + i) : zero);
+    hi = _mm_add_ps(hi, noise ? _mm_loadu_ps(noise + i + 4) : zero);
+    // the pack saturates to the int16 range
+    _mm_storeu_si128((__m128i *)(d + i), _mm_packs_epi32(_mm_cvtps_epi32(lo), _mm_cvtps_epi32(hi)));
+  }
+#elif defined(SAMPLECONVERT_NEON)
+  const float32x4_t scale = vdupq_n_f32(sScale16);
+  const float32x4_t zero = vdupq_n_f32(0.0f);
+  for (; i + 8 <= n; i += 8) {
+    float32x4_t lo = vmulq_f32(vld1q_f32(src + i), scale);
+    float32x4_t hi = vmulq_f32(vld1q_f32(src + i + 4), scale);
+    lo = vaddq_f32(lo, noise ? vld1q_f32(noise + i) : zero);
+    hi = vaddq_f32(hi, noise ? vld1q_f32(noise + i + 4) : zero);
+    vst1q_s16(d + i, vcombine_s16(vqmovn_s32(neonRound(lo)), vqmovn_s32(neonRound(hi))));
+  }
+#endif
+  for (; i < n; ++i)
+    d[i] = (int16_t)clampRound(src[i] * sScale16 + (noise ? noise[i] : 0.0f), -sScale16, sScale16 - 1.0f);
+}
+
+static void encodeInt32(const float *src, const float *noise, uint8_t *dst, uint32_t n) {
+  int32_t *d = (int32_t *)dst;
+  uint32_t i = 0;
+#if defined(SAMPLECONVERT_SSE2)
+  const __m128 scale = _mm_set1_ps(sScale32);
+  const __m128 lo = _mm_set1_ps(-sScale32);
+  const __m128 hi = _mm_set1_ps(sMax32);
+  const __m128 zero = _mm_setzero_ps();
+  for (; i + 4 <= n; i += 4) {
+    __m128 v = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(src + i), scale), noise ? _mm_loadu_ps(noise + i) : zero);
+    v = _mm_min_ps(_mm_max_ps(v, lo), hi);
+    _mm_storeu_si128((__m128i *)(d + i), _mm_cvtps_epi32(v));
+  }
+#elif defined(SAMPLECONVERT_NEON)
+  const float32x4_t scale = vdupq_n_f32(sScale32);
+  const float32x4_t lo = vdupq_n_f32(-sScale32);
+  const float32x4_t hi = vdupq_n_f32(sMax32);
+  const float32x4_t zero = vdupq_n_f32(0.0f);
+  for (; i + 4 <= n; i += 4) {
+    float32x4_t v = vaddq_f32(vmulq_f32(vld1q_f32(src + i), scale), noise ? vld1q_f32(noise + i) : zero);
+    vst1q_s32(d + i, neonRound(vminq_f32(vmaxq_f32(v, lo), hi)));
+  }
+#endif
+  for (; i < n; ++i)
+    d[i] = clampRound(src[i] * sScale32 + (noise ? noise[i] : 0.0f), -sScale32, sMax32);
+}
+
+static void encodeInt24(const float *src, const float *noise, uint8_t *dst, uint32_t n) {
+  // round in the vector unit a block at a time, then pack down to three bytes
+  int32_t tmp[256];
+  for (uint32_t i = 0; i < n; i += 256) {
+    uint32_t count = std::min<uint32_t>(256, n - i);
+    uint32_t j = 0;
+#if defined(SAMPLECONVERT_SSE2)
+    const __m128 scale = _mm_set1_ps(sScale24);
+    const __m128 lo = _mm_set1_ps(-sScale24);
+    const __m128 hi = _mm_set1_ps(sScale24 - 1.0f);
+    const __m128 zero = _mm_setzero_ps();
+    for (; j + 4 <= count; j += 4) {
+      __m128 v = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(src + i + j), scale), noise ? _mm_loadu_ps(noise + i + j) : zero);
+      _mm_storeu_si128((__m128i *)(tmp + j), _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(v, lo), hi)));
+    }
+#elif defined(SAMPLECONVERT_NEON)
+    const float32x4_t scale = vdupq_n_f32(sScale24);
+    const float32x4_t lo = vdupq_n_f32(-sScale24);
+    const float32x4_t hi = vdupq_n_f32(sScale24 - 1.0f);
+    const float32x4_t zero = vdupq_n_f32(0.0f);
+    for (; j + 4 <= count; j += 4) {
+      float32x4_t v = vaddq_f32(vmulq_f32(vld1q_f32(src + i + j), scale), noise ? vld1q_f32(noise + i + j) : zero);
+      vst1q_s32(tmp + j, neonRound(vminq_f32(vmaxq_f32(v, lo), hi)));
+    }
+#endif
+    for (; j < count; ++j)
+      tmp[j] = clampRound(src[i + j] * sScale24 + (noise ? noise[i + j] : 0.0f), -sScale24, sScale24 - 1.0f);
+    for (j = 0; j < count; ++j)
+      storeInt24(dst + (i + j) * 3, tmp[j]);
+  }
+}
+
+static void decode(uint32_t format, const uint8_t *src, float *dst, uint32_t n) {
+  switch (format) {
+  case 1: memcpy(dst, src, n * sizeof(float)); break;
+  case 8: decodeInt8(src, dst, n); break;
+  case 16: decodeInt16(src, dst, n); break;
+  case 24: decodeInt24(src, dst, n); break;
+  case 32: decodeInt32(src, dst, n); break;
+  }
+}
+
+static void encode(uint32_t format, const float *src, const float *noise, uint8_t *dst, uint32_t n) {
+  switch (format) {
+  case 1: memcpy(dst, src, n * sizeof(float)); break;
+  case 8: encodeInt8(src, noise, dst, n); break;
+  case 16: encodeInt16(src, noise, dst, n); break;
+  case 24: encodeInt24(src, noise, dst, n); break;
+  case 32: encodeInt32(src, noise, dst, n); break;
+  }
+}
+
+// float carries 24 bits of precision, treat it as the widest format for deciding when to dither
+static uint32_t formatBits(uint32_t format) {
+  return 1 == format ? 32 : format;
+}
+
+const uint32_t SampleConverter::sBlockSamples;
+
+SampleConverter::SampleConverter(uint32_t srcFormat, uint32_t dstFormat, bool dither)
+  : mSrcFormat(srcFormat), mDstFormat(dstFormat),
+    mDither(dither && (1 != dstFormat) && (formatBits(dstFormat) < formatBits(srcFormat))),
+    mSeed(0x9e3779b9) {}
+
+bool SampleConverter::isValidFormat(uint32_t format) {
+  return (1 == format) || (8 == format) || (16 == format) || (24 == format) || (32 == format);
+}
+
+void SampleConverter::convert(const uint8_t *src, uint8_t *dst, uint32_t numSamples) {
+  if (mSrcFormat == mDstFormat) {
+    memcpy(dst, src, numSamples * srcBytes());
+    return;
+  }
+
+  uint32_t srcStep = srcBytes();
+  uint32_t dstStep = dstBytes();
+  for (uint32_t i = 0; i < numSamples; i += sBlockSamples) {
+    uint32_t count = std::min<uint32_t>(sBlockSamples, numSamples - i);
+    decode(mSrcFormat, src + i * srcStep, mScratch, count);
+    if (mDither)
+      fillNoise(count);
+    encode(mDstFormat, mScratch, mDither ? mNoise : nullptr, dst + i * dstStep, count);
+  }
+}
+
+// private
+void SampleConverter::fillNoise(uint32_t numSamples) {
+  // triangular PDF spanning +/- 1 LSB, the sum of two uniform values from a xorshift generator
+  const float norm = 1.0f / 4294967296.0f;
+  uint32_t x = mSeed;
+  for (uint32_t i = 0; i < numSamples; ++i) {
+    x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+    float r1 = x * norm;
+    x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+    float r2 = x * norm;
+    mNoise[i] = r1 + r2 - 1.0f;
+  }
+  mSeed = x;
+}
+
+} // namespace streampunk
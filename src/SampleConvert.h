@@ -0,0 +1,59 @@
+/* Copyright 2019 Streampunk Media Ltd.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef SAMPLECONVERT_H
+#define SAMPLECONVERT_H
+
+#include <cstdint>
+
+namespace streampunk {
+
+// Converts interleaved samples between the sampleFormat codes used in AudioOptions
+// (1 - float32, 8/16/24/32 - signed integer, 24 bit packed) by way of normalised float.
+// Uses SSE2 or NEON where the build target has them, with optional TPDF dither
+// whenever the destination has fewer bits than the source.
+// Not thread safe - each converter keeps its own scratch space and dither state.
+class SampleConverter {
+public:
+  SampleConverter(uint32_t srcFormat, uint32_t dstFormat, bool dither);
+  ~SampleConverter() {}
+
+  static bool isValidFormat(uint32_t format);
+  static uint32_t formatBytes(uint32_t format) { return 1 == format ? 4 : format / 8; }
+
+  uint32_t srcBytes() const  { return formatBytes(mSrcFormat); }
+  uint32_t dstBytes() const  { return formatBytes(mDstFormat); }
+  bool dithering() const  { return mDither; }
+
+  // converts numSamples samples, src and dst must not overlap
+  void convert(const uint8_t *src, uint8_t *dst, uint32_t numSamples);
+
+private:
+  static const uint32_t sBlockSamples = 1024;
+
+  const uint32_t mSrcFormat;
+  const uint32_t mDstFormat;
+  const bool mDither;
+  uint32_t mSeed;
+  float mScratch[sBlockSamples];
+  float mNoise[sBlockSamples];
+
+  void fillNoise(uint32_t numSamples);
+  SampleConverter(const SampleConverter &);
+};
+
+} // namespace streampunk
+
+#endif
@@ -0,0 +1,85 @@
+/* Copyright 2019 Streampunk Media Ltd.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef SHAREDRING_H
+#define SHAREDRING_H
+
+#include "RingBuffer.h"
+#include <atomic>
+#include <memory>
+#include <new>
+#include <cstdint>
+
+#if ATOMIC_INT_LOCK_FREE != 2
+#error "A shared ring needs lock-free 32 bit atomics"
+#endif
+
+namespace streampunk {
+
+// Layout of a byte ring kept in a SharedArrayBuffer, so that a JS worker can read or write
+// it directly with Atomics on an Int32Array over the header. The positions sit in their own
+// cache lines, ahead of a description of the samples and then the ring itself.
+class SharedRing {
+public:
+  enum eHeader {
+    WRITE_POS = 0,      // free running byte count written, producer only
+    READ_POS = 16,      // free running byte count read, consumer only
+    CAPACITY = 32,      // bytes in the ring, a power of two
+    FRAME_BYTES = 33,   // bytes in each interleaved frame
+    CHANNELS = 34,
+    SAMPLE_FORMAT = 35, // as the sampleFormat option
+    SAMPLE_RATE = 36,
+    ACTIVE = 37,        // 1 while the device is running
+    HEADER_WORDS = 64
+  };
+
+  static uint32_t headerBytes()  { return HEADER_WORDS * sizeof(int32_t); }
+
+  static uint32_t capacityFor(uint32_t bytes) {
+    uint32_t p = 1;
+    while (p < bytes)
+      p <<= 1;
+    return p;
+  }
+
+  static uint32_t bytesFor(uint32_t ringBytes)  { return headerBytes() + capacityFor(ringBytes); }
+
+  // sets out the header in zeroed memory of bytesFor(ringBytes) and returns a ring over it
+  static std::shared_ptr<RingBuffer<uint8_t> > make(uint8_t *mem, uint32_t ringBytes, uint32_t frameBytes,
+      uint32_t channels, uint32_t sampleFormat, uint32_t sampleRate) {
+    static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "atomic positions must match an Int32Array element");
+    uint32_t capacity = capacityFor(ringBytes);
+    std::atomic<uint32_t> *writePos = new (word(mem, WRITE_POS)) std::atomic<uint32_t>(0);
+    std::atomic<uint32_t> *readPos = new (word(mem, READ_POS)) std::atomic<uint32_t>(0);
+    *word(mem, CAPACITY) = capacity;
+    *word(mem, FRAME_BYTES) = frameBytes;
+    *word(mem, CHANNELS) = channels;
+    *word(mem, SAMPLE_FORMAT) = sampleFormat;
+    *word(mem, SAMPLE_RATE) = sampleRate;
+    new (word(mem, ACTIVE)) std::atomic<uint32_t>(0);
+    return std::make_shared<RingBuffer<uint8_t> >(capacity, mem + headerBytes(), *writePos, *readPos);
+  }
+
+  static void setActive(uint8_t *mem, bool active) {
+    reinterpret_cast<std::atomic<uint32_t> *>(word(mem, ACTIVE))->store(active ? 1 : 0, std::memory_order_release);
+  }
+
+private:
+  static uint32_t *word(uint8_t *mem, uint32_t index)  { return reinterpret_cast<uint32_t *>(mem) + index; }
+};
+
+} // namespace streampunk
+
+#endif
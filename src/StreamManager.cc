@@ -0,0 +1,111 @@
+/* Copyright 2019 Streampunk Media Ltd.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#include "StreamManager.h"
+#include "IOPump.h"
+
+namespace streampunk {
+
+StreamManager::StreamManager(Napi::Env env, uint32_t pollIntervalMs)
+  : mPollInterval(pollIntervalMs), mActive(true), mPending(std::make_shared<uint32_t>(0)),
+    mStreams(0), mWaiting(0), mJobs(0), mDeliveries(0) {
+  Napi::Function noop = Napi::Function::New(env, [](const Napi::CallbackInfo&) {});
+  mTsfn = Napi::ThreadSafeFunction::New(env, noop, "AudioStreamManager", 0, 1);
+  // only keep the event loop alive while there is work outstanding
+  mTsfn.Unref(env);
+  mThread = std::thread(&StreamManager::run, this);
+}
+
+StreamManager::~StreamManager() {
+  quit();
+}
+
+bool StreamManager::queue(Napi::Env env, PumpJob *job) {
+  std::lock_guard<std::mutex> lk(m);
+  if (!mActive)
+    return false;
+  if (0 == (*mPending)++)
+    mTsfn.Ref(env);
+  mIncoming.push_back(job);
+  mCv.notify_one();
+  return true;
+}
+
+void StreamManager::quit() {
+  {
+    std::lock_guard<std::mutex> lk(m);
+    mActive = false;
+    mCv.notify_one();
+  }
+  if (mThread.joinable())
+    mThread.join();
+}
+
+void StreamManager::run() {
+  Napi::ThreadSafeFunction tsfn = mTsfn;
+  std::shared_ptr<uint32_t> pending = mPending;
+  std::vector<PumpJob *> waiting;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lk(m);
+      if (mIncoming.empty()) {
+        // the callbacks do not signal the manager, so jobs that are waiting are polled
+        if (waiting.empty()) {
+          if (!mActive)
+            break;
+          mCv.wait(lk);
+        } else
+          mCv.wait_for(lk, mPollInterval);
+      }
+      waiting.insert(waiting.end(), mIncoming.begin(), mIncoming.end());
+      mIncoming.clear();
+    }
+
+    std::vector<PumpJob *> *done = new std::vector<PumpJob *>;
+    for (auto it = waiting.begin(); it != waiting.end(); ) {
+      if ((*it)->ready()) {
+        (*it)->Execute();
+        if ((*it)->done()) {
+          done->push_back(*it);
+          it = waiting.erase(it);
+        } else
+          ++it;
+      } else
+        ++it;
+    }
+    mWaiting = (uint32_t)waiting.size();
+    if (done->empty()) {
+      delete done;
+      continue;
+    }
+
+    mJobs += done->size();
+    ++mDeliveries;
+    tsfn.BlockingCall(done, [tsfn, pending](Napi::Env env, Napi::Function, std::vector<PumpJob *> *done) {
+      Napi::HandleScope scope(env);
+      for (auto job : *done) {
+        job->OnOK(env);
+        delete job;
+      }
+      *pending -= (uint32_t)done->size();
+      if (0 == *pending)
+        tsfn.Unref(env);
+      delete done;
+    });
+  }
+  tsfn.Release();
+}
+
+} // namespace streampunk
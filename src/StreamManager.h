@@ -0,0 +1,75 @@
+/* Copyright 2019 Streampunk Media Ltd.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef STREAMMANAGER_H
+#define STREAMMANAGER_H
+
+#include <napi.h>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+namespace streampunk {
+
+class PumpJob;
+
+// Runs the reads and writes of many streams on one thread in place of a threadpool worker
+// or IOPump per stream. Jobs wait in a list until they say they are ready, so no job ever
+// blocks the others, then they run and all the jobs completed in one pass are delivered to
+// JS together through a single thread-safe function.
+class StreamManager {
+public:
+  StreamManager(Napi::Env env, uint32_t pollIntervalMs);
+  ~StreamManager();
+
+  // call on the JS thread
+  void attach() { ++mStreams; }
+  void detach() { --mStreams; }
+  // takes ownership of the job, or returns false once the manager has quit
+  bool queue(Napi::Env env, PumpJob *job);
+  // returns once every job already queued has been delivered, which needs its stream to finish or quit
+  void quit();
+
+  uint32_t numStreams() const { return mStreams; }
+  uint32_t numWaiting() const { return mWaiting; }
+  uint64_t numJobs() const { return mJobs; }
+  uint64_t numDeliveries() const { return mDeliveries; }
+
+private:
+  const std::chrono::milliseconds mPollInterval;
+  std::mutex m;
+  std::condition_variable mCv;
+  std::vector<PumpJob *> mIncoming;
+  bool mActive;
+  Napi::ThreadSafeFunction mTsfn;
+  // only touched on the JS thread, shared so that completions can outlive the manager
+  std::shared_ptr<uint32_t> mPending;
+  std::atomic<uint32_t> mStreams;
+  std::atomic<uint32_t> mWaiting;
+  std::atomic<uint64_t> mJobs;
+  std::atomic<uint64_t> mDeliveries;
+  std::thread mThread;
+
+  void run();
+  StreamManager(const StreamManager &);
+};
+
+} // namespace streampunk
+
+#endif
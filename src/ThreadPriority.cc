@@ -0,0 +1,186 @@
+/* Copyright 2019 Streampunk Media Ltd.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#include "ThreadPriority.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#ifdef _WIN32
+#include <windows.h>
+#include <avrt.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#endif
+#ifdef __linux__
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#ifdef __APPLE__
+#include <mach/mach.h>
+#include <mach/mach_time.h>
+#include <mach/thread_policy.h>
+#endif
+
+namespace streampunk {
+
+// nice value given to high priority threads on Linux
+static const int sHighNice = -10;
+
+ThreadPriority::ThreadPriority(ePriority priority, int32_t realtimeLevel, const std::vector<int32_t> &cpus, double periodSecs)
+  : mPriority(priority), mRealtimeLevel(realtimeLevel), mCpus(cpus), mPeriodSecs(periodSecs) {}
+
+bool ThreadPriority::parsePriority(const std::string &str, ePriority &priority) {
+  if (0 == str.compare("default"))
+    priority = ePriority::DEFAULT;
+  else if (0 == str.compare("high"))
+    priority = ePriority::HIGH;
+  else if (0 == str.compare("realtime"))
+    priority = ePriority::REALTIME;
+  else
+    return false;
+  return true;
+}
+
+const char *ThreadPriority::priorityName(ePriority priority) {
+  switch (priority) {
+  case ePriority::HIGH: return "high";
+  case ePriority::REALTIME: return "realtime";
+  default: return "default";
+  }
+}
+
+std::string ThreadPriority::errorString(int32_t error) {
+#ifdef _WIN32
+  char buf[256];
+  DWORD len = FormatMessageA(FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_IGNORE_INSERTS, NULL, (DWORD)error,
+                             0, buf, sizeof(buf), NULL);
+  while (len && ((buf[len - 1] == '\n') || (buf[len - 1] == '\r')))
+    --len;
+  return std::string(buf, len);
+#elif defined(__APPLE__)
+  // thread policy calls return mach kern_return_t codes, pthread calls errno values
+  return error > 0 && error < ELAST ? strerror(error) : mach_error_string(error);
+#else
+  return strerror(error);
+#endif
+}
+
+void ThreadPriority::apply(Report &report) const {
+  report = { ePriority::DEFAULT, 0, 0, 0 };
+
+#if defined(__linux__)
+  pid_t tid = (pid_t)syscall(SYS_gettid);
+  if (ePriority::REALTIME == mPriority) {
+    sched_param param;
+    param.sched_priority = std::max(sched_get_priority_min(SCHED_FIFO),
+                                    std::min<int>(mRealtimeLevel, sched_get_priority_max(SCHED_FIFO)));
+    report.error = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+  } else if ((ePriority::HIGH == mPriority) && setpriority(PRIO_PROCESS, (id_t)tid, sHighNice))
+    report.error = errno;
+
+  if (!mCpus.empty()) {
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    for (int32_t cpu : mCpus)
+      if ((cpu >= 0) && (cpu < CPU_SETSIZE))
+        CPU_SET(cpu, &cpus);
+    int err = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+    if (err && !report.error)
+      report.error = err;
+  }
+
+  int policy;
+  sched_param param;
+  if (0 == pthread_getschedparam(pthread_self(), &policy, &param) && ((SCHED_FIFO == policy) || (SCHED_RR == policy))) {
+    report.priority = ePriority::REALTIME;
+    report.level = param.sched_priority;
+  } else {
+    errno = 0;
+    int nice = getpriority(PRIO_PROCESS, (id_t)tid);
+    report.level = errno ? 0 : nice;
+    report.priority = report.level < 0 ? ePriority::HIGH : ePriority::DEFAULT;
+  }
+  cpu_set_t cpus;
+  CPU_ZERO(&cpus);
+  if (0 == pthread_getaffinity_np(pthread_self(), sizeof(cpus), &cpus))
+    for (int cpu = 0; cpu < 64; ++cpu)
+      if (CPU_ISSET(cpu, &cpus))
+        report.cpuMask |= (uint64_t)1 << cpu;
+
+#elif defined(__APPLE__)
+  if (ePriority::REALTIME == mPriority) {
+    mach_timebase_info_data_t timebase;
+    mach_timebase_info(&timebase);
+    uint32_t periodTicks = (uint32_t)(mPeriodSecs * 1e9 * timebase.denom / timebase.numer);
+    thread_time_constraint_policy_data_t policy;
+    policy.period = periodTicks;
+    policy.computation = periodTicks / 2;
+    policy.constraint = periodTicks;
+    policy.preemptible = 1;
+    kern_return_t kr = thread_policy_set(pthread_mach_thread_np(pthread_self()), THREAD_TIME_CONSTRAINT_POLICY,
+                                         (thread_policy_t)&policy, THREAD_TIME_CONSTRAINT_POLICY_COUNT);
+    if (KERN_SUCCESS == kr)
+      report.priority = ePriority::REALTIME;
+    else
+      report.error = kr;
+  } else if (ePriority::HIGH == mPriority) {
+    int err = pthread_set_qos_class_self_np(QOS_CLASS_USER_INTERACTIVE, 0);
+    if (0 == err)
+      report.priority = ePriority::HIGH;
+    else
+      report.error = err;
+  }
+  // macOS has no way to pin a thread to a core
+  if (!mCpus.empty() && !report.error)
+    report.error = ENOTSUP;
+
+  int policy;
+  sched_param param;
+  if (0 == pthread_getschedparam(pthread_self(), &policy, &param))
+    report.level = param.sched_priority;
+
+#elif defined(_WIN32)
+  if (ePriority::REALTIME == mPriority) {
+    // the MMCSS task is left in place until the thread exits
+    DWORD taskIndex = 0;
+    HANDLE task = AvSetMmThreadCharacteristicsW(L"Pro Audio", &taskIndex);
+    if (task && AvSetMmThreadPriority(task, AVRT_PRIORITY_CRITICAL))
+      report.priority = ePriority::REALTIME;
+    else
+      report.error = (int32_t)GetLastError();
+  } else if (ePriority::HIGH == mPriority) {
+    if (SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_HIGHEST))
+      report.priority = ePriority::HIGH;
+    else
+      report.error = (int32_t)GetLastError();
+  }
+
+  if (!mCpus.empty()) {
+    DWORD_PTR mask = 0;
+    for (int32_t cpu : mCpus)
+      if ((cpu >= 0) && (cpu < (int32_t)(8 * sizeof(DWORD_PTR))))
+        mask |= (DWORD_PTR)1 << cpu;
+    if (SetThreadAffinityMask(GetCurrentThread(), mask))
+      report.cpuMask = mask;
+    else if (!report.error)
+      report.error = (int32_t)GetLastError();
+  }
+  report.level = GetThreadPriority(GetCurrentThread());
+#endif
+}
+
+} // namespace streampunk
@@ -0,0 +1,64 @@
+/* Copyright 2019 Streampunk Media Ltd.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef THREADPRIORITY_H
+#define THREADPRIORITY_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace streampunk {
+
+// Scheduling requested for a thread of the stream - SCHED_FIFO on Linux, a time constraint
+// policy on macOS or MMCSS "Pro Audio" on Windows for realtime - and the cores to pin it to.
+// apply() acts on the calling thread and never allocates, so it is safe in the callback.
+class ThreadPriority {
+public:
+  enum class ePriority : uint8_t { DEFAULT = 0, HIGH = 1, REALTIME = 2 };
+
+  // outcome of apply(), read back from the OS where it allows
+  struct Report {
+    ePriority priority;
+    // SCHED_FIFO priority or nice value on Linux, thread priority on macOS and Windows
+    int32_t level;
+    // cores the thread may run on, the first 64 only, zero when not known
+    uint64_t cpuMask;
+    // first OS error met, zero when everything asked for was granted
+    int32_t error;
+  };
+
+  ThreadPriority(ePriority priority, int32_t realtimeLevel, const std::vector<int32_t> &cpus, double periodSecs);
+  ~ThreadPriority() {}
+
+  static bool parsePriority(const std::string &str, ePriority &priority);
+  static const char *priorityName(ePriority priority);
+  static std::string errorString(int32_t error);
+
+  // true when the thread is left as the OS or host API made it
+  bool isDefault() const  { return (ePriority::DEFAULT == mPriority) && mCpus.empty(); }
+  void apply(Report &report) const;
+
+private:
+  const ePriority mPriority;
+  const int32_t mRealtimeLevel;
+  const std::vector<int32_t> mCpus;
+  // expected interval between wakeups, for the macOS time constraint
+  const double mPeriodSecs;
+};
+
+} // namespace streampunk
+
+#endif
@@ -17,11 +17,19 @@
 #include "GetDevices.h"
 #include "GetHostAPIs.h"
 #include "AudioIO.h"
+#include "AudioBridge.h"
+#include "AudioStreamManager.h"
+#include "DeviceWatcher.h"
 
 Napi::Object InitAll(Napi::Env env, Napi::Object exports) {
   exports.Set(Napi::String::New(env, "getDevices"), Napi::Function::New(env, streampunk::GetDevices));
+  exports.Set(Napi::String::New(env, "refreshDevices"), Napi::Function::New(env, streampunk::RefreshDevices));
+  exports.Set(Napi::String::New(env, "watchDevices"), Napi::Function::New(env, streampunk::WatchDevices));
+  exports.Set(Napi::String::New(env, "unwatchDevices"), Napi::Function::New(env, streampunk::UnwatchDevices));
   exports.Set(Napi::String::New(env, "getHostAPIs"), Napi::Function::New(env, streampunk::GetHostAPIs));
   streampunk::AudioIO::Init(env, exports);
+  streampunk::AudioBridge::Init(env, exports);
+  streampunk::AudioStreamManager::Init(env, exports);
   return exports;
 }
 